@@ -0,0 +1,264 @@
+/************************************************************************************
+ * This file contains the scratch memory of one isoRank() call. Everything a pair   *
+ * needs only while it is evaluated (the vertices of Tarjan's algorithm, the        *
+ * eigenvectors, the assignments of the restarts, the scratch score matrices and    *
+ * index arrays of the matchers) is taken from a monotonic arena: an allocation     *
+ * bumps a pointer in the current block and nothing is freed until the arena is     *
+ * reset before the next pair. Every thread that runs isoRank() keeps its own       *
+ * MatchContext, so the threads never share the heap lock for this memory and the   *
+ * memory of a worker stops growing once its largest pair was seen.                 *
+ ************************************************************************************/
+
+#ifndef _Arena_h
+#define _Arena_h
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include "Matrices/MatrixExceptions.h"
+#include "RandomStream.h"
+
+/*
+ * Arena class: monotonic allocator for trivially destructible objects.
+ */
+class Arena
+{
+private:
+    struct Block
+    {
+        char* memory;
+        size_t size;
+    };
+
+    std::vector<Block> _blocks;
+    int _current;
+    size_t _used;
+    size_t _bytes_allocated;
+    size_t _peak_bytes;
+
+    static const size_t _MIN_BLOCK_SIZE = 64 * 1024;
+
+    void* _allocate(size_t bytes, size_t alignment);
+
+public:
+    /*
+     * position of the arena, allocations made after mark() are released by rewind()
+     */
+    struct Marker
+    {
+        int block;
+        size_t used;
+        size_t bytes_allocated;
+    };
+
+    Arena();
+    virtual ~Arena();
+
+    template <typename T>
+    T* allocate(size_t count);
+    template <typename T>
+    T* allocateFilled(size_t count, const T& value);
+    void reset();
+    Marker mark();
+    void rewind(const Marker& marker);
+    size_t getBytesAllocated();
+    size_t getPeakBytes();
+
+private:
+    Arena(const Arena&);
+    void operator=(const Arena&);
+};
+
+/*
+ * Constructor: the first block is allocated with the first allocation.
+ */
+inline Arena::Arena()
+{
+    this->_current = -1;
+    this->_used = 0;
+    this->_bytes_allocated = 0;
+    this->_peak_bytes = 0;
+}
+
+/*
+ * Destructor: frees every block, the objects in the arena must not be used anymore.
+ */
+inline Arena::~Arena()
+{
+    for (int b = 0; b < this->_blocks.size(); b++)
+    {
+        delete [] this->_blocks[b].memory;
+    }
+}
+
+/*
+ * Returns uninitialized memory for count objects of type T. The objects are never destroyed,
+ * so T must not need its destructor to run.
+ * @pram size_t: number of objects
+ */
+template <typename T>
+inline T* Arena::allocate(size_t count)
+{
+    return static_cast<T*>(_allocate(std::max(count, size_t(1)) * sizeof(T), alignof(T)));
+}
+
+/*
+ * Returns memory for count objects of type T that are set to value.
+ * @pram size_t: number of objects
+ * @pram T: value of the objects
+ */
+template <typename T>
+inline T* Arena::allocateFilled(size_t count, const T& value)
+{
+    T* memory = allocate<T>(count);
+    std::fill(memory, memory + count, value);
+    return memory;
+}
+
+/*
+ * Releases everything that was allocated. Only the largest block is kept, so an arena
+ * that is reset between pairs settles on one block that fits the largest pair.
+ */
+inline void Arena::reset()
+{
+    if (this->_blocks.size() > 1)
+    {
+        int largest = 0;
+        for (int b = 1; b < this->_blocks.size(); b++)
+        {
+            if (this->_blocks[b].size > this->_blocks[largest].size)
+            {
+                largest = b;
+            }
+        }
+        for (int b = 0; b < this->_blocks.size(); b++)
+        {
+            if (b != largest)
+            {
+                delete [] this->_blocks[b].memory;
+            }
+        }
+        Block kept = this->_blocks[largest];
+        this->_blocks.assign(1, kept);
+    }
+    this->_current = this->_blocks.empty() ? -1 : 0;
+    this->_used = 0;
+    this->_bytes_allocated = 0;
+}
+
+/*
+ * Returns the current position of the arena.
+ */
+inline Arena::Marker Arena::mark()
+{
+    Marker marker;
+    marker.block = this->_current;
+    marker.used = this->_used;
+    marker.bytes_allocated = this->_bytes_allocated;
+    return marker;
+}
+
+/*
+ * Releases everything that was allocated after the marker was taken, the blocks are kept
+ * for the next allocations. Used by the loops that need scratch memory in every iteration.
+ * @pram Marker: position returned by mark()
+ */
+inline void Arena::rewind(const Marker& marker)
+{
+    this->_current = marker.block;
+    this->_used = marker.used;
+    this->_bytes_allocated = marker.bytes_allocated;
+}
+
+/*
+ * Returns the number of bytes allocated since the last reset.
+ */
+inline size_t Arena::getBytesAllocated()
+{
+    return this->_bytes_allocated;
+}
+
+/*
+ * Returns the largest number of bytes allocated between two resets.
+ */
+inline size_t Arena::getPeakBytes()
+{
+    return this->_peak_bytes;
+}
+
+/*
+ * bumps the pointer of the current block. When it is full the next block is used if it is
+ * large enough (after a rewind), otherwise the blocks after the current one are replaced by
+ * a block twice as large.
+ */
+inline void* Arena::_allocate(size_t bytes, size_t alignment)
+{
+    if (this->_current >= 0)
+    {
+        Block& block = this->_blocks[this->_current];
+        size_t start = (this->_used + alignment - 1) / alignment * alignment;
+        if (start + bytes <= block.size)
+        {
+            this->_used = start + bytes;
+            this->_bytes_allocated += bytes;
+            this->_peak_bytes = std::max(this->_peak_bytes, this->_bytes_allocated);
+            return block.memory + start;
+        }
+    }
+
+    //new char[] is aligned for any fundamental type
+    if (this->_current + 1 < this->_blocks.size() && bytes <= this->_blocks[this->_current + 1].size)
+    {
+        this->_current++;
+        this->_used = bytes;
+        this->_bytes_allocated += bytes;
+        this->_peak_bytes = std::max(this->_peak_bytes, this->_bytes_allocated);
+        return this->_blocks[this->_current].memory;
+    }
+
+    size_t block_size = this->_blocks.empty() ? _MIN_BLOCK_SIZE : this->_blocks.back().size * 2;
+    block_size = std::max(block_size, bytes + alignment);
+    Block block;
+    try
+    {
+        block.memory = new char[block_size];
+    }
+    catch (std::bad_alloc& e)
+    {
+        throw OutOfMemoryException();
+    }
+    block.size = block_size;
+    for (int b = this->_current + 1; b < this->_blocks.size(); b++)
+    {
+        delete [] this->_blocks[b].memory;
+    }
+    this->_blocks.resize(this->_current + 1);
+    this->_blocks.push_back(block);
+    this->_current++;
+    this->_used = bytes;
+    this->_bytes_allocated += bytes;
+    this->_peak_bytes = std::max(this->_peak_bytes, this->_bytes_allocated);
+    return block.memory;
+}
+
+/*
+ * MatchContext: the state of the thread that evaluates a pair, passed from isoRank()
+ * down to the helpers that need scratch memory or random numbers. The random stream
+ * is seeded by isoRank() before every trial (RandomStream.h).
+ */
+struct MatchContext
+{
+    Arena arena;
+    RandomStream random;
+
+    /*
+     * prepares the context for the next pair
+     */
+    void reset()
+    {
+        arena.reset();
+    }
+};
+
+#endif
@@ -0,0 +1,415 @@
+/************************************************************************************
+ * Benchmarks for the stages of the IsoRank pipeline on synthetic graphs.           *
+ * For every generator and size a pair of graphs is generated and every stage is    *
+ * timed on its own: kron, symmetric_kron, graph_con_com, getTopEigenVector, every  *
+ * eigen solver backend on the largest component, return_max, each greedy matcher,  *
+ * match_rest and the frobenius score. The stages that work on the kronecker        *
+ * product grow with (n1*n2)^2, so they only run while n1*n2 is not larger than     *
+ * -max_kron_nodes; the larger sizes use a random scores matrix for the matchers.   *
+ * Every measurement is written as one JSON object per line to benchmark.jsonl.     *
+ *                                                                                  *
+ * Build with: make bench                                                           *
+ ************************************************************************************/
+
+#include <string>
+#include <string.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "../IsoRank.h"
+#include "../Profiler.h"
+#include "GraphGenerators.h"
+
+/*
+ * Benchmark configuration
+ */
+std::vector<int> G_SIZES;
+std::vector<std::string> G_GENERATORS;
+int G_REPEATS = 3;
+unsigned long long G_SEED = 1;
+int G_MAX_KRON_NODES = 1600;
+int G_MAX_MATCHING_NODES = 500;
+std::string G_OUTPUT_FILE = "benchmark.jsonl";
+
+/*
+ * Results of the timed stages are added to this, so the compiler cannot remove the stages.
+ */
+volatile double G_SINK = 0;
+
+static const char* const ALL_GENERATORS[] = {"erdos_renyi", "random_regular", "lattice", "molecule", "perturbed_isomorphic"};
+static const int NUM_OF_GENERATORS = 5;
+static const int DEFAULT_SIZES[] = {10, 20, 40, 100, 200, 500, 1000, 2000, 5000};
+static const int NUM_OF_DEFAULT_SIZES = 9;
+
+/*
+ * struct used to store the pair of graphs of a benchmark
+ */
+struct Benchmark_Pair
+{
+    std::string generator;
+    DenseMatrix1D<float> graph_A;
+    DenseMatrix1D<float> graph_B;
+    std::vector<int> reference_assignment;     //a matching of every node of graph_A to a node of graph_B
+};
+
+/*
+ * Function prototypes
+ */
+void parseCommandLineArgs(int argc, char * argv[]);
+std::vector<int> parseList(const std::string& list);
+void makePair(const std::string& generator, int n, unsigned long long seed, Benchmark_Pair& pair);
+void runPair(Benchmark_Pair& pair, std::ostream& out);
+void timeStage(Benchmark_Pair& pair, const std::string& stage, std::function<void()> setup, std::function<void()> body, std::ostream& out);
+
+/*
+ * Main function
+ * @pram int argc
+ * @pram char** argv
+ */
+int main(int argc, char * argv[])
+{
+    G_SIZES.assign(DEFAULT_SIZES, DEFAULT_SIZES + NUM_OF_DEFAULT_SIZES);
+    G_GENERATORS.assign(ALL_GENERATORS, ALL_GENERATORS + NUM_OF_GENERATORS);
+    parseCommandLineArgs(argc, argv);
+
+    std::ofstream file_writer;
+    if (!G_OUTPUT_FILE.empty())
+    {
+        file_writer.open(G_OUTPUT_FILE.c_str(), std::ios::out | std::ios::trunc);
+        if (file_writer.fail())
+        {
+            std::cerr << "Output file '" << G_OUTPUT_FILE << "' could not be opened." << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = G_OUTPUT_FILE.empty() ? std::cout : file_writer;
+    if (!G_OUTPUT_FILE.empty())
+        std::cerr << "Writing the measurements to: " << G_OUTPUT_FILE << std::endl;
+
+    for (int g = 0; g < G_GENERATORS.size(); g++)
+    {
+        for (int s = 0; s < G_SIZES.size(); s++)
+        {
+            Benchmark_Pair pair;
+            makePair(G_GENERATORS[g], G_SIZES[s], G_SEED, pair);
+            runPair(pair, out);
+        }
+    }
+    return 0;
+}
+
+/*
+ * Generates the pair of graphs of a benchmark. The pair of the perturbed_isomorphic generator is an
+ * Erdos-Renyi graph and a relabeled copy with 5% of its edges flipped, the other generators give two
+ * independent graphs of the same family.
+ * @pram std::string name of the generator
+ * @pram int number of nodes
+ * @pram unsigned long long seed
+ * @pram Benchmark_Pair set to the generated pair
+ */
+void makePair(const std::string& generator, int n, unsigned long long seed, Benchmark_Pair& pair)
+{
+    SplitMix64 rng(seed * 1000003ULL + n);
+    pair.generator = generator;
+    pair.reference_assignment.resize(n);
+    for (int i = 0; i < n; i++)
+    {
+        pair.reference_assignment[i] = i;
+    }
+
+    if (generator == "erdos_renyi")
+    {
+        pair.graph_A = erdos_renyi_graph(n, 4, rng);
+        pair.graph_B = erdos_renyi_graph(n, 4, rng);
+    }
+    else if (generator == "random_regular")
+    {
+        pair.graph_A = random_regular_graph(n, 3, rng);
+        pair.graph_B = random_regular_graph(n, 3, rng);
+    }
+    else if (generator == "lattice")
+    {
+        pair.graph_A = lattice_graph(n);
+        pair.graph_B = lattice_graph(n);
+    }
+    else if (generator == "molecule")
+    {
+        pair.graph_A = molecule_graph(n, rng);
+        pair.graph_B = molecule_graph(n, rng);
+    }
+    else if (generator == "perturbed_isomorphic")
+    {
+        pair.graph_A = erdos_renyi_graph(n, 4, rng);
+        int flips = std::max(1, count_edges(pair.graph_A) / 20);
+        pair.graph_B = perturbed_isomorphic_graph(pair.graph_A, flips, rng, pair.reference_assignment);
+    }
+    else
+    {
+        std::cerr << "Unknown generator '" << generator << "'." << std::endl;
+        pair.graph_A = DenseMatrix1D<float>(0, 0);
+        pair.graph_B = DenseMatrix1D<float>(0, 0);
+        pair.reference_assignment.clear();
+    }
+}
+
+/*
+ * Runs every stage on a pair of graphs and writes the measurements
+ * @pram Benchmark_Pair pair of graphs
+ * @pram std::ostream output stream
+ */
+void runPair(Benchmark_Pair& pair, std::ostream& out)
+{
+    int n_A = pair.graph_A.getNumberOfRows();
+    int n_B = pair.graph_B.getNumberOfRows();
+    if (n_A == 0)
+    {
+        return;
+    }
+    std::vector<int> assignment(n_A);
+    DenseMatrix1D<float> scores(n_A, n_B);
+    DenseMatrix1D<float> matches;
+
+    //frobenius score of the reference matching
+    timeStage(pair, "frobenius", [&]() { assignment = pair.reference_assignment; },
+              [&]() { G_SINK += frobenius_score(&assignment[0], pair.graph_A, pair.graph_B); }, out);
+
+    //match_rest with every other node left unmatched
+    timeStage(pair, "match_rest",
+              [&]() {
+                  for (int i = 0; i < n_A; i++)
+                  {
+                      assignment[i] = (i % 2 == 0) ? pair.reference_assignment[i] : -1;
+                  }
+              },
+              [&]() { match_rest(&assignment[0], pair.graph_A, pair.graph_B); }, out);
+
+    if (n_A * n_B <= G_MAX_KRON_NODES)
+    {
+        DenseMatrix1D<float> kron_prod;
+        timeStage(pair, "kron", []() {}, [&]() { kron_prod = pair.graph_A.kron(pair.graph_B); }, out);
+        SymMatrix<float> packed_A(pair.graph_A);
+        SymMatrix<float> packed_B(pair.graph_B);
+        SymMatrix<float> packed_kron_prod;
+        timeStage(pair, "symmetric_kron", []() {}, [&]() { packed_kron_prod = packed_A.kron(packed_B); }, out);
+
+        std::vector<vertex*> vertices;
+        timeStage(pair, "graph_con_com",
+                  [&]() {
+                      for (int i = 0; i < vertices.size(); i++)
+                      {
+                          delete vertices[i];
+                      }
+                  },
+                  [&]() { vertices = graph_con_com(kron_prod); }, out);
+        for (int i = 0; i < vertices.size(); i++)
+        {
+            delete vertices[i];
+        }
+
+        //normalized kronecker product D^-1/2 * L * D^-1/2, isolated nodes are left as zero rows
+        std::vector<float> sum = kron_prod.getSumOfRows();
+        std::vector<float> D_neg0pt5(sum.size());
+        for (int j = 0; j < sum.size(); j++)
+        {
+            D_neg0pt5[j] = (sum[j] > 0) ? 1.0 / std::sqrt(sum[j]) : 0;
+        }
+        DenseMatrix1D<float> Ms = kron_prod.diagonalVectorTimesMatrix(D_neg0pt5).matrixTimesDiagonalVector(D_neg0pt5);
+
+        float* eigenvector = NULL;
+        timeStage(pair, "getTopEigenVector", [&]() { delete [] eigenvector; }, [&]() { eigenvector = Ms.getTopEigenVector(); }, out);
+
+        //the scores of the node pair (i, k) is entry i*n_B+k of the eigenvector
+        for (int i = 0; i < n_A; i++)
+        {
+            for (int k = 0; k < n_B; k++)
+            {
+                scores(i, k) = std::fabs(eigenvector[i * n_B + k]);
+            }
+        }
+        delete [] eigenvector;
+        eigenvector = NULL;
+
+        //every eigen solver backend that was compiled in, on the largest component of the packed product
+        vertices = graph_con_com(packed_kron_prod);
+        ComponentPartition components = component_partition(vertices);
+        int largest = 0;
+        for (int c = 1; c < components.getNumberOfComponents(); c++)
+        {
+            if (components.getComponentSize(c) > components.getComponentSize(largest))
+            {
+                largest = c;
+            }
+        }
+        NormalizedOperator<float> component(packed_kron_prod, components.getComponentMembers(largest), components.getComponentSize(largest));
+        for (int b = 0; b < NUM_OF_EIGEN_BACKENDS; b++)
+        {
+            if (eigen_backend_available(b))
+            {
+                timeStage(pair, std::string("eigen_") + EIGEN_BACKEND_NAMES[b], [&]() { delete [] eigenvector; },
+                          [&]() { eigenvector = component.getTopEigenVector(b, 1e-6); }, out);
+                delete [] eigenvector;
+                eigenvector = NULL;
+            }
+        }
+        for (int i = 0; i < vertices.size(); i++)
+        {
+            delete vertices[i];
+        }
+    }
+    else
+    {
+        SplitMix64 rng(G_SEED + n_A);
+        for (int i = 0; i < n_A; i++)
+        {
+            for (int k = 0; k < n_B; k++)
+            {
+                scores(i, k) = rng.uniform();
+            }
+        }
+    }
+
+    if (n_A > G_MAX_MATCHING_NODES)
+    {
+        return;
+    }
+    //the matchers take their scratch memory and their random stream from a context, as in isoRank()
+    MatchContext context;
+    context.random.seed(pair_stream(G_SEED, 0, 0), 0);
+    int row, col;
+    float total_score = 0;
+    timeStage(pair, "return_max", []() {}, [&]() { return_max(scores, &total_score, &row, &col, context.random); }, out);
+    timeStage(pair, "greedy_1", [&]() { matches = scores; context.reset(); },
+              [&]() { greedy_1(matches, pair.graph_A, pair.graph_B, &assignment[0], context); }, out);
+    timeStage(pair, "greedy_connectivity_1", [&]() { matches = scores; context.reset(); },
+              [&]() { greedy_connectivity_1(matches, pair.graph_A, pair.graph_B, &assignment[0], context); }, out);
+    timeStage(pair, "greedy_connectivity_2", [&]() { matches = scores; context.reset(); },
+              [&]() { greedy_connectivity_2(matches, pair.graph_A, pair.graph_B, &assignment[0], context); }, out);
+    timeStage(pair, "greedy_connectivity_3", [&]() { matches = scores; context.reset(); },
+              [&]() { greedy_connectivity_3(matches, pair.graph_A, pair.graph_B, &assignment[0], context); }, out);
+    timeStage(pair, "greedy_connectivity_4", [&]() { matches = scores; context.reset(); },
+              [&]() { greedy_connectivity_4(matches, pair.graph_A, pair.graph_B, &assignment[0], context); }, out);
+}
+
+/*
+ * Times G_REPEATS runs of a stage and writes one JSON line with the measurements.
+ * The setup is run before every repeat and is not timed.
+ * @pram Benchmark_Pair pair of graphs
+ * @pram std::string name of the stage
+ * @pram std::function setup of a repeat
+ * @pram std::function the stage
+ * @pram std::ostream output stream
+ */
+void timeStage(Benchmark_Pair& pair, const std::string& stage, std::function<void()> setup, std::function<void()> body, std::ostream& out)
+{
+    std::vector<double> times;
+    for (int r = 0; r < G_REPEATS; r++)
+    {
+        setup();
+        WallClock::time_point start = WallClock::now();
+        body();
+        times.push_back(std::chrono::duration<double, std::milli>(WallClock::now() - start).count());
+    }
+    std::sort(times.begin(), times.end());
+    double total = 0;
+    for (int r = 0; r < times.size(); r++)
+    {
+        total += times[r];
+    }
+
+    out << "{\"generator\": \"" << pair.generator << "\""
+        << ", \"nodes_a\": " << pair.graph_A.getNumberOfRows()
+        << ", \"nodes_b\": " << pair.graph_B.getNumberOfRows()
+        << ", \"edges_a\": " << count_edges(pair.graph_A)
+        << ", \"edges_b\": " << count_edges(pair.graph_B)
+        << ", \"stage\": \"" << stage << "\""
+        << ", \"seed\": " << G_SEED
+        << ", \"repeats\": " << times.size()
+        << ", \"min_ms\": " << times.front()
+        << ", \"median_ms\": " << times[times.size() / 2]
+        << ", \"mean_ms\": " << total / times.size()
+        << ", \"max_ms\": " << times.back() << "}" << std::endl;
+}
+
+/*
+ * Splits a comma separated list of numbers
+ * @pram std::string list
+ */
+std::vector<int> parseList(const std::string& list)
+{
+    std::vector<int> values;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        int value = atoi(item.c_str());
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+/*
+ * This method Configures the setting of the benchmark according to the command line agrs.
+ * @pram int argc
+ * @pram char** argv
+ */
+void parseCommandLineArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        //comma separated list of graph sizes
+        if (std::strncmp(argv[i], "-sizes", 6) == 0 && i + 1 < argc)
+        {
+            G_SIZES = parseList(argv[++i]);
+        }
+        //comma separated list of generators
+        else if (std::strncmp(argv[i], "-generators", 11) == 0 && i + 1 < argc)
+        {
+            G_GENERATORS.clear();
+            std::stringstream stream(argv[++i]);
+            std::string item;
+            while (std::getline(stream, item, ','))
+            {
+                G_GENERATORS.push_back(item);
+            }
+        }
+        //number of times every stage is run
+        else if (std::strncmp(argv[i], "-repeats", 8) == 0 && i + 1 < argc)
+        {
+            G_REPEATS = std::max(1, atoi(argv[++i]));
+        }
+        //seed of the generators
+        else if (std::strncmp(argv[i], "-seed", 5) == 0 && i + 1 < argc)
+        {
+            G_SEED = strtoull(argv[++i], NULL, 10);
+        }
+        //largest n1*n2 for which the kronecker product stages are run
+        else if (std::strncmp(argv[i], "-max_kron_nodes", 15) == 0 && i + 1 < argc)
+        {
+            G_MAX_KRON_NODES = atoi(argv[++i]);
+        }
+        //largest number of nodes for which the greedy matchers are run
+        else if (std::strncmp(argv[i], "-max_matching_nodes", 19) == 0 && i + 1 < argc)
+        {
+            G_MAX_MATCHING_NODES = atoi(argv[++i]);
+        }
+        //file the measurements are written to, "-" is the console
+        else if (std::strncmp(argv[i], "-out", 4) == 0 && i + 1 < argc)
+        {
+            G_OUTPUT_FILE = std::string(argv[++i]);
+            if (G_OUTPUT_FILE == "-")
+            {
+                G_OUTPUT_FILE = "";
+            }
+        }
+        else
+        {
+            std::cerr << "Arg '" << argv[i] << "' is not a valid argument." << std::endl;
+        }
+    }
+}
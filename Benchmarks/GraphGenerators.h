@@ -0,0 +1,229 @@
+/************************************************************************************
+ * This file contains the deterministic generators of synthetic graphs used by the  *
+ * benchmarks. Every generator takes a random number generator that is seeded by    *
+ * the caller, so the same seed always gives the same graph on every machine.       *
+ * All graphs are undirected 0/1 adjacency matrices without self loops.             *
+ ************************************************************************************/
+
+#ifndef _GraphGenerators_h
+#define _GraphGenerators_h
+
+#include "../Matrices/DenseMatrix1D.h"
+#include <vector>
+#include <cmath>
+
+/*
+ * SplitMix64 random number generator. Unlike rand() its sequence does not depend on
+ * the C library, so the generated graphs are the same on every machine.
+ */
+class SplitMix64
+{
+private:
+    unsigned long long _state;
+
+public:
+    explicit SplitMix64(unsigned long long seed)
+    {
+        _state = seed;
+    }
+
+    unsigned long long next()
+    {
+        unsigned long long z = (_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /*
+     * returns a number in [0, 1)
+     */
+    double uniform()
+    {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    /*
+     * returns an integer in [0, n)
+     */
+    int below(int n)
+    {
+        return (int)(uniform() * n);
+    }
+};
+
+/*
+ * adds the undirected edge (i, j) to a graph
+ * @pram: adjacency matrix of the graph
+ * @pram: first node
+ * @pram: second node
+ */
+void add_edge(DenseMatrix1D<float>& graph, int i, int j){
+    graph(i,j)=1;
+    graph(j,i)=1;
+}
+
+/*
+ * returns the number of undirected edges of a graph
+ * @pram: adjacency matrix of the graph
+ */
+int count_edges(DenseMatrix1D<float>& graph){
+    int edges=0;
+    for(int i=0;i<graph.getNumberOfRows();i++){
+        for(int j=i+1;j<graph.getNumberOfColumns();j++){
+            if(graph(i,j)!=0){
+                edges++;
+            }
+        }
+    }
+    return edges;
+}
+
+/*
+ * returns an Erdos-Renyi graph where every edge exists with the same probability
+ * @pram: number of nodes
+ * @pram: expected degree of a node
+ * @pram: random number generator
+ */
+DenseMatrix1D<float> erdos_renyi_graph(int n, double average_degree, SplitMix64& rng){
+    DenseMatrix1D<float> graph(n,n);
+    double p=(n>1)?average_degree/(n-1):0;
+    for(int i=0;i<n;i++){
+        for(int j=i+1;j<n;j++){
+            if(rng.uniform()<p){
+                add_edge(graph,i,j);
+            }
+        }
+    }
+    return graph;
+}
+
+/*
+ * returns a random graph where every node has the given degree, using the configuration
+ * model. Pairs of stubs that would create a self loop or a multi edge are dropped, so a
+ * few nodes can have a smaller degree.
+ * @pram: number of nodes
+ * @pram: degree of every node
+ * @pram: random number generator
+ */
+DenseMatrix1D<float> random_regular_graph(int n, int degree, SplitMix64& rng){
+    DenseMatrix1D<float> graph(n,n);
+    std::vector<int> stubs;
+    for(int i=0;i<n;i++){
+        for(int d=0;d<degree;d++){
+            stubs.push_back(i);
+        }
+    }
+    //Fisher-Yates shuffle of the stubs, then pair consecutive stubs
+    for(int k=stubs.size()-1;k>0;k--){
+        std::swap(stubs[k],stubs[rng.below(k+1)]);
+    }
+    for(int k=0;k+1<stubs.size();k+=2){
+        int i=stubs[k];
+        int j=stubs[k+1];
+        if(i!=j&&graph(i,j)==0){
+            add_edge(graph,i,j);
+        }
+    }
+    return graph;
+}
+
+/*
+ * returns a 2D square lattice with n nodes, filled row by row
+ * @pram: number of nodes
+ */
+DenseMatrix1D<float> lattice_graph(int n){
+    DenseMatrix1D<float> graph(n,n);
+    int width=std::max(1,(int)std::ceil(std::sqrt((double)n)));
+    for(int i=0;i<n;i++){
+        if((i+1)%width!=0&&i+1<n){
+            add_edge(graph,i,i+1);
+        }
+        if(i+width<n){
+            add_edge(graph,i,i+width);
+        }
+    }
+    return graph;
+}
+
+/*
+ * returns a graph that looks like a molecule: a random tree where no atom has more than
+ * 4 bonds, with about one ring closing bond for every 10 atoms
+ * @pram: number of nodes
+ * @pram: random number generator
+ */
+DenseMatrix1D<float> molecule_graph(int n, SplitMix64& rng){
+    const int MAX_VALENCE=4;
+    DenseMatrix1D<float> graph(n,n);
+    std::vector<int> degree(n,0);
+
+    //every new atom bonds to a random atom that still has a free valence
+    for(int i=1;i<n;i++){
+        int j=rng.below(i);
+        while(degree[j]>=MAX_VALENCE){
+            j=(j+1)%i;
+        }
+        add_edge(graph,i,j);
+        degree[i]++;
+        degree[j]++;
+    }
+
+    //close rings between atoms that are close in the order they were added
+    int rings=n/10;
+    for(int r=0;r<rings;r++){
+        int i=rng.below(n);
+        int j=std::min(n-1,i+3+rng.below(4));
+        if(i!=j&&graph(i,j)==0&&degree[i]<MAX_VALENCE&&degree[j]<MAX_VALENCE){
+            add_edge(graph,i,j);
+            degree[i]++;
+            degree[j]++;
+        }
+    }
+    return graph;
+}
+
+/*
+ * returns a copy of a graph with its nodes relabeled by a random permutation and a number of
+ * edges flipped: every other flip removes a random edge, the others add a random edge
+ * @pram: adjacency matrix of the graph
+ * @pram: number of node pairs to flip
+ * @pram: random number generator
+ * @pram: set to the permutation, node i of the graph is node permutation[i] of the copy
+ */
+DenseMatrix1D<float> perturbed_isomorphic_graph(DenseMatrix1D<float>& graph, int flips, SplitMix64& rng, std::vector<int>& permutation){
+    int n=graph.getNumberOfRows();
+    permutation.resize(n);
+    for(int i=0;i<n;i++){
+        permutation[i]=i;
+    }
+    for(int k=n-1;k>0;k--){
+        std::swap(permutation[k],permutation[rng.below(k+1)]);
+    }
+
+    DenseMatrix1D<float> copy(n,n);
+    for(int i=0;i<n;i++){
+        for(int j=0;j<n;j++){
+            copy(permutation[i],permutation[j])=graph(i,j);
+        }
+    }
+
+    for(int f=0;f<flips&&n>1;f++){
+        float value=(f%2==0)?0:1;
+        //look for a node pair that can be flipped, sparse graphs have few edges to remove
+        for(int attempt=0;attempt<n*n;attempt++){
+            int i=rng.below(n);
+            int j=rng.below(n-1);
+            if(j>=i){
+                j++;
+            }
+            if(copy(i,j)!=value){
+                copy(i,j)=value;
+                copy(j,i)=value;
+                break;
+            }
+        }
+    }
+    return copy;
+}
+
+#endif
@@ -0,0 +1,277 @@
+/************************************************************************************
+ * This file contains the checkpoint log used to restart long all-pairs runs.       *
+ * The master appends every result it receives to a binary log that is flushed to   *
+ * disk periodically. When a run is restarted with -resume the log is read back,    *
+ * the completed pairs are skipped and only the remaining pairs are computed.       *
+ * A log written with other settings is not resumed.                                *
+ *                                                                                  *
+ * Layout of the log:                                                               *
+ *      header: magic, number of graphs, matching algorithm, hash of the settings,  *
+ *              hash of every graph                                                 *
+ *      record: i, j, frob_norm, assignment_length, score, assignments              *
+ * A record that was cut off by a kill, or that does not fit the graphs, ends the   *
+ * log when it is read.                                                             *
+ ************************************************************************************/
+
+#ifndef _Checkpoint_h
+#define _Checkpoint_h
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#include <ctime>
+#include <algorithm>
+#include "Matrices/MPI_Structs.h"
+#include "Matrices/MatrixExceptions.h"
+#include "ResultsStore.h"
+
+static const char CHECKPOINT_MAGIC[8] = {'I', 'R', 'C', 'K', 'P', 'T', '0', '3'};
+
+/*
+ * Thrown when a checkpoint log was written for a different set of graphs or settings.
+ */
+class CheckpointMismatchException : public std::exception
+{
+public:
+    virtual const char* what() const throw()
+    {
+        return "checkpoint log does not match the input graphs or the settings";
+    }
+};
+
+/*
+ * CheckpointLog class: append-only log of the results of completed pairs.
+ */
+class CheckpointLog
+{
+private:
+    std::ofstream _file_writer;
+    int _flush_interval;
+    int _records_since_flush;
+    std::time_t _last_flush;
+
+    void _writeHeader(int matching_algorithm, GraphHash settings, const std::vector<GraphHash>& graph_hashes);
+    void _writeRecord(const IsoRank_Result& result);
+
+public:
+    CheckpointLog();
+    virtual ~CheckpointLog();
+
+    bool isOpen();
+    std::vector<IsoRank_Result> load(const std::string& file_path, int matching_algorithm, GraphHash settings,
+                                     const std::vector<GraphHash>& graph_hashes, const std::vector<int>& graph_sizes);
+    void open(const std::string& file_path, int matching_algorithm, GraphHash settings, const std::vector<GraphHash>& graph_hashes,
+              const std::vector<IsoRank_Result>& completed, int flush_interval);
+    void append(const IsoRank_Result& result);
+    void flush();
+    void close();
+};
+
+/*
+ * Constructor: the log is closed until open is called.
+ */
+inline CheckpointLog::CheckpointLog()
+{
+    _flush_interval = 0;
+    _records_since_flush = 0;
+    _last_flush = std::time(NULL);
+}
+
+/*
+ * Destructor: flushes and closes the log.
+ */
+inline CheckpointLog::~CheckpointLog()
+{
+    close();
+}
+
+/*
+ * Returns true if results are being logged.
+ */
+inline bool CheckpointLog::isOpen()
+{
+    return _file_writer.is_open();
+}
+
+/*
+ * Reads the completed pairs of a log. A log that does not exist has no completed pairs.
+ * Throws CheckpointMismatchException if the log was written for other graphs or settings.
+ * @pram std::string path to the log
+ * @pram int matching algorithm of this run
+ * @pram GraphHash hash of the settings of this run that change the results
+ * @pram std::vector<GraphHash> hashes of the input graphs
+ * @pram std::vector<int> number of nodes of the input graphs, bounds the assignments of the records
+ */
+inline std::vector<IsoRank_Result> CheckpointLog::load(const std::string& file_path, int matching_algorithm, GraphHash settings,
+                                                       const std::vector<GraphHash>& graph_hashes, const std::vector<int>& graph_sizes)
+{
+    std::vector<IsoRank_Result> completed;
+    std::ifstream file_reader(file_path.c_str(), std::ios::in | std::ios::binary);
+    if (file_reader.fail())
+    {
+        return completed;
+    }
+
+    char magic[8];
+    int number_of_graphs, log_matching_algorithm;
+    GraphHash log_settings;
+    file_reader.read(magic, 8);
+    file_reader.read((char*)&number_of_graphs, sizeof(int));
+    file_reader.read((char*)&log_matching_algorithm, sizeof(int));
+    file_reader.read((char*)&log_settings, sizeof(GraphHash));
+    if (file_reader.fail() || std::memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || number_of_graphs != graph_hashes.size()
+        || log_matching_algorithm != matching_algorithm || log_settings != settings)
+    {
+        throw CheckpointMismatchException();
+    }
+    std::vector<GraphHash> log_hashes(number_of_graphs);
+    if (number_of_graphs > 0)
+    {
+        file_reader.read((char*)&log_hashes[0], number_of_graphs * sizeof(GraphHash));
+    }
+    if (file_reader.fail() || log_hashes != graph_hashes)
+    {
+        throw CheckpointMismatchException();
+    }
+
+    while (true)
+    {
+        int header[4];
+        file_reader.read((char*)header, 4 * sizeof(int));
+        if (file_reader.fail() || header[0] < 0 || header[1] >= number_of_graphs || header[0] >= header[1] || header[3] < 0
+            || header[3] > std::max(graph_sizes[header[0]], graph_sizes[header[1]]))
+        {
+            break;
+        }
+
+        IsoRank_Result result;
+        result.graph_i = header[0];
+        result.graph_j = header[1];
+        result.frob_norm = header[2];
+        result.assignment_length = header[3];
+        //no trials are run for a pair restored from the log
+        result.trials = 0;
+        file_reader.read((char*)&result.score, sizeof(float));
+        result.assignments = new int[result.assignment_length];
+        file_reader.read((char*)result.assignments, result.assignment_length * sizeof(int));
+        if (file_reader.fail())
+        {
+            delete [] result.assignments;
+            break;
+        }
+        completed.push_back(result);
+    }
+    return completed;
+}
+
+/*
+ * Starts a new log that contains the completed pairs. A log that was read with load is rewritten,
+ * which drops a record cut off by a kill so new records can be appended after it. The new log is
+ * written to a temporary file that replaces the old one, so a kill during the rewrite keeps the old log.
+ * @pram std::string path to the log
+ * @pram int matching algorithm of this run
+ * @pram GraphHash hash of the settings of this run that change the results
+ * @pram std::vector<GraphHash> hashes of the input graphs
+ * @pram std::vector<IsoRank_Result> results of the pairs that are already completed
+ * @pram int number of seconds between two flushes to disk
+ */
+inline void CheckpointLog::open(const std::string& file_path, int matching_algorithm, GraphHash settings,
+                                const std::vector<GraphHash>& graph_hashes, const std::vector<IsoRank_Result>& completed,
+                                int flush_interval)
+{
+    std::string tmp_path = file_path + ".tmp";
+    _file_writer.open(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if (_file_writer.fail())
+    {
+        throw FileDoesNotExistException(tmp_path);
+    }
+    _writeHeader(matching_algorithm, settings, graph_hashes);
+    for (int i = 0; i < completed.size(); i++)
+    {
+        _writeRecord(completed[i]);
+    }
+    _file_writer.close();
+    std::rename(tmp_path.c_str(), file_path.c_str());
+
+    _file_writer.open(file_path.c_str(), std::ios::out | std::ios::binary | std::ios::app);
+    if (_file_writer.fail())
+    {
+        throw FileDoesNotExistException(file_path);
+    }
+    _flush_interval = flush_interval;
+    flush();
+}
+
+/*
+ * Appends the result of a pair to the log. The log is flushed when the flush interval has passed.
+ * @pram IsoRank_Result result with its pair indices
+ */
+inline void CheckpointLog::append(const IsoRank_Result& result)
+{
+    if (!isOpen())
+    {
+        return;
+    }
+    _writeRecord(result);
+    _records_since_flush++;
+    if (std::difftime(std::time(NULL), _last_flush) >= _flush_interval)
+    {
+        flush();
+    }
+}
+
+/*
+ * Writes the buffered records to disk.
+ */
+inline void CheckpointLog::flush()
+{
+    if (isOpen())
+    {
+        _file_writer.flush();
+    }
+    _records_since_flush = 0;
+    _last_flush = std::time(NULL);
+}
+
+/*
+ * Flushes and closes the log.
+ */
+inline void CheckpointLog::close()
+{
+    if (isOpen())
+    {
+        flush();
+        _file_writer.close();
+    }
+}
+
+/*
+ * Writes the header of the log.
+ */
+inline void CheckpointLog::_writeHeader(int matching_algorithm, GraphHash settings, const std::vector<GraphHash>& graph_hashes)
+{
+    int number_of_graphs = graph_hashes.size();
+    _file_writer.write(CHECKPOINT_MAGIC, 8);
+    _file_writer.write((const char*)&number_of_graphs, sizeof(int));
+    _file_writer.write((const char*)&matching_algorithm, sizeof(int));
+    _file_writer.write((const char*)&settings, sizeof(GraphHash));
+    if (number_of_graphs > 0)
+    {
+        _file_writer.write((const char*)&graph_hashes[0], number_of_graphs * sizeof(GraphHash));
+    }
+}
+
+/*
+ * Writes one record to the log.
+ */
+inline void CheckpointLog::_writeRecord(const IsoRank_Result& result)
+{
+    int header[4] = {result.graph_i, result.graph_j, result.frob_norm, result.assignment_length};
+    _file_writer.write((const char*)header, 4 * sizeof(int));
+    _file_writer.write((const char*)&result.score, sizeof(float));
+    _file_writer.write((const char*)result.assignments, result.assignment_length * sizeof(int));
+}
+
+#endif
@@ -0,0 +1,329 @@
+/************************************************************************************
+ * This file contains the graph distribution of the node pair version. The master   *
+ * remembers which graphs every worker already has and only sends the graphs of a  *
+ * pair that the worker lacks; the worker keeps every graph it received in a cache, *
+ * identified by its index. The sends do not block, so the master can send the     *
+ * next pairs of a worker while the worker computes the current ones.               *
+ *                                                                                  *
+ * Messages of a pair:                                                              *
+ *      header: graph_i, graph_j and the number of bytes of the two graphs, -1 when  *
+ *              the worker already has the graph. graph_i == -1 terminates.         *
+ *      graphs: the compact forms (CompactForm.h) of the graphs that are not cached, *
+ *              in order. They are encoded once, the first time they are sent.      *
+ ************************************************************************************/
+
+#ifndef _GraphCache_h
+#define _GraphCache_h
+
+#ifdef USE_MPI
+#include <vector>
+#include <list>
+#include <map>
+#include "mpi.h"
+#include "Matrices/SymMatrix.h"
+#include "Matrices/CompactForm.h"
+#include "WorkerThreads.h"
+
+/*
+ * GraphPairSender class: sends pairs of graphs from the master to the workers.
+ */
+template <typename T>
+class GraphPairSender
+{
+private:
+    std::vector<SymMatrix<T>*>& _graphs;
+    std::vector<std::vector<unsigned char> > _compact_forms;
+    std::vector<std::vector<char> > _sent;
+    std::list<std::vector<int> > _headers;
+    std::list<MPI_Request> _requests;
+    long long _pairs_sent;
+    long long _graphs_sent;
+    long long _bytes_sent;
+
+    int _getCompactSize(int graph);
+    void _send(const std::vector<int>& header, int dest, int header_tag, int graph_tag);
+    void _release();
+
+public:
+    GraphPairSender(std::vector<SymMatrix<T>*>& graphs, int num_procs);
+    virtual ~GraphPairSender();
+
+    void send(int graph_i, int graph_j, int dest, int header_tag, int graph_tag);
+    void terminate(int dest, int header_tag);
+    void waitAll();
+    long long getPairsSent();
+    long long getGraphsSent();
+    long long getBytesSent();
+};
+
+/*
+ * Constructor:
+ * @pram std::vector<SymMatrix<T>*>: the graphs, they must not change until the sends are complete
+ * @pram int: number of processors
+ */
+template <typename T>
+inline GraphPairSender<T>::GraphPairSender(std::vector<SymMatrix<T>*>& graphs, int num_procs) : _graphs(graphs)
+{
+    this->_compact_forms.resize(graphs.size());
+    this->_sent.resize(num_procs, std::vector<char>(graphs.size(), 0));
+    this->_pairs_sent = 0;
+    this->_graphs_sent = 0;
+    this->_bytes_sent = 0;
+}
+
+/*
+ * Destructor: waits for the sends that are not complete.
+ */
+template <typename T>
+inline GraphPairSender<T>::~GraphPairSender()
+{
+    waitAll();
+}
+
+/*
+ * Starts sending a pair of graphs to a worker, the graphs that the worker already has are not sent again.
+ * @pram int: index of the first graph
+ * @pram int: index of the second graph
+ * @pram int: worker's ID
+ * @pram int: tag of the header
+ * @pram int: tag of the graphs
+ */
+template <typename T>
+inline void GraphPairSender<T>::send(int graph_i, int graph_j, int dest, int header_tag, int graph_tag)
+{
+    std::vector<int> header(4);
+    header[0] = graph_i;
+    header[1] = graph_j;
+    header[2] = this->_sent[dest][graph_i] ? -1 : _getCompactSize(graph_i);
+    header[3] = this->_sent[dest][graph_j] ? -1 : _getCompactSize(graph_j);
+    this->_sent[dest][graph_i] = 1;
+    this->_sent[dest][graph_j] = 1;
+    this->_pairs_sent++;
+    _send(header, dest, header_tag, graph_tag);
+}
+
+/*
+ * Starts sending the terminate signal to a worker.
+ * @pram int: worker's ID
+ * @pram int: tag of the header
+ */
+template <typename T>
+inline void GraphPairSender<T>::terminate(int dest, int header_tag)
+{
+    _send(std::vector<int>(4, -1), dest, header_tag, 0);
+}
+
+/*
+ * Waits until every send is complete.
+ */
+template <typename T>
+inline void GraphPairSender<T>::waitAll()
+{
+    std::list<MPI_Request>::iterator request_it;
+    for (request_it = this->_requests.begin(); request_it != this->_requests.end(); ++request_it)
+    {
+        MPI_Wait(&(*request_it), MPI_STATUS_IGNORE);
+    }
+    this->_requests.clear();
+    this->_headers.clear();
+}
+
+/*
+ * Returns the number of pairs sent.
+ */
+template <typename T>
+inline long long GraphPairSender<T>::getPairsSent()
+{
+    return this->_pairs_sent;
+}
+
+/*
+ * Returns the number of graphs sent, at most two per pair.
+ */
+template <typename T>
+inline long long GraphPairSender<T>::getGraphsSent()
+{
+    return this->_graphs_sent;
+}
+
+/*
+ * Returns the number of bytes of graph data sent.
+ */
+template <typename T>
+inline long long GraphPairSender<T>::getBytesSent()
+{
+    return this->_bytes_sent;
+}
+
+/*
+ * returns the number of bytes of the compact form of a graph, encodes it the first time
+ */
+template <typename T>
+inline int GraphPairSender<T>::_getCompactSize(int graph)
+{
+    if (this->_compact_forms[graph].empty())
+    {
+        int size = this->_graphs[graph]->getNumberOfRows();
+        this->_compact_forms[graph] = compact_encode<T>(*this->_graphs[graph], size, size, true);
+    }
+    return this->_compact_forms[graph].size();
+}
+
+/*
+ * starts sending a header and the graphs it announces
+ */
+template <typename T>
+inline void GraphPairSender<T>::_send(const std::vector<int>& header, int dest, int header_tag, int graph_tag)
+{
+    _release();
+    this->_headers.push_back(header);
+    this->_requests.push_back(MPI_Request());
+    MPI_Isend(&this->_headers.back()[0], 4, MPI_INT, dest, header_tag, MPI_COMM_WORLD, &this->_requests.back());
+    for (int k = 0; k < 2; k++)
+    {
+        if (header[2 + k] >= 0)
+        {
+            //the header list is kept in step with the request list
+            this->_headers.push_back(std::vector<int>());
+            this->_requests.push_back(MPI_Request());
+            MPI_Isend(&this->_compact_forms[header[k]][0], header[2 + k], MPI_BYTE, dest, graph_tag, MPI_COMM_WORLD, &this->_requests.back());
+            this->_graphs_sent++;
+            this->_bytes_sent += header[2 + k];
+        }
+    }
+}
+
+/*
+ * frees the headers of the sends that are complete
+ */
+template <typename T>
+inline void GraphPairSender<T>::_release()
+{
+    std::list<std::vector<int> >::iterator header_it = this->_headers.begin();
+    std::list<MPI_Request>::iterator request_it = this->_requests.begin();
+    while (request_it != this->_requests.end())
+    {
+        int done;
+        MPI_Test(&(*request_it), &done, MPI_STATUS_IGNORE);
+        if (done)
+        {
+            header_it = this->_headers.erase(header_it);
+            request_it = this->_requests.erase(request_it);
+        }
+        else
+        {
+            ++header_it;
+            ++request_it;
+        }
+    }
+}
+
+/*
+ * GraphCache class: the graphs a worker received, identified by their index.
+ */
+template <typename T>
+class GraphCache
+{
+private:
+    std::map<int, SymMatrix<T>*> _graphs;
+    long long _pairs_received;
+
+    SymMatrix<T>* _get(int graph, int num_bytes, int source, int graph_tag, MPI_Status& stat);
+
+public:
+    GraphCache();
+    virtual ~GraphCache();
+
+    bool receive(int source, int header_tag, int graph_tag, Graph_Pair_Job<SymMatrix<T> >& job, MPI_Status& stat);
+    int getNumberOfGraphs();
+    long long getPairsReceived();
+};
+
+/*
+ * Constructor: the cache is empty.
+ */
+template <typename T>
+inline GraphCache<T>::GraphCache()
+{
+    this->_pairs_received = 0;
+}
+
+/*
+ * Destructor: deletes the graphs, they must not be used anymore.
+ */
+template <typename T>
+inline GraphCache<T>::~GraphCache()
+{
+    typename std::map<int, SymMatrix<T>*>::iterator graph_it;
+    for (graph_it = this->_graphs.begin(); graph_it != this->_graphs.end(); ++graph_it)
+    {
+        delete graph_it->second;
+    }
+}
+
+/*
+ * Receives a pair of graphs sent by a GraphPairSender. Returns false if it was the terminate signal.
+ * The graphs of the job belong to the cache.
+ * @pram int: sender's ID
+ * @pram int: tag of the header
+ * @pram int: tag of the graphs
+ * @pram Graph_Pair_Job: set to the pair of graphs
+ * @pram MPI_Status: MPI_Status object
+ */
+template <typename T>
+inline bool GraphCache<T>::receive(int source, int header_tag, int graph_tag, Graph_Pair_Job<SymMatrix<T> >& job, MPI_Status& stat)
+{
+    int header[4];
+    MPI_Recv(header, 4, MPI_INT, source, header_tag, MPI_COMM_WORLD, &stat);
+    if (header[0] < 0)
+    {
+        return false;
+    }
+    job.graph_i = header[0];
+    job.graph_j = header[1];
+    job.graph_A = _get(header[0], header[2], source, graph_tag, stat);
+    job.graph_B = _get(header[1], header[3], source, graph_tag, stat);
+    this->_pairs_received++;
+    return true;
+}
+
+/*
+ * Returns the number of graphs in the cache.
+ */
+template <typename T>
+inline int GraphCache<T>::getNumberOfGraphs()
+{
+    return this->_graphs.size();
+}
+
+/*
+ * Returns the number of pairs received.
+ */
+template <typename T>
+inline long long GraphCache<T>::getPairsReceived()
+{
+    return this->_pairs_received;
+}
+
+/*
+ * returns a graph of the cache, receives it first if the header gave its number of bytes
+ */
+template <typename T>
+inline SymMatrix<T>* GraphCache<T>::_get(int graph, int num_bytes, int source, int graph_tag, MPI_Status& stat)
+{
+    if (num_bytes >= 0)
+    {
+        std::vector<unsigned char> compact_form(num_bytes);
+        MPI_Recv(&compact_form[0], num_bytes, MPI_BYTE, source, graph_tag, MPI_COMM_WORLD, &stat);
+        int rows, cols;
+        compact_size(compact_form, rows, cols);
+        SymMatrix<T>* matrix = new SymMatrix<T>(rows);
+        compact_decode<T>(compact_form, *matrix);
+        this->_graphs[graph] = matrix;
+    }
+    return this->_graphs[graph];
+}
+
+#endif
+
+#endif
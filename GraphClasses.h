@@ -0,0 +1,301 @@
+/************************************************************************************
+ * This file contains the deduplication of the corpus into isomorphism classes.     *
+ * Every graph is compared with the representatives of the classes whose WL         *
+ * certificate has the same hash (WLCertificate.h). It joins a class if it has the  *
+ * same content as the representative or if the mapping given by the certificates   *
+ * is verified to be an isomorphism; otherwise it starts a new class. Every graph   *
+ * keeps the mapping of its nodes to the nodes of its representative.              *
+ *                                                                                  *
+ * The all-pairs drivers then compute one pair per ordered pair of classes, the    *
+ * first pending pair (i, j) with class(i) = a and class(j) = b. The other pending  *
+ * pairs of (a, b) are derived from its result: the frobenius norm and the score    *
+ * are the same and the assignment is composed with the mappings of the graphs.    *
+ * The pairs of two graphs of the same class get the frobenius norm 0 right away.   *
+ ************************************************************************************/
+
+#ifndef _GraphClasses_h
+#define _GraphClasses_h
+
+#include <map>
+#include <vector>
+#include <utility>
+#include "WLCertificate.h"
+#include "ResultsStore.h"
+#include "Matrices/MPI_Structs.h"
+
+/*
+ * GraphClasses class: the isomorphism classes of the graphs and the pairs derived from the computed ones.
+ */
+class GraphClasses
+{
+private:
+    std::vector<int> _class_of;
+    std::vector<int> _representative;
+    std::vector<int> _size;
+    std::vector<int> _discrete;
+    std::vector<std::vector<int> > _to_representative;
+    std::vector<std::vector<int> > _from_representative;
+    std::map<std::pair<int, int>, std::vector<std::pair<int, int> > > _derived;
+    int _num_derived;
+
+    template <typename Matrix>
+    bool _sameContent(Matrix& graph1, Matrix& graph2);
+    IsoRank_Result _derive(const IsoRank_Result& computed, int graph_i, int graph_j);
+
+public:
+    GraphClasses();
+
+    template <typename Matrix>
+    void build(std::vector<Matrix*>& graphs, bool use_certificates);
+    std::vector<IsoRank_Result> plan(std::vector<char>& pair_done);
+    std::vector<IsoRank_Result> expand(const IsoRank_Result& computed);
+    int getNumberOfClasses();
+    int getNumberOfDiscreteGraphs();
+    int getNumberOfDerivedPairs();
+};
+
+/*
+ * Constructor: no graphs.
+ */
+inline GraphClasses::GraphClasses()
+{
+    this->_num_derived = 0;
+}
+
+/*
+ * Sorts the graphs into isomorphism classes.
+ * @pram std::vector<Matrix*>: the graphs
+ * @pram bool: true to join the classes by their WL certificates, false to only join graphs with the same content
+ */
+template <typename Matrix>
+inline void GraphClasses::build(std::vector<Matrix*>& graphs, bool use_certificates)
+{
+    int number_of_graphs = graphs.size();
+    this->_class_of.assign(number_of_graphs, -1);
+    this->_to_representative.assign(number_of_graphs, std::vector<int>());
+    this->_from_representative.assign(number_of_graphs, std::vector<int>());
+    this->_representative.clear();
+    this->_size.clear();
+    this->_discrete.assign(number_of_graphs, 0);
+
+    std::vector<WL_Certificate> certificates(number_of_graphs);
+    std::map<GraphHash, std::vector<int> > classes_by_hash;
+    for (int g = 0; g < number_of_graphs; g++)
+    {
+        certificates[g] = wl_certificate(*graphs[g]);
+        this->_discrete[g] = certificates[g].discrete ? 1 : 0;
+        int size = graphs[g]->getNumberOfRows();
+        std::vector<int>& candidates = classes_by_hash[certificates[g].hash];
+
+        std::vector<int> mapping;
+        for (int c = 0; c < candidates.size() && mapping.empty(); c++)
+        {
+            int representative = this->_representative[candidates[c]];
+            if (this->_size[candidates[c]] != size)
+            {
+                continue;
+            }
+            if (_sameContent(*graphs[g], *graphs[representative]))
+            {
+                mapping.resize(size);
+                for (int v = 0; v < size; v++)
+                {
+                    mapping[v] = v;
+                }
+            }
+            else if (use_certificates)
+            {
+                IsoRank_Result match;
+                if (wl_match(certificates[g], certificates[representative], *graphs[g], *graphs[representative], match))
+                {
+                    mapping.assign(match.assignments, match.assignments + size);
+                    delete [] match.assignments;
+                }
+            }
+            if (!mapping.empty())
+            {
+                this->_class_of[g] = candidates[c];
+            }
+        }
+
+        //a new class, the graph is its own representative
+        if (mapping.empty())
+        {
+            this->_class_of[g] = this->_representative.size();
+            candidates.push_back(this->_representative.size());
+            this->_representative.push_back(g);
+            this->_size.push_back(size);
+            mapping.resize(size);
+            for (int v = 0; v < size; v++)
+            {
+                mapping[v] = v;
+            }
+        }
+
+        this->_to_representative[g] = mapping;
+        this->_from_representative[g].resize(size);
+        for (int v = 0; v < size; v++)
+        {
+            this->_from_representative[g][mapping[v]] = v;
+        }
+    }
+}
+
+/*
+ * Chooses the pairs that are computed. The pending pairs of two graphs of the same class and the
+ * pending pairs derived from another pair are marked as done. Returns the results of the pairs of
+ * two graphs of the same class, their assignments are allocated with new.
+ * @pram std::vector<char>: the pairs that are done, in the order of pair_index
+ */
+inline std::vector<IsoRank_Result> GraphClasses::plan(std::vector<char>& pair_done)
+{
+    int number_of_graphs = this->_class_of.size();
+    std::vector<IsoRank_Result> results;
+    std::map<std::pair<int, int>, std::pair<int, int> > computed_pairs;
+    this->_derived.clear();
+    this->_num_derived = 0;
+
+    for (int i = 0; i < number_of_graphs; i++)
+    {
+        for (int j = i + 1; j < number_of_graphs; j++)
+        {
+            int index = pair_index(i, j, number_of_graphs);
+            if (pair_done[index])
+            {
+                continue;
+            }
+
+            if (this->_class_of[i] == this->_class_of[j])
+            {
+                IsoRank_Result result;
+                result.graph_i = i;
+                result.graph_j = j;
+                result.frob_norm = 0;
+                result.score = 0;
+                result.trials = 0;
+                result.assignment_length = this->_to_representative[i].size();
+                result.assignments = new int[result.assignment_length];
+                for (int v = 0; v < result.assignment_length; v++)
+                {
+                    result.assignments[v] = this->_from_representative[j][this->_to_representative[i][v]];
+                }
+                results.push_back(result);
+                pair_done[index] = 1;
+                continue;
+            }
+
+            std::pair<int, int> class_pair(this->_class_of[i], this->_class_of[j]);
+            std::map<std::pair<int, int>, std::pair<int, int> >::iterator computed_it = computed_pairs.find(class_pair);
+            if (computed_it == computed_pairs.end())
+            {
+                computed_pairs[class_pair] = std::make_pair(i, j);
+            }
+            else
+            {
+                this->_derived[computed_it->second].push_back(std::make_pair(i, j));
+                this->_num_derived++;
+                pair_done[index] = 1;
+            }
+        }
+    }
+    return results;
+}
+
+/*
+ * Returns the results of the pairs derived from a computed pair, their assignments are allocated with new.
+ * @pram IsoRank_Result: result of a pair that was computed
+ */
+inline std::vector<IsoRank_Result> GraphClasses::expand(const IsoRank_Result& computed)
+{
+    std::vector<IsoRank_Result> results;
+    std::map<std::pair<int, int>, std::vector<std::pair<int, int> > >::iterator derived_it =
+        this->_derived.find(std::make_pair(computed.graph_i, computed.graph_j));
+    if (derived_it == this->_derived.end())
+    {
+        return results;
+    }
+    for (int d = 0; d < derived_it->second.size(); d++)
+    {
+        results.push_back(_derive(computed, derived_it->second[d].first, derived_it->second[d].second));
+    }
+    return results;
+}
+
+/*
+ * Returns the number of classes.
+ */
+inline int GraphClasses::getNumberOfClasses()
+{
+    return this->_representative.size();
+}
+
+/*
+ * Returns the number of graphs whose WL partition is discrete.
+ */
+inline int GraphClasses::getNumberOfDiscreteGraphs()
+{
+    int discrete = 0;
+    for (int g = 0; g < this->_discrete.size(); g++)
+    {
+        discrete += this->_discrete[g];
+    }
+    return discrete;
+}
+
+/*
+ * Returns the number of pairs that are derived from a computed pair.
+ */
+inline int GraphClasses::getNumberOfDerivedPairs()
+{
+    return this->_num_derived;
+}
+
+/*
+ * returns true if two graphs of the same size have the same entries
+ */
+template <typename Matrix>
+inline bool GraphClasses::_sameContent(Matrix& graph1, Matrix& graph2)
+{
+    int size = graph1.getNumberOfRows();
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            if (graph1(i, j) != graph2(i, j))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/*
+ * returns the result of (graph_i, graph_j) derived from the result of a pair of the same classes. A node v
+ * of graph_i is the node of the computed graph_i that has the same node of the representative, its assignment
+ * is carried to graph_j the same way. Assignments past the end of the computed graph_j (padded nodes) are kept.
+ */
+inline IsoRank_Result GraphClasses::_derive(const IsoRank_Result& computed, int graph_i, int graph_j)
+{
+    const std::vector<int>& to_i = this->_to_representative[graph_i];
+    const std::vector<int>& from_computed_i = this->_from_representative[computed.graph_i];
+    const std::vector<int>& to_computed_j = this->_to_representative[computed.graph_j];
+    const std::vector<int>& from_j = this->_from_representative[graph_j];
+
+    IsoRank_Result result;
+    result.graph_i = graph_i;
+    result.graph_j = graph_j;
+    result.frob_norm = computed.frob_norm;
+    result.score = computed.score;
+    result.trials = 0;
+    result.assignment_length = computed.assignment_length;
+    result.assignments = new int[result.assignment_length];
+    for (int v = 0; v < result.assignment_length; v++)
+    {
+        int w = computed.assignments[from_computed_i[to_i[v]]];
+        result.assignments[v] = (w >= 0 && w < to_computed_j.size()) ? from_j[to_computed_j[w]] : w;
+    }
+    return result;
+}
+
+#endif
@@ -0,0 +1,342 @@
+/************************************************************************************
+ * This file contains the in-memory index used by the query mode. For every graph   *
+ * in the corpus a signature of cheap invariants (sorted degree sequence, degree    *
+ * histogram, spectrum of the adjacency matrix and number of connected components)  *
+ * is computed once. A query graph is ranked against the corpus with these          *
+ * signatures and IsoRank is only run on the most promising candidates. The         *
+ * invariants also give lower bounds on the squared frobenius norm of any matching, *
+ * the value frobenius_score() returns, which are used to stop the search once no   *
+ * remaining candidate can enter the top k.                                         *
+ ************************************************************************************/
+
+#ifndef _GraphIndex_h
+#define _GraphIndex_h
+
+#include "Matrices/DenseMatrix1D.h"
+#include "IsoRank.h"
+#include "Tarjan.h"
+#include <vector>
+#include <iostream>
+#include <exception>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+/*
+ * struct used to store the invariants of a graph
+ */
+struct GraphSignature
+{
+    int num_nodes;
+    int num_edges;
+    int num_components;
+    std::vector<int> degrees;            //sorted in decreasing order
+    std::vector<int> degree_histogram;   //degree_histogram[d] = number of nodes with degree d
+    std::vector<double> spectrum;        //eigenvalues of the adjacency matrix in decreasing order
+};
+
+/*
+ * struct used to store a corpus graph considered by a query
+ */
+struct Query_Candidate
+{
+    int graph_id;
+    double lower_bound;
+    double distance;
+};
+
+/*
+ * struct used to store the result of a query for one corpus graph
+ */
+struct Query_Result
+{
+    int graph_id;
+    double lower_bound;
+    struct IsoRank_Result result;
+};
+
+/*
+ * returns the eigenvalues of a symmetric matrix in decreasing order
+ * using the cyclic Jacobi method. The matrix is overwritten.
+ * @pram: row major array of the matrix
+ * @pram: number of rows of the matrix
+ */
+std::vector<double> symmetric_eigenvalues(std::vector<double>& a, int n){
+    const int MAX_SWEEPS = 50;
+
+    for(int sweep=0;sweep<MAX_SWEEPS;sweep++){
+        double off_diagonal=0;
+        for(int p=0;p<n;p++){
+            for(int q=p+1;q<n;q++){
+                off_diagonal+=a[p*n+q]*a[p*n+q];
+            }
+        }
+        if(off_diagonal<1e-22){
+            break;
+        }
+
+        //rotate every off diagonal entry to 0
+        for(int p=0;p<n;p++){
+            for(int q=p+1;q<n;q++){
+                double a_pq=a[p*n+q];
+                if(std::fabs(a_pq)<1e-300){
+                    continue;
+                }
+                double theta=(a[q*n+q]-a[p*n+p])/(2*a_pq);
+                double t=(theta>=0?1.0:-1.0)/(std::fabs(theta)+std::sqrt(theta*theta+1));
+                double c=1/std::sqrt(t*t+1);
+                double s=t*c;
+
+                for(int k=0;k<n;k++){
+                    double a_kp=a[k*n+p];
+                    double a_kq=a[k*n+q];
+                    a[k*n+p]=c*a_kp-s*a_kq;
+                    a[k*n+q]=s*a_kp+c*a_kq;
+                }
+                for(int k=0;k<n;k++){
+                    double a_pk=a[p*n+k];
+                    double a_qk=a[q*n+k];
+                    a[p*n+k]=c*a_pk-s*a_qk;
+                    a[q*n+k]=s*a_pk+c*a_qk;
+                }
+            }
+        }
+    }
+
+    std::vector<double> eigenvalues(n);
+    for(int i=0;i<n;i++){
+        eigenvalues[i]=a[i*n+i];
+    }
+    std::sort(eigenvalues.begin(),eigenvalues.end(),std::greater<double>());
+    return eigenvalues;
+}
+
+/*
+ * computes the signature of a graph
+ * @pram: adjacency matrix of the graph
+ */
+template <typename T>
+GraphSignature compute_signature(DenseMatrix1D<T>& graph){
+    GraphSignature signature;
+    int n=graph.getNumberOfRows();
+    signature.num_nodes=n;
+    signature.num_edges=0;
+    signature.degrees.resize(n,0);
+
+    std::vector<double> adjacency(n*n);
+    for(int i=0;i<n;i++){
+        for(int j=0;j<n;j++){
+            adjacency[i*n+j]=graph(i,j);
+            if(graph(i,j)!=0){
+                signature.degrees[i]++;
+            }
+        }
+        signature.num_edges+=signature.degrees[i];
+    }
+    signature.num_edges/=2;
+
+    std::sort(signature.degrees.begin(),signature.degrees.end(),std::greater<int>());
+    signature.degree_histogram.resize((n>0?signature.degrees[0]:0)+1,0);
+    for(int i=0;i<n;i++){
+        signature.degree_histogram[signature.degrees[i]]++;
+    }
+
+    signature.spectrum=symmetric_eigenvalues(adjacency,n);
+
+    //count the components found by tarjan's algorithm
+    std::vector<vertex*> vertices=graph_con_com(graph);
+    std::vector<long> components;
+    for(int i=0;i<vertices.size();i++){
+        components.push_back(vertices[i]->get_low_link());
+        delete vertices[i];
+    }
+    std::sort(components.begin(),components.end());
+    signature.num_components=std::unique(components.begin(),components.end())-components.begin();
+
+    return signature;
+}
+
+/*
+ * returns a lower bound on the squared frobenius norm ||A - P*B*P'|| of any matching
+ * between two 0/1 graphs, where the smaller graph is padded with isolated nodes.
+ * Two bounds are used:
+ *      degree bound: every mismatched entry changes the degree of one node by 1, so the
+ *      norm is at least the L1 distance of the sorted degree sequences.
+ *      spectral bound (Hoffman-Wielandt): the norm is at least the squared L2 distance
+ *      of the sorted spectra.
+ * @pram: signature of graph A
+ * @pram: signature of graph B
+ */
+double frob_lower_bound(const GraphSignature& sig_A, const GraphSignature& sig_B){
+    int size=std::max(sig_A.num_nodes,sig_B.num_nodes);
+
+    //padded nodes have degree 0 and are at the end of the sorted sequence
+    double degree_bound=0;
+    for(int i=0;i<size;i++){
+        int d_A=(i<sig_A.num_nodes)?sig_A.degrees[i]:0;
+        int d_B=(i<sig_B.num_nodes)?sig_B.degrees[i]:0;
+        degree_bound+=std::abs(d_A-d_B);
+    }
+
+    //padded nodes add zero eigenvalues
+    std::vector<double> spectrum_A(sig_A.spectrum);
+    std::vector<double> spectrum_B(sig_B.spectrum);
+    spectrum_A.resize(size,0);
+    spectrum_B.resize(size,0);
+    std::sort(spectrum_A.begin(),spectrum_A.end(),std::greater<double>());
+    std::sort(spectrum_B.begin(),spectrum_B.end(),std::greater<double>());
+    double spectral_bound=0;
+    for(int i=0;i<size;i++){
+        spectral_bound+=(spectrum_A[i]-spectrum_B[i])*(spectrum_A[i]-spectrum_B[i]);
+    }
+
+    return std::max(degree_bound,spectral_bound);
+}
+
+/*
+ * returns a dissimilarity between two signatures that is used to order
+ * candidates with the same lower bound
+ * @pram: signature of graph A
+ * @pram: signature of graph B
+ */
+double signature_distance(const GraphSignature& sig_A, const GraphSignature& sig_B){
+    double distance=std::abs(sig_A.num_nodes-sig_B.num_nodes)+std::abs(sig_A.num_edges-sig_B.num_edges)
+                    +std::abs(sig_A.num_components-sig_B.num_components);
+
+    int histogram_size=std::max(sig_A.degree_histogram.size(),sig_B.degree_histogram.size());
+    for(int d=0;d<histogram_size;d++){
+        int h_A=(d<sig_A.degree_histogram.size())?sig_A.degree_histogram[d]:0;
+        int h_B=(d<sig_B.degree_histogram.size())?sig_B.degree_histogram[d]:0;
+        distance+=std::abs(h_A-h_B);
+    }
+
+    int spectrum_size=std::min(sig_A.spectrum.size(),sig_B.spectrum.size());
+    for(int i=0;i<spectrum_size;i++){
+        distance+=std::fabs(sig_A.spectrum[i]-sig_B.spectrum[i]);
+    }
+    return distance;
+}
+
+/*
+ * compares two candidates by their lower bound and breaks ties by the distance
+ */
+bool compare_candidates(const Query_Candidate& a, const Query_Candidate& b){
+    if(a.lower_bound==b.lower_bound){
+        return a.distance<b.distance;
+    }
+    return a.lower_bound<b.lower_bound;
+}
+
+/*
+ * compares two query results by their frobenius norm
+ */
+bool compare_query_results(const Query_Result& a, const Query_Result& b){
+    return a.result.frob_norm<b.result.frob_norm;
+}
+
+/*
+ * GraphIndex class: keeps the signatures of the corpus graphs in memory.
+ */
+class GraphIndex
+{
+private:
+    std::vector<int> _ids;
+    std::vector<GraphSignature> _signatures;
+
+public:
+    /*
+     * adds a graph to the index
+     * @pram: id of the graph
+     * @pram: adjacency matrix of the graph
+     */
+    template <typename T>
+    void add(int id, DenseMatrix1D<T>& graph)
+    {
+        _ids.push_back(id);
+        _signatures.push_back(compute_signature(graph));
+    }
+
+    /*
+     * returns the number of graphs in the index
+     */
+    int size()
+    {
+        return _ids.size();
+    }
+
+    /*
+     * returns all graphs of the index ordered from the most to the least promising
+     * candidate for matching the query
+     * @pram: signature of the query graph
+     */
+    std::vector<Query_Candidate> rank(const GraphSignature& query)
+    {
+        std::vector<Query_Candidate> candidates(_ids.size());
+        for(int i=0;i<_ids.size();i++){
+            candidates[i].graph_id=_ids[i];
+            candidates[i].lower_bound=frob_lower_bound(query,_signatures[i]);
+            candidates[i].distance=signature_distance(query,_signatures[i]);
+        }
+        std::sort(candidates.begin(),candidates.end(),compare_candidates);
+        return candidates;
+    }
+};
+
+/*
+ * returns the k corpus graphs that best match the query graph, ordered by frobenius norm.
+ * Candidates are visited in increasing order of their lower bound, so the search stops as soon
+ * as the lower bound of the next candidate is not better than the k-th best result found.
+ * A candidate whose isoRank() throws is skipped, like a failed pair of the all-pairs drivers.
+ * @pram: adjacency matrix of the query graph
+ * @pram: corpus graphs, indexed by the graph ids used in the index
+ * @pram: index of the corpus
+ * @pram: number of results
+ * @pram: the matching algorithm used to choose the best node to node mapping
+ * @pram: set to the number of times isoRank was called
+ * @pram: eigen solver backend of the components, chosen by their size by default
+ * @pram: tolerance of the residual of the Lanczos backend
+ * @pram: limits of the restarts of the matching algorithm
+ * @pram: budget of the local search that refines every matching
+ * @pram: seed of the random streams, the query is keyed as graph -1
+ */
+template <typename T>
+std::vector<Query_Result> top_k_query(DenseMatrix1D<T>& query, std::vector<DenseMatrix1D<T>* >& corpus, GraphIndex& index,
+                                      int k, int matching_algorithm, int* num_evaluated,
+                                      int eigen_backend=EIGEN_BACKEND_AUTO, double eigen_tolerance=1e-6,
+                                      const RestartPolicy& restarts=RestartPolicy(),
+                                      const LocalSearchPolicy& local_search=LocalSearchPolicy(),
+                                      unsigned long long seed=0){
+    std::vector<Query_Candidate> candidates=index.rank(compute_signature(query));
+    std::vector<Query_Result> results;
+    *num_evaluated=0;
+
+    for(int c=0;c<candidates.size();c++){
+        if(results.size()==k&&candidates[c].lower_bound>=results[k-1].result.frob_norm){
+            break;
+        }
+
+        Query_Result query_result;
+        query_result.graph_id=candidates[c].graph_id;
+        query_result.lower_bound=candidates[c].lower_bound;
+        try{
+            query_result.result=isoRank(query,*corpus[candidates[c].graph_id],matching_algorithm,eigen_backend,eigen_tolerance,restarts,local_search,
+                                        pair_stream(seed,-1,candidates[c].graph_id));
+        }
+        catch(std::exception& e){
+            std::cerr<<" Exception: "<<e.what()<<std::endl;
+            continue;
+        }
+        (*num_evaluated)++;
+
+        //keep the k best results sorted
+        results.push_back(query_result);
+        std::stable_sort(results.begin(),results.end(),compare_query_results);
+        if(results.size()>k){
+            delete []results.back().result.assignments;
+            results.pop_back();
+        }
+    }
+    return results;
+}
+
+#endif
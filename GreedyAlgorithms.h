@@ -19,6 +19,7 @@
 #include <cmath>
 #include "Matrices/DenseMatrix1D.h"
 #include "GreedyAlgorithmsHelper.h"
+#include "Arena.h"
 #include <limits>
 
 
@@ -31,9 +32,14 @@
  * @pram: adjacency matrix of graph1
  * @pram: adjacency matrix of graph2
  * @pram: array that indicates the final mappings done
+ * @pram: context of the current pair, the scratch memory is released when the matching returns and
+ *        the ties are broken with its random stream
  */
-template <typename DT>
-void greedy_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMatrix1D<float>& graph2,int* assignment){
+template <typename DT, typename Graph>
+void greedy_1(DenseMatrix1D<DT>& matches, Graph& graph1, Graph& graph2,int* assignment,MatchContext& context){
+    Arena& arena=context.arena;
+    RandomStream& random=context.random;
+    Arena::Marker start=arena.mark();
     DT total_score=0;
     int graph1_nodes=matches.getNumberOfRows();
     int graph2_nodes=matches.getNumberOfColumns();
@@ -42,19 +48,23 @@ void greedy_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMat
     int max_value;
     int row,col;
     
-    //initialize assignment array
+    //initialize assignment array, the rows that are assigned are skipped by return_max
     init_array(assignment,graph1_nodes,-1);
+    char* assigned_rows=arena.allocateFilled<char>(graph1_nodes,0);
     
     for(int i=0;i<min(graph1_nodes,graph2_nodes);i++){
         
         //get maximum score in matrix and set assignment
-        return_max(matches,&total_score,&row,&col);
+        if(return_max(matches,&total_score,&row,&col,random,assigned_rows)<0)
+            break;
         invalidate(row,col,matches);
         assignment[row]=col;
+        assigned_rows[row]=1;
         
     }
     
     match_rest(assignment,graph1,graph2);
+    arena.rewind(start);
 }
 
 
@@ -65,10 +75,14 @@ void greedy_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMat
  * @pram: adjacency matrix for graph1
  * @pram: adjacency matrix for graph2
  * @pram: pointer to the array that indicates the best matching
+ * @pram: context of the current pair, the scratch memory is released when the matching returns and
+ *        the ties are broken with its random stream
  */
-template<typename DT>
-void greedy_connectivity_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMatrix1D<float>& graph2,int* assignment){
-    
+template <typename DT, typename Graph>
+void greedy_connectivity_1(DenseMatrix1D<DT>& matches, Graph& graph1, Graph& graph2,int* assignment,MatchContext& context){
+    Arena& arena=context.arena;
+    RandomStream& random=context.random;
+    Arena::Marker start=arena.mark();
     DT total_score=0;
     int graph1_nodes=matches.getNumberOfRows();
     int graph2_nodes=matches.getNumberOfColumns();
@@ -77,15 +91,18 @@ void greedy_connectivity_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     
     int row,col;
     
-    //initialize assignment array
+    //initialize assignment array, the rows that are assigned are skipped by return_max
     init_array(assignment,graph1_nodes,-1);
+    char* assigned_rows=arena.allocateFilled<char>(graph1_nodes,0);
     
     
     for(int i=0;i<min(graph1_nodes,graph2_nodes);i++){
         
-        //find maximum in scores matrix and perform assignment
-        return_max(matches,&total_score,&row,&col);
+        //find maximum in scores matrix and perform assignment, the enforcement can invalidate every pair
+        if(return_max(matches,&total_score,&row,&col,random,assigned_rows)<0)
+            break;
         assignment[row]=col;
+        assigned_rows[row]=1;
         invalidate(row,col,matches);
         
         //change matrix s.t. only neighbors of row are allowed to
@@ -94,6 +111,7 @@ void greedy_connectivity_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     }
     
     match_rest(assignment,graph1,graph2);
+    arena.rewind(start);
 }
 
 
@@ -104,12 +122,17 @@ void greedy_connectivity_1(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
  * @pram: adjacency matrix for graph1
  * @pram: adjacency matrix for graph2
  * @pram: pointer to the array that indicates the best matching
+ * @pram: context of the current pair, the scratch memory is released when the matching returns and
+ *        the ties are broken with its random stream
  */
-template<typename DT>
-void greedy_connectivity_2(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMatrix1D<float>& graph2,int* assignment){
+template <typename DT, typename Graph>
+void greedy_connectivity_2(DenseMatrix1D<DT>& matches, Graph& graph1, Graph& graph2,int* assignment,MatchContext& context){
+    Arena& arena=context.arena;
+    RandomStream& random=context.random;
+    Arena::Marker start=arena.mark();
     
-    DT max_tol=pow(10,-6),max;
-    DT score=0,prev_score=0,final_score=0;
+    DT max_tol=pow(10,-6);
+    DT score=0;
     
     int graph1_nodes=graph1.getNumberOfColumns();
     int graph2_nodes=graph2.getNumberOfColumns();
@@ -120,36 +143,42 @@ void greedy_connectivity_2(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     init_array(assignment,graph1_nodes,-1);
     init_array(assignment2,graph1_nodes,0);
     
-    DenseMatrix1D<DT>* active_matches=new DenseMatrix1D<DT>(matches);
-    DT* idxarr;
+    DenseMatrix1D<DT> active_matches(arena.allocate<DT>(matches.getNumberOfRows()*matches.getNumberOfColumns()),matches.getNumberOfRows(),matches.getNumberOfColumns());
+    active_matches=matches;
+    Arena::Marker iteration=arena.mark();
     std::vector<int> assigned_G1;
     int size=0,random_id,vector_size=0,curr_row;
     
     
     //run while loop until all nodes are assigned and scores matrix isn't all negative
-    while(sum_array(assignment2,graph1_nodes)<min(graph1_nodes,graph2_nodes)&& return_max(*active_matches,&score,&row,&col)>-1)
+    while(sum_array(assignment2,graph1_nodes)<min(graph1_nodes,graph2_nodes))
     {
         
-        if(all_inf(*active_matches)){
+        //the largest score of this iteration, taken on its own so it is not lost in the rounding of the running sum
+        DT max_score=0;
+        if(return_max(active_matches,&max_score,&row,&col,random)<0||all_inf(active_matches)){
             match_rest(assignment,graph1,graph2);
-            printf("score of matching: %f\n", final_score);
+            arena.rewind(start);
             return;
         }
         
         //find all values in scores matrix greater than a certain amount
-        idxarr=find_values(*active_matches, score-prev_score-max_tol,&size);
-        random_id=rand()%size+1;
-        max= get_Max(active_matches,random_id,score-prev_score-max_tol,&row,&col);
+        score+=max_score;
+        find_values(active_matches, max_score-max_tol,&size,arena);
+        arena.rewind(iteration);
+        if(size>1)
+            random.ties()++;
+        random_id=random.below(size)+1;
+        get_Max(&active_matches,random_id,max_score-max_tol,&row,&col);
         
         //perform assignment by choosing a random pair thats high enough
-        final_score+=max;
         assignment[row]=col;
         assignment2[row]=1;
         
         assigned_G1.push_back(row);
         vector_size++;
         invalidate(row, col, matches);
-        set_to_min(*active_matches);
+        set_to_min(active_matches);
         int curr_col;
         
         //change scores matrix such that only neighbors of already matched
@@ -160,12 +189,11 @@ void greedy_connectivity_2(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
             curr_col=assignment[curr_row];
             std::vector<int> neigh_1= graph1.getNeighbors(curr_row);
             std::vector<int> neigh_2= graph2.getNeighbors(curr_col);
-            set_matrix_values(*active_matches,matches,neigh_1,neigh_2);
+            set_matrix_values(active_matches,matches,neigh_1,neigh_2);
         }
-        
-        prev_score=score;
+
     }
-    
+    arena.rewind(start);
 }
 
 
@@ -176,9 +204,14 @@ void greedy_connectivity_2(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
  * @pram: adjacency matrix for graph1
  * @pram: adjacency matrix for graph2
  * @pram: pointer to the array that indicates the best matching
+ * @pram: context of the current pair, the scratch memory is released when the matching returns and
+ *        the ties are broken with its random stream
  */
-template<typename DT>
-void greedy_connectivity_3(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMatrix1D<float>& graph2,int* assignment){
+template <typename DT, typename Graph>
+void greedy_connectivity_3(DenseMatrix1D<DT>& matches, Graph& graph1, Graph& graph2,int* assignment,MatchContext& context){
+    Arena& arena=context.arena;
+    RandomStream& random=context.random;
+    Arena::Marker start=arena.mark();
     
     DT total_score=0;
     DT final_score=0;
@@ -188,13 +221,14 @@ void greedy_connectivity_3(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     int assignment2[graph1.getNumberOfRows()];
     int assignment_G1[graph1.getNumberOfRows()];
     int assignment_G2[graph2.getNumberOfRows()];;
-    DenseMatrix1D<DT>* local_matches=new DenseMatrix1D<DT>(matches);
+    DenseMatrix1D<DT> local_matches(arena.allocate<DT>(matches.getNumberOfRows()*matches.getNumberOfColumns()),matches.getNumberOfRows(),matches.getNumberOfColumns());
+    local_matches=matches;
     
     //initialize all arrays
     init_array(assignment,graph1_nodes,-1);
     init_array(assignment2,graph1_nodes,0);
     init_array(assignment_G1,graph1_nodes,0);
-    init_array(assignment_G2,graph1_nodes,0);
+    init_array(assignment_G2,graph2_nodes,0);
     
     std::vector<int> neigh_1;
     std::vector<int> neigh_2;
@@ -203,7 +237,7 @@ void greedy_connectivity_3(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     while(sum_array(assignment2,graph1_nodes)<min(graph1_nodes,graph2_nodes)){
         
         //find the highest matching score and make that assignment
-        return_max(matches, &final_score,&row,&col);
+        return_max(matches,&final_score,&row,&col,random);
         assignment[row]=col;
         assignment2[row]=1;
         assignment_G1[row]=1;
@@ -219,34 +253,36 @@ void greedy_connectivity_3(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
         invalidate_neighbors(assignment_G1,neigh_1);
         invalidate_neighbors(assignment_G2,neigh_2);
         
-        set_to_min(*local_matches);
-        set_matrix_values(*local_matches,matches,neigh_1,neigh_2);
+        set_to_min(local_matches);
+        set_matrix_values(local_matches,matches,neigh_1,neigh_2);
         int row_inside= row;
         int col_inside=col;
         
         //if scores matrix is all -inf match unassigned nodes and return
         if(all_inf(matches)){
             match_rest(assignment,graph1,graph2);
+            arena.rewind(start);
             return;
         }
         
         //run for loop until all neighbors are assigned and score matrix isn't all -inf
-        for(int i=0;i<min(neigh_1.size(),neigh_2.size())&&!all_inf(*local_matches);i++){
+        for(int i=0;i<min(neigh_1.size(),neigh_2.size())&&!all_inf(local_matches);i++){
             
             //find best nodal pairing and perform assignment
-            return_max(*local_matches,&final_score,&row,&col);
+            return_max(local_matches,&final_score,&row,&col,random);
             assignment[row]=col;
             assignment2[row]=1;
             assignment_G1[row]=1;
             assignment_G2[col]=1;
             
             //invalidate already assigned nodes from further consideration
-            invalidate(row,col,*local_matches);
+            invalidate(row,col,local_matches);
             invalidate(row,col,matches);
             
             //if scores matrix is all -inf match unassigned nodes and return
             if(all_inf(matches)){
                 match_rest(assignment,graph1,graph2);
+                arena.rewind(start);
                 return;
             }
             
@@ -254,6 +290,7 @@ void greedy_connectivity_3(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     }
     
     match_rest(assignment,graph1,graph2);
+    arena.rewind(start);
     return;
 }
 
@@ -265,13 +302,18 @@ void greedy_connectivity_3(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
  * @pram: adjacency matrix for graph1
  * @pram: adjacency matrix for graph2
  * @pram: pointer to the array that indicates the best matching
+ * @pram: context of the current pair, the scratch memory is released when the matching returns and
+ *        the ties are broken with its random stream
  */
-template <typename DT>
-void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& graph1, DenseMatrix1D<float>& graph2,int* assignment){
+template <typename DT, typename Graph>
+void greedy_connectivity_4(DenseMatrix1D<DT>& matches, Graph& graph1, Graph& graph2,int* assignment,MatchContext& context){
+    Arena& arena=context.arena;
+    RandomStream& random=context.random;
+    Arena::Marker start=arena.mark();
     
     DT final_score=0;
-    int* add_order=new int[graph1.getNumberOfRows()];
-    int* ass=new int[graph1.getNumberOfRows()];
+    int* add_order=arena.allocate<int>(graph1.getNumberOfRows());
+    int* ass=arena.allocate<int>(graph1.getNumberOfRows());
     int add_idx=0;
     DT score=0;
     DT max_tol=pow(10,-6);
@@ -290,12 +332,15 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     init_array(assigned_G2,graph2.getNumberOfRows(),-1);
     
     //set row and col to be the nodes that have the highest score
-    return_max(matches, &score,&row,&col);
+    return_max(matches,&score,&row,&col,random);
     
     //fill up idx_array values in scores matrix that are
     //greater than score - max_tol and choose one randomly to assign
-    DT* idx_array =find_values(matches,score - max_tol,&size);
-    int random_id=rand()%size+1;
+    Arena::Marker iteration=arena.mark();
+    DT* idx_array =find_values(matches,score - max_tol,&size,arena);
+    if(size>1)
+        random.ties()++;
+    int random_id=random.below(size)+1;
     DT max= get_Max(&matches,random_id,score-max_tol,&row,&col);
     
     //assign first row column pair
@@ -309,7 +354,7 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     
     neigh_1= graph1.getNeighbors(row);
     neigh_2= graph2.getNeighbors(col);
-    delete []idx_array;
+    arena.rewind(iteration);
     
     
     int hold;
@@ -321,26 +366,29 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
     
     
     //create local score matrix and only set the values for the pairs we're considering
-    DenseMatrix1D<DT>* matches_local=new DenseMatrix1D<DT>(matches.getNumberOfRows(),matches.getNumberOfColumns());
-    set_matrix_values(*matches_local, matches, neigh_1, neigh_2);
+    DenseMatrix1D<DT> matches_local(arena.allocateFilled<DT>(matches.getNumberOfRows()*matches.getNumberOfColumns(),0),matches.getNumberOfRows(),matches.getNumberOfColumns());
+    set_matrix_values(matches_local, matches, neigh_1, neigh_2);
+    iteration=arena.mark();
     
     score=0;
     size=0;
-    return_max(*matches_local, &score,&row,&col);
-    idx_array=find_values(*matches_local,score-max_tol,&size);
-    random_id=rand()%size+1;
-    max=get_Max(matches_local,random_id,score-max_tol,&row,&col);
+    return_max(matches_local,&score,&row,&col,random);
+    idx_array=find_values(matches_local,score-max_tol,&size,arena);
+    if(size>1)
+        random.ties()++;
+    random_id=random.below(size)+1;
+    max=get_Max(&matches_local,random_id,score-max_tol,&row,&col);
     
     //assign the second row and column pair
     final_score+=max;
     assignment[row]=col;
     assigned_G1[row]=1;
     assigned_G2[col]=1;
-    invalidate(row,col,*matches_local);
+    invalidate(row,col,matches_local);
     invalidate(row,col,matches);
     add_order[1]=row;
     
-    delete []idx_array;
+    arena.rewind(iteration);
     
     int counter=0;
     int rows_cols_size;
@@ -364,13 +412,12 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
             score=0;
             
             //finds all node pairings that are above a certain score and stores them in array rows_cols
-            return_max(*matches_local,&score,&row,&col);
-            idx_array=find_values(*matches_local,score-max_tol,&size);
+            return_max(matches_local,&score,&row,&col,random);
+            idx_array=find_values(matches_local,score-max_tol,&size,arena);
             
             valid_entries_size=0;
             valid_entries2_size=0;
-            rows_cols=find_all_values(*matches_local,idx_array,size,&rows_cols_size);
-            delete []idx_array;
+            rows_cols=find_all_values(matches_local,idx_array,size,&rows_cols_size,arena);
             
             //if number of nodal pairings with a high score is greater than 1
             if(size>1) {
@@ -400,7 +447,9 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
                 
                 //find the node best_row with highest connectivity to match
                 std::vector<int> *max_g1c=vector_max(&g1c_count);
-                int rand_number = rand()%(max_g1c->size());
+                if(max_g1c->size()>1)
+                    random.ties()++;
+                int rand_number = random.below(max_g1c->size());
                 best_row=(*max_g1c)[rand_number];
                 std::vector<int>* best_cols= new std::vector<int>();
                 int best_cols_counter=0;
@@ -438,7 +487,9 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
                 }
                 
                 std::vector<int> *max_g2c=vector_max(&g2c_count);
-                rand_number = rand()%(max_g2c->size());
+                if(max_g2c->size()>1)
+                    random.ties()++;
+                rand_number = random.below(max_g2c->size());
                 best_col=(*max_g2c)[rand_number];
                 
                 
@@ -458,11 +509,7 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
                 best_col=cp->col;
             }
             else{	 
-                for(int x=0;x<rows_cols_size;x++){
-                    free(rows_cols[x]);
-                }
-                
-                delete []rows_cols; 
+                arena.rewind(iteration);
                 break;
             }
             
@@ -475,18 +522,13 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
             DT max_matches=matches(best_row, best_col);
             add_order[add_order_counter]=best_row;
             add_order_counter++;
-            invalidate(best_row,best_col,*matches_local);
+            invalidate(best_row,best_col,matches_local);
             invalidate(best_row,best_col,matches);
             
             
             final_score+=max_matches;
             
-            
-            for(int x=0;x<rows_cols_size;x++){
-                free(rows_cols[x]);
-            }
-            
-            delete []rows_cols; 
+            arena.rewind(iteration);
             
         } //for min(neigh1, neigh2) 
         
@@ -513,7 +555,7 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
         
         
         
-        set_matrix_values(*matches_local, matches, neigh_1, neigh_2);
+        set_matrix_values(matches_local, matches, neigh_1, neigh_2);
         counter++;
         
         
@@ -526,9 +568,7 @@ void greedy_connectivity_4(DenseMatrix1D<DT>& matches, DenseMatrix1D<float>& gra
             break;
         }
     }
-    delete matches_local;
-    delete []ass;
-    delete []add_order;
+    arena.rewind(start);
 }
 
 #endif
@@ -16,14 +16,17 @@
 #include <vector>
 #include <cmath>
 #include "Matrices/DenseMatrix1D.h"
+#include "Arena.h"
 #include <limits>
 
 
 
 
 std::vector<int>* intersect(int*, int, struct coordinate_pair**,int);
-void match_rest(int*, DenseMatrix1D<float>&, DenseMatrix1D<float>&);
-int* get_valid_entries(DenseMatrix1D<float>, int*,int,int*);
+template <typename Graph>
+void match_rest(int*, Graph&, Graph&);
+template <typename Graph>
+int* get_valid_entries(Graph&, int*,int,int*);
 std::vector<int>* choose_cols(struct coordinate_pair**,int,int);
 
 
@@ -38,7 +41,6 @@ struct coordinate_pair{
 };
 
 
-
 /*
  * compares two floats and returns whether
  * an integer to indicate which is bigger
@@ -49,7 +51,7 @@ struct coordinate_pair{
 int compareFloats(float a, float b){
     float smallest_float= std::numeric_limits<float>::epsilon();
     
-    if(abs(a-b)<smallest_float){
+    if(std::fabs(a-b)<smallest_float){
         return 0;
     }
     else if(a-b>0)
@@ -82,35 +84,20 @@ std::vector<int>* choose_cols(struct coordinate_pair** rc,int rc_size,int row){
 
 
 /*
- * returns a DenseMatrix1D Object which is a reshaped eigenvector
+ * reshapes an eigenvector into the scores matrix
  * @pram: a pointer to an array of doubles which represents the eigenvector
- * @pram: number of rows in the matrix returned
- * @pram: number of columns in the matrix returned
- * @pram: component mask std::vector indicating which nodes are present in current component
+ * @pram: nodes of the kronecker product that are in the current component, in increasing order
+ * @pram: number of nodes in the current component
+ * @pram: the scores matrix, filled with 0's, the nodes that are not in the component keep a score of 0
  */
 template <typename DT>
-DenseMatrix1D<DT> reshape(DT* eigenvector,const int rows,const int cols, std::vector<int> &comp_mask){
-    
-    DenseMatrix1D<DT> matrix(rows,cols);
-    int counter_eig_vector=0;
-    int counter_comp_mask=0;
-    
+void reshape(DT* eigenvector, const int* members, int num_members, DenseMatrix1D<DT>& matrix){
     
-    for(int i=0;i<matrix.getNumberOfRows();i++){
-        for(int j=0;j<matrix.getNumberOfColumns();j++){
-            if(comp_mask[counter_comp_mask]==1){
-                matrix(i,j)=eigenvector[counter_eig_vector];
-                counter_eig_vector++;
-            }
-            else{
-                matrix(i,j)=0;
-            }
-            counter_comp_mask++;
-        }
+    int cols=matrix.getNumberOfColumns();
+    for(int k=0;k<num_members;k++){
+        matrix(members[k]/cols,members[k]%cols)=eigenvector[k];
     }
     
-    return matrix;
-    
 }
 
 
@@ -122,8 +109,8 @@ DenseMatrix1D<DT> reshape(DT* eigenvector,const int rows,const int cols, std::ve
  * @pram: adjacency matrix for graph2
  * @pram: matrix indicating scores for nodal pairs
  */
-template<typename DT>
-void neighbor_enforcement(int* row_index,int* col_index, DenseMatrix1D<float>& graph1,DenseMatrix1D<float>& graph2, DenseMatrix1D<DT>& matches){
+template <typename DT, typename Graph>
+void neighbor_enforcement(int* row_index,int* col_index, Graph& graph1, Graph& graph2, DenseMatrix1D<DT>& matches){
     
     
     for(int i=0;i<graph1.getNumberOfColumns();i++){
@@ -184,98 +171,53 @@ std::vector<int>* intersect(int* cols, int cols_size, struct coordinate_pair** r
  * @pram: size of assignments array
  * @pram: size of returned array
  */
-int* get_valid_entries(DenseMatrix1D<float> graph1, int* ass,int size,int* ret_size){
+template <typename Graph>
+int* get_valid_entries(Graph& graph1, int* ass,int size,int* ret_size){
     
-    std::vector<int> assigned;
-    DenseMatrix1D<float>* graph_copy=new DenseMatrix1D<float>(graph1);
-    
-    for(int i=0;i<size;i++){
+    //only the edges of nodes that are already assigned are considered for matching
+    std::vector<char> assigned(graph1.getNumberOfRows(),0);
+    for(int i=0;i<size&&i<graph1.getNumberOfRows();i++){
         if(ass[i]!=-1){
-            assigned.push_back(i);
-        }
-    }
-    int invalidate=1;
-    *ret_size=0;
-    
-    //invalidate certain nodes from consideration for matching
-    for(int i=0;i<graph_copy->getNumberOfRows();i++) {
-        
-        for(int k=0;k<assigned.size();k++){
-            if(assigned[k]==i){
-                invalidate=0;
-                break;
-            }
-        }
-        if(invalidate==1){
-            for(int j=0;j<graph_copy->getNumberOfColumns();j++){
-                (*graph_copy)(i,j)=-DBL_MAX;
-            }
-        }
-        else{
-            for(int j=0;j<graph_copy->getNumberOfColumns();j++){
-                if((*graph_copy)(i,j)==1)
-                    *ret_size=*ret_size+1;
-            }
-            invalidate=1;
+            assigned[i]=1;
         }
     }
     
-    int* ret_arr=new int[*ret_size];
-    int ret_arr_counter=0;
-    int counter=0;
-    
-    
+    std::vector<int> valid_entries;
     for(int j=0;j<graph1.getNumberOfRows();j++){
+        if(!assigned[j]){
+            continue;
+        }
         for(int i=0;i<graph1.getNumberOfColumns();i++){
-            if((*graph_copy)(j,i)==1){
-                ret_arr[ret_arr_counter]=i;
-                ret_arr_counter++;
+            if(graph1(j,i)==1){
+                valid_entries.push_back(i);
             }
-            counter++;
         }
     }
-    delete graph_copy;
     
+    *ret_size=valid_entries.size();
+    int* ret_arr=new int[*ret_size];
+    std::copy(valid_entries.begin(),valid_entries.end(),ret_arr);
     return ret_arr;
-    
 }
 
 
 /*
  * returns an array of coordinate_pair structs (r,c)
- * such that r,c in scores_matrix has a high score
+ * such that r,c in scores_matrix has a high score.
+ * The array and the pairs are taken from the arena of the current pair.
  * @pram: DenseMatrix1D that represents the nodal pairings scores
  * @pram: array of values that are high enough and in local_matches
  * @pram: size of array val
  * @pram: size of the array returned
+ * @pram: arena of the current pair
  */
 template <typename DT>
-struct coordinate_pair** find_all_values(DenseMatrix1D<DT>& local_matches,DT* val,int val_size,int* row_cols_size){
-    
-    int rows=local_matches.getNumberOfRows();
-    int cols=local_matches.getNumberOfColumns();
-    
-    int size=0;
-    DenseMatrix1D<DT>* local_matches_copy=new DenseMatrix1D<DT>(local_matches);
-    
-    //count the number of values that we wish to consider
-    for(int i=0;i<local_matches_copy->getNumberOfRows();i++){
-        for(int j=0;j<local_matches_copy->getNumberOfColumns();j++){
-            for(int k=0;k<val_size;k++){
-                if(compareFloats(val[k],(*local_matches_copy)(i,j))==0){
-                    (*local_matches_copy)(i,j)=-DBL_MAX;
-                    size++;
-                }
-            }
-        }
-    }
-    
-    delete local_matches_copy;
-    
-    local_matches_copy=new DenseMatrix1D<DT>(local_matches);
+struct coordinate_pair** find_all_values(DenseMatrix1D<DT>& local_matches,DT* val,int val_size,int* row_cols_size,Arena& arena){
+    PERF_SCOPE(PERF_SITE_FIND_ALL_VALUES);
     
     *row_cols_size=val_size;
-    struct coordinate_pair **ret_value= new struct coordinate_pair*[val_size];
+    struct coordinate_pair **ret_value= arena.allocate<struct coordinate_pair*>(val_size);
+    struct coordinate_pair *pairs= arena.allocate<struct coordinate_pair>(val_size);
     struct coordinate_pair *pair;
     int counter=0,val_counter=0,ret_val_counter=0;
     
@@ -283,7 +225,7 @@ struct coordinate_pair** find_all_values(DenseMatrix1D<DT>& local_matches,DT* va
     for(int i=0;i<local_matches.getNumberOfRows();i++){
         for(int j=0;j<local_matches.getNumberOfColumns();j++) {
             if(val_counter<val_size&&val[val_counter]==counter) {
-                pair=(struct coordinate_pair*)malloc(sizeof(struct coordinate_pair));
+                pair=&pairs[ret_val_counter];
                 pair->row=i;
                 pair->col=j;
                 ret_value[ret_val_counter]=pair;
@@ -293,7 +235,6 @@ struct coordinate_pair** find_all_values(DenseMatrix1D<DT>& local_matches,DT* va
             counter++;
         }
     }
-    delete local_matches_copy;
     return ret_value;
 }
 
@@ -363,13 +304,15 @@ void set_matrix_values(DenseMatrix1D<DT>& matrix1,DenseMatrix1D<DT>& matrix2,  s
 }
 
 /*
- * finds all the occurrences >= a certain value in the sparse matrix
+ * finds all the occurrences >= a certain value in the sparse matrix.
+ * The array returned is taken from the arena of the current pair.
  * @pram: Sparse Matrix we read in
  * @pram: value that we are comparing
  * @pram: the number of times the value shows up
+ * @pram: arena of the current pair
  */
 template <typename DT>
-DT* find_values(DenseMatrix1D<DT>& matches2,DT value,int *size){
+DT* find_values(DenseMatrix1D<DT>& matches2,DT value,int *size,Arena& arena){
     *size=0;
     
     //increments a counter to count the number of values in the matrix
@@ -383,7 +326,7 @@ DT* find_values(DenseMatrix1D<DT>& matches2,DT value,int *size){
         }
     }
     
-    DT* retarr= new DT[*size];
+    DT* retarr= arena.allocate<DT>(*size);
     
     int counter=0;
     int retarr_counter=0;
@@ -435,67 +378,99 @@ DT get_Max(DenseMatrix1D<DT> *matches, int id, DT val,int *row, int *col){
 
 
 /*
- * returns the column of the largest value in a matrix, breaks ties randomly
+ * returns the largest value of a row. Four running maxima are kept so the loop has no branch
+ * and no dependency between neighboring entries, the compiler can keep them in vector registers.
+ * Masked columns count as -DBL_MAX.
+ * @pram: first entry of the row
+ * @pram: number of entries of the row
+ * @pram: columns that are skipped (entry != 0), NULL for none
+ */
+template <typename DT>
+inline DT row_maximum(const DT* row, int cols, const char* col_mask){
+    DT max0=-DBL_MAX,max1=-DBL_MAX,max2=-DBL_MAX,max3=-DBL_MAX;
+    int j=0;
+    if(col_mask==NULL){
+        for(;j+4<=cols;j+=4){
+            max0=row[j]>max0?row[j]:max0;
+            max1=row[j+1]>max1?row[j+1]:max1;
+            max2=row[j+2]>max2?row[j+2]:max2;
+            max3=row[j+3]>max3?row[j+3]:max3;
+        }
+    }
+    for(;j<cols;j++){
+        DT value=(col_mask!=NULL&&col_mask[j])?-DBL_MAX:row[j];
+        max0=value>max0?value:max0;
+    }
+    max0=max1>max0?max1:max0;
+    max2=max3>max2?max3:max2;
+    return max2>max0?max2:max0;
+}
+
+/*
+ * returns the column of the largest value in a matrix, breaks ties randomly. The matrix is read once:
+ * the largest value of every row is found with row_maximum and only the rows that reach the largest
+ * value so far are scanned again, while they are still in the cache, to pick one of the ties by
+ * reservoir sampling (the k-th tie replaces the pick with probability 1/k, so every tie is equally
+ * likely without counting them first). Values closer than the float epsilon are ties, as in
+ * compareFloats. Entries set to -DBL_MAX are invalid, -1 is returned if every entry is invalid.
  * @pram: matrix that represents nodal pair scores
  * @pram: pointer to variable that is used to indicate how good matching is
  * @pram: pointer to row variable which we set to the row of the largest value
  * @pram: pointer to column variable which we set to the column of the largest value
+ * @pram: random stream of the trial, used to break the ties
+ * @pram: rows that are skipped (entry != 0), NULL for none
+ * @pram: columns that are skipped (entry != 0), NULL for none
  */
 
 template <typename DT>
-int return_max(DenseMatrix1D<DT>& matches, DT* total_score,int* max_row,int* max_col){
+int return_max(DenseMatrix1D<DT>& matches, DT* total_score,int* max_row,int* max_col,RandomStream& random,
+               const char* row_mask=NULL,const char* col_mask=NULL){
+    PERF_SCOPE(PERF_SITE_RETURN_MAX);
     
+    const DT tolerance=std::numeric_limits<float>::epsilon();
+    int rows=matches.getNumberOfRows();
+    int cols=matches.getNumberOfColumns();
     DT max_so_far=-DBL_MAX;
-    int max_so_far_count=1;
+    int max_so_far_count=0;
     *max_row=0;
     *max_col=0;
     
-    
-    //keeps track of the largest value in the scores matrix
-    //and keeps a count of the number of times the values occurs
-    for(int i=0; i<matches.getNumberOfRows();i++){
-        for(int j=0;j<matches.getNumberOfColumns();j++){
-            if(compareFloats(matches(i,j),max_so_far)==0){
-                max_so_far_count++;
+    for(int i=0;i<rows&&cols>0;i++){
+        if(row_mask!=NULL&&row_mask[i]){
+            continue;
+        }
+        const DT* row=&matches(i,0);
+        DT row_max=row_maximum(row,cols,col_mask);
+        if(row_max<=-DBL_MAX||row_max<max_so_far-tolerance){
+            continue;
+        }
+        
+        for(int j=0;j<cols;j++){
+            DT value=row[j];
+            if(value<=-DBL_MAX||(col_mask!=NULL&&col_mask[j])){
+                continue;
             }
-            else if(compareFloats(matches(i,j),max_so_far)==1){
-                max_so_far=matches(i,j);
+            if(value>max_so_far+tolerance){
+                max_so_far=value;
                 max_so_far_count=1;
+                *max_row=i;
+                *max_col=j;
             }
-        }
-        
-    }
-    
-    //choose a random occurrence of the maximum value
-    // to set max_row and max_col to
-    
-    int counter=0;
-    int random_number= rand()%max_so_far_count+1;
-    int set=0;
-    
-    for(int i=0; i<matches.getNumberOfRows();i++){
-        for(int j=0;j<matches.getNumberOfColumns();j++){
-            if(compareFloats(matches(i,j),max_so_far)==0){
-                counter++;
-                if(counter==random_number){
+            else if(value>=max_so_far-tolerance){
+                max_so_far_count++;
+                if(random.below(max_so_far_count)==0){
                     *max_row=i;
                     *max_col=j;
-                    set=1;
-                    break;
                 }
             }
-            
-            
         }
-        if(set==1)
-            break;
-        
     }
     
-    if(compareFloats(max_so_far,-DBL_MAX)==0) {
+    if(max_so_far_count==0) {
         return -1;
     }
-    
+    if(max_so_far_count>1)
+        random.ties()++;
     
     *total_score+=max_so_far;
     
@@ -526,7 +501,8 @@ void invalidate(int row, int col, DenseMatrix1D<DT>& matches){
  * @pram: DenseMatrix1D representing graph1
  * @pram: DenseMatrix1D representing graph2
  */
-void match_rest(int* assignment, DenseMatrix1D<float>& graph1, DenseMatrix1D<float>& graph2){
+template <typename Graph>
+void match_rest(int* assignment, Graph& graph1, Graph& graph2){
     
     if(graph1.getNumberOfRows()<=graph2.getNumberOfRows()){
         int unassigned_graph1[graph1.getNumberOfRows()];
@@ -637,6 +613,51 @@ DenseMatrix1D<float> getPermMatrix(int *ass, int ass_size,const int bigger_matri
     return ret_matrix;
 }
 
+/*
+ * returns the squared frobenius norm ||A - P*B*P'|| of a matching without building
+ * the permutation matrix. The smaller graph is padded with isolated nodes so both
+ * graphs have max(n1, n2) nodes, and nodes of graph1 that are mapped past the end of
+ * graph2 (see match_rest) are treated as padded nodes of graph2.
+ * @pram: array of assignments from nodes in graph1 to nodes in graph2
+ * @pram: adjacency matrix of graph1
+ * @pram: adjacency matrix of graph2
+ */
+template <template <typename> class Matrix, typename DT>
+DT frobenius_score(int* assignment, Matrix<DT>& graph1, Matrix<DT>& graph2){
+    int graph1_nodes=graph1.getNumberOfRows();
+    int graph2_nodes=graph2.getNumberOfRows();
+    int size=std::max(graph1_nodes,graph2_nodes);
+    std::vector<int> perm(size,-1);
+    std::vector<int> used(size,0);
+
+    for(int i=0;i<graph1_nodes;i++){
+        perm[i]=assignment[i];
+        if(assignment[i]>=0&&assignment[i]<size){
+            used[assignment[i]]=1;
+        }
+    }
+
+    //padded nodes of graph1 take the nodes of graph2 that were not assigned
+    int next_free=0;
+    for(int i=graph1_nodes;i<size;i++){
+        while(used[next_free]==1){
+            next_free++;
+        }
+        perm[i]=next_free;
+        used[next_free]=1;
+    }
+
+    DT ret_val=0;
+    for(int i=0;i<size;i++){
+        for(int k=0;k<size;k++){
+            DT a=(i<graph1_nodes&&k<graph1_nodes)?graph1(i,k):0;
+            DT b=(perm[i]<graph2_nodes&&perm[k]<graph2_nodes)?graph2(perm[i],perm[k]):0;
+            ret_val+=(a-b)*(a-b);
+        }
+    }
+    return ret_val;
+}
+
 /*
  * looks through the std::vector of nodes and removes the
  * ones that have already been assigned
@@ -659,6 +680,23 @@ void invalidate_neighbors(int* assignment, std::vector<int> neigh)
     
 }
 
+/*
+ * returns the sum of the scores of the node pairs chosen by a matching.
+ * Nodes of graph1 that are mapped past the end of the scores matrix are ignored.
+ * @pram: array of assignments from nodes in graph1 to nodes in graph2
+ * @pram: matrix indicating scores for nodal pairs
+ */
+template <typename DT>
+DT matching_score(int* assignment, DenseMatrix1D<DT>& scores){
+    DT total_score=0;
+    for(int i=0;i<scores.getNumberOfRows();i++){
+        if(assignment[i]>=0&&assignment[i]<scores.getNumberOfColumns()){
+            total_score+=scores(i,assignment[i]);
+        }
+    }
+    return total_score;
+}
+
 /*
  *initializes an array to have all indices set to init_val
  *@pram: array we wish to initialize
@@ -12,11 +12,19 @@
 #define _IsoRank_h
 
 #include "Matrices/DenseMatrix1D.h"
+#include "Matrices/SymMatrix.h"
+#include "Matrices/NormalizedOperator.h"
+#include "Matrices/EigenBackends.h"
 #include "Tarjan.h"
+#include "Arena.h"
 #include "Utilities.h"
 #include "GreedyAlgorithms.h"
 #include <vector>
+#include <cassert>
 #include "Matrices/MPI_Structs.h"
+#include "Profiler.h"
+#include "RestartPolicy.h"
+#include "LocalSearch.h"
 
 static const int GREEDY = 0;
 static const int CON_ENF_1 = 1;
@@ -24,16 +32,116 @@ static const int CON_ENF_2 = 2;
 static const int CON_ENF_3 = 3;
 static const int CON_ENF_4 = 4;
 
-const int NUM_OF_ISORANK_IT = 20;
 /*
- * function used to perform the isorank algorithm
+ * Matcher policies of the IsoRank engine: match() runs a matching algorithm of
+ * GreedyAlgorithms.h on the scores matrix and fills the assignment array. The
+ * scratch memory of the matching is taken from the arena of the context and the
+ * ties are broken with its random stream.
+ */
+struct Greedy_Matcher
+{
+    template <typename S, typename Graph>
+    static void match(DenseMatrix1D<S>& scores, Graph& graph1, Graph& graph2, int* assignment, MatchContext& context)
+    {
+        greedy_1(scores,graph1,graph2,assignment,context);
+    }
+};
+
+struct Connectivity_1_Matcher
+{
+    template <typename S, typename Graph>
+    static void match(DenseMatrix1D<S>& scores, Graph& graph1, Graph& graph2, int* assignment, MatchContext& context)
+    {
+        greedy_connectivity_1(scores,graph1,graph2,assignment,context);
+    }
+};
+
+struct Connectivity_2_Matcher
+{
+    template <typename S, typename Graph>
+    static void match(DenseMatrix1D<S>& scores, Graph& graph1, Graph& graph2, int* assignment, MatchContext& context)
+    {
+        greedy_connectivity_2(scores,graph1,graph2,assignment,context);
+    }
+};
+
+struct Connectivity_3_Matcher
+{
+    template <typename S, typename Graph>
+    static void match(DenseMatrix1D<S>& scores, Graph& graph1, Graph& graph2, int* assignment, MatchContext& context)
+    {
+        greedy_connectivity_3(scores,graph1,graph2,assignment,context);
+    }
+};
+
+struct Connectivity_4_Matcher
+{
+    template <typename S, typename Graph>
+    static void match(DenseMatrix1D<S>& scores, Graph& graph1, Graph& graph2, int* assignment, MatchContext& context)
+    {
+        greedy_connectivity_4(scores,graph1,graph2,assignment,context);
+    }
+};
+
+/*
+ * Scorer policies of the IsoRank engine: score() returns the cost of a matching,
+ * the restart with the smallest cost is kept.
+ */
+struct Frobenius_Scorer
+{
+    template <template <typename> class Matrix, typename T>
+    static T score(int* assignment, Matrix<T>& graph1, Matrix<T>& graph2)
+    {
+        return frobenius_score(assignment,graph1,graph2);
+    }
+};
+
+/*
+ * IsoRankEngine: the isorank algorithm for one combination of graph type (Matrix<T>, DenseMatrix1D or SymMatrix),
+ * score type S, matcher policy and scorer policy. The policies are resolved at compile time, so they can be
+ * inlined into the restart loop, and a new matcher is a new policy struct instead of a new case of a switch.
+ * Both graphs are symmetric so their kronecker product is too: it is built directly in the packed SymMatrix
+ * format, which takes half the memory and half the time of the full square, and the components are normalized
+ * and solved in that format. The eigenvectors are computed in T and the scores matrix is built in S.
+ * Every buffer that only lives while the pair is evaluated is taken from the arena of the MatchContext (Arena.h),
+ * which is reset at the start of run(); only the assignment of the result is allocated with new.
+ * The number of restarts of the matcher is decided by a RestartController (RestartPolicy.h). If the policy
+ * of the local search has a budget, every matching is refined by swaps of its nodes (LocalSearch.h) before
+ * it is compared with the best one.
+ */
+template <template <typename> class Matrix, typename T, typename S, typename Matcher, typename Scorer>
+class IsoRankEngine
+{
+public:
+    static IsoRank_Result run(Matrix<T>& matrix_A, Matrix<T>& matrix_B, MatchContext& context,
+                              int eigen_backend, double eigen_tolerance, const RestartPolicy& restarts,
+                              const LocalSearchPolicy& local_search, unsigned long long stream);
+};
+
+/*
+ * runs the isorank algorithm on a pair of graphs
  * @pram: adjacency matrix for graph1
  * @pram: adjacency matrix for graph2
- * @pram: the matching algorithm used to choose the best node to node mapping
+ * @pram: scratch memory of the calling thread, reset for this pair
+ * @pram: eigen solver backend of the components (EigenSolvers.h), EIGEN_BACKEND_AUTO to choose it by their size
+ * @pram: tolerance of the residual of the Lanczos backend
+ * @pram: limits of the restarts of the matcher
+ * @pram: budget of the local search that refines every matching
+ * @pram: key of the random streams of the pair, trial t draws from the stream (stream, t)
  */
-template <typename T>
-struct IsoRank_Result isoRank(DenseMatrix1D<T>& matrix_A, DenseMatrix1D<T>& matrix_B, int matching_algorithm)
+template <template <typename> class Matrix, typename T, typename S, typename Matcher, typename Scorer>
+IsoRank_Result IsoRankEngine<Matrix, T, S, Matcher, Scorer>::run(Matrix<T>& matrix_A, Matrix<T>& matrix_B, MatchContext& context,
+                                                               int eigen_backend, double eigen_tolerance,
+                                                               const RestartPolicy& restarts,
+                                                               const LocalSearchPolicy& local_search,
+                                                               unsigned long long stream)
 {
+    context.reset();
+    Arena& arena = context.arena;
+
+    ScopedTimer isorank_timer(PHASE_ISORANK);
+    Profiler::count(COUNTER_ISORANK_CALLS, 1);
+    
     //check to see both adjacency matrices are square and symmetric
     if (!matrix_A.isSquare() || !matrix_B.isSquare())
     {
@@ -45,48 +153,40 @@ struct IsoRank_Result isoRank(DenseMatrix1D<T>& matrix_A, DenseMatrix1D<T>& matr
         throw NotASymmetricMatrixException();
     }
     
-    // Degree distribution statistics
-    DenseMatrix1D<T> kron_prod = matrix_A.kron(matrix_B);
-    std::vector<vertex*> vertices = graph_con_com(kron_prod);
-    T** eigenValues = new T*[kron_prod.getNumberOfColumns()];
-    std::vector<std::vector<int>*> comp_mask_values (kron_prod.getNumberOfColumns());
+    //kronecker product of the two graphs, the node pair (i, k) is node i*n_B+k of the product
+    ScopedTimer kron_timer(PHASE_KRON);
+    SymMatrix<T> kron_prod = SymMatrix<T>(matrix_A).kron(SymMatrix<T>(matrix_B));
+    kron_timer.stop();
+    Profiler::count(COUNTER_KRON_NODES, kron_prod.getNumberOfRows());
+    
+    ScopedTimer scc_timer(PHASE_SCC);
+    std::vector<vertex*> vertices = graph_con_com(kron_prod, arena);
+    ComponentPartition components = component_partition(vertices);
+    scc_timer.stop();
+    int num_components = components.getNumberOfComponents();
+    std::vector<S*> eigenValues(num_components);
+    Profiler::count(COUNTER_COMPONENTS, num_components);
     
     //for each component find the eigenvector corresponding to the scores matrix
-    for(int i=0; i < kron_prod.getNumberOfColumns(); i++ )
+    for(int i=0; i < num_components; i++ )
     {
-        std::vector<int>* comp_mask = component_mask(vertices, i);
-        comp_mask_values[i] = comp_mask;
-        if (comp_mask == NULL)
-        {
-	  		eigenValues[i]=NULL;
-            continue;
-        }
-        
-        DenseMatrix1D<T> L = kron_prod.getScatteredSelection(*comp_mask,*comp_mask);
-        
-        std::vector<T> sum = L.getSumOfRows();
-        std::vector<T> D_neg1(sum.size());
-        std::vector<T> D_0pt5(sum.size());
-        std::vector<T> D_neg0pt5(sum.size());
+        //D^-1/2 * L * D^-1/2 is applied from the packed product, L and the scaled copies are never built
+        ScopedTimer normalize_timer(PHASE_NORMALIZE);
+        NormalizedOperator<T> Ms(kron_prod, components.getComponentMembers(i), components.getComponentSize(i));
+        assert(Ms.isSymmetric());
+        normalize_timer.stop();
         
-        for(int j=0; j < sum.size(); j++)
-        {
-            D_neg1[j] = 1.0/sum[j];
-            D_0pt5[j] = sqrt(sum[j]);
-            D_neg0pt5[j] = 1.0/D_0pt5[j];
-        }
-        
-        DenseMatrix1D<T> lTimesD = L.diagonalVectorTimesMatrix(D_neg0pt5);
-        DenseMatrix1D<T> Ms = lTimesD.matrixTimesDiagonalVector(D_neg0pt5);
-        
-        if(!Ms.isSymmetric())
-        {
-            throw NotASymmetricMatrixException();
-        }
+        //the backend of the component is chosen by its size unless one was forced (EigenBackends.h)
+        ScopedTimer eigen_timer(PHASE_EIGEN_SOLVE);
+        int backend = eigen_backend == EIGEN_BACKEND_AUTO ? eigen_solver_selector().choose(Ms.getSize()) : eigen_backend;
+        Profiler::count(COUNTER_EIGEN_BACKENDS + backend, 1);
+        T* eigenVec = Ms.getTopEigenVector(backend, eigen_tolerance);
+        eigen_timer.stop();
         
-        T* eigenVec=  Ms.getTopEigenVector();
+        ScopedTimer rescale_timer(PHASE_NORMALIZE);
+        const std::vector<T>& D_0pt5 = Ms.getSqrtOfDegrees();
         double vecLength = 0;
-        for (int j=0; j < L.getNumberOfRows(); j++)
+        for (int j=0; j < Ms.getSize(); j++)
         {
             eigenVec[j] *= D_0pt5[j];
             vecLength += pow(eigenVec[j],2);
@@ -99,143 +199,126 @@ struct IsoRank_Result isoRank(DenseMatrix1D<T>& matrix_A, DenseMatrix1D<T>& matr
             coef = -1;
         }
         
-        for (int j=0; j < L.getNumberOfRows(); j++)
+        //the eigenvector is kept in the arena in the score type, the solver's copy is freed right away
+        S* score_vector = arena.allocate<S>(Ms.getSize());
+        for (int j=0; j < Ms.getSize(); j++)
         {
-            eigenVec[j] = coef* (eigenVec[j]/vecLength);
+            score_vector[j] = coef* (eigenVec[j]/vecLength);
         }
-        eigenValues[i] = eigenVec;
+        delete []eigenVec;
+        eigenValues[i] = score_vector;
     }
     
     
-    DenseMatrix1D<T> scores;
-    std::vector<int>* comp_mask_curr=comp_mask_values[0];
-    int counter_eig_vector=0;
-    int counter_comp_mask=0;
+    int rows = matrix_A.getNumberOfRows();
+    int cols = matrix_B.getNumberOfColumns();
     struct IsoRank_Result ret_val;
+    ret_val.trials = 0;
+    int* result_assignment = NULL;
+    //the adjacency lists and the helper threads of the local search are shared by all components
+    LocalSearch<Matrix, T> search(matrix_A,matrix_B,local_search,arena);
     
     //run matching algorithms for each component
-    for(int k=0;k<kron_prod.getNumberOfColumns();k++) {
-        T* eigenvector=eigenValues[k];
+    for(int k=0;k<num_components;k++) {
+        S* eigenvector=eigenValues[k];
         
         if(eigenvector!=NULL) {
-            comp_mask_curr=comp_mask_values[k];
-            scores= reshape(eigenvector,matrix_A.getNumberOfRows(),matrix_B.getNumberOfColumns(),*comp_mask_curr);
-            DenseMatrix1D<T> scores_copy(scores);
-            int * best_assignment;
+            //the score matrices and assignments of a component are released once its best assignment is copied
+            Arena::Marker component_marker=arena.mark();
+            ScopedTimer reshape_timer(PHASE_RESHAPE);
+            DenseMatrix1D<S> scores_copy(arena.allocateFilled<S>(rows*cols,0),rows,cols);
+            reshape(eigenvector,components.getComponentMembers(k),components.getComponentSize(k),scores_copy);
+            DenseMatrix1D<S> scores(arena.allocate<S>(rows*cols),rows,cols);
+            reshape_timer.stop();
+            int* best_assignment=arena.allocate<int>(rows);
+            int* assignment=arena.allocate<int>(rows);
             float best_frob_norm=DBL_MAX;
+            float best_score=0;
+            RestartController controller(restarts);
             
-            for (int num_it = 0; num_it < NUM_OF_ISORANK_IT; num_it++){
+            while (controller.nextTrial()){
+                Profiler::count(COUNTER_MATCHING_TRIALS, 1);
+                ScopedTimer matching_timer(PHASE_MATCHING);
                 scores=scores_copy;
-                int* assignment= new int[matrix_A.getNumberOfRows()];
-                init_array(assignment,matrix_A.getNumberOfRows(),-1);
+                init_array(assignment,rows,-1);
+                context.random.seed(stream,ret_val.trials+controller.getTrials());
                 
-                //call the approprite matching algorithm
-                switch (matching_algorithm)
-                {
-                    case GREEDY:
-                        greedy_1(scores,matrix_A,matrix_B,assignment);
-                        break;
-                    case CON_ENF_1:
-                        greedy_connectivity_1(scores,matrix_A,matrix_B,assignment);
-                        break;
-                    case CON_ENF_2:
-                        greedy_connectivity_2(scores,matrix_A,matrix_B,assignment);
-                        break;
-                    case CON_ENF_3:
-                        greedy_connectivity_3(scores,matrix_A,matrix_B,assignment);
-                        break;
-                    case CON_ENF_4:
-                        greedy_connectivity_4(scores,matrix_A,matrix_B,assignment);
-                        break;
-                    default:
-                        break;
-                }
+                Matcher::match(scores,matrix_A,matrix_B,assignment,context);
+                matching_timer.stop();
                 
+                //find the frobenius norm ||A - P*B*P'|| of the matching
+                ScopedTimer frobenius_timer(PHASE_FROBENIUS);
+                T frob_norm_hold=Scorer::score(assignment,matrix_A,matrix_B);
+                frobenius_timer.stop();
                 
-                //find the frobenius norm
-                // two cases: matrixA is larger than matrixB and matrixA is smaller than matrixB
-                if(matrix_A.getNumberOfRows()>matrix_B.getNumberOfRows()){
-                    DenseMatrix1D<T> perm_mat=getPermMatrix(assignment,matrix_A.getNumberOfRows(),matrix_A.getNumberOfRows());
-                    DenseMatrix1D<T> product=perm_mat*matrix_A;
-                    DenseMatrix1D<T> get_transpose=perm_mat.transpose();
-                    DenseMatrix1D<T> final_mat=product*get_transpose;
-                    DenseMatrix1D<T> ret_matrix= matrix_A-final_mat;
-					
-                    T frob_norm_hold=ret_matrix.getFrobNorm();
-                    
-                    if(frob_norm_hold<best_frob_norm){
-                        best_frob_norm=frob_norm_hold;
-                        if(num_it>0)
-                            delete []best_assignment;
-                        best_assignment=assignment;
-                        
-                    }
-                    else{
-                        delete []assignment;
-                    }
+                if(local_search.max_evaluations>0){
+                    ScopedTimer local_search_timer(PHASE_LOCAL_SEARCH);
+                    frob_norm_hold=search.refine(assignment,frob_norm_hold);
                 }
-                else{
-                    int b_size=matrix_B.getNumberOfRows();
-                    int a_size=matrix_A.getNumberOfRows();
-                    DenseMatrix1D<float> matrix_A2(b_size,b_size);
-                    
-                    for(int r=0;r<b_size;r++){
-                        for(int s=0;s<b_size;s++){
-                            if(r<a_size&&s<a_size){
-                                matrix_A2(r,s)=matrix_A(r,s);
-                            }
-                            else if(r==s){
-                                matrix_A2(r,s)=1;
-                            }
-                            else{
-                                matrix_A2(r,s)=0;
-                            }
-                        }
-                    }
-                    
-                    DenseMatrix1D<T> perm_mat=getPermMatrix(assignment,matrix_A.getNumberOfRows(),matrix_B.getNumberOfRows());
-                    DenseMatrix1D<T> product=perm_mat*matrix_A2;	
-                    DenseMatrix1D<T> get_transpose=perm_mat.transpose();
-                    DenseMatrix1D<T> final_mat=product*get_transpose;
-                    DenseMatrix1D<T> ret_matrix= matrix_A-final_mat;
-                    
-                    float frob_norm_hold=ret_matrix.getFrobNorm(); 
-                    
-                    if(frob_norm_hold<best_frob_norm){
-                        best_frob_norm=frob_norm_hold;
-                        if(num_it>0)
-                            delete []best_assignment;
-                        best_assignment=assignment;
-                    }
-                    else{
-                        delete []assignment;
-                    }
+                
+                bool improved=frob_norm_hold<best_frob_norm;
+                if(improved){
+                    best_frob_norm=frob_norm_hold;
+                    best_score=matching_score(assignment,scores_copy);
+                    std::swap(best_assignment,assignment);
                 }
+                controller.report(improved,best_frob_norm,context.random.ties()>0);
             }
+            Profiler::count(COUNTER_RESTART_STOPS+controller.getStopReason(), 1);
+            ret_val.trials+=controller.getTrials();
             
+            //the assignment of the result belongs to the caller, it outlives the arena
+            if(result_assignment==NULL)
+                result_assignment=new int[rows];
+            std::copy(best_assignment,best_assignment+rows,result_assignment);
             ret_val.frob_norm=best_frob_norm;
-            ret_val.assignments=best_assignment;
-            ret_val.assignment_length=matrix_A.getNumberOfRows();        
+            ret_val.score=best_score;
+            ret_val.assignments=result_assignment;
+            ret_val.assignment_length=rows;
+            arena.rewind(component_marker);
         }
     }
+    Profiler::count(COUNTER_LOCAL_SEARCH_EVALUATIONS, search.getEvaluations());
+    Profiler::count(COUNTER_LOCAL_SEARCH_MOVES, search.getMoves());
     
-	for(int k=0;k<kron_prod.getNumberOfColumns();k++)
-	{
-        delete []eigenValues[k];
-	}
-    
-    for (int i = 0 ; i < comp_mask_values.size(); ++i )
-    {
-        delete  comp_mask_values[i];
-    }
-    
-    for (int i=0; i < vertices.size() ; i++)
+    return ret_val;
+}
+
+/*
+ * function used to perform the isorank algorithm. Matrix is DenseMatrix1D or SymMatrix.
+ * The matching algorithm is chosen once per pair, the work is done by IsoRankEngine.
+ * Every thread keeps its own MatchContext, so the scratch memory of a pair is reused by the next one.
+ * @pram: adjacency matrix for graph1
+ * @pram: adjacency matrix for graph2
+ * @pram: the matching algorithm used to choose the best node to node mapping
+ * @pram: eigen solver backend of the components (EigenSolvers.h), chosen by their size by default
+ * @pram: tolerance of the residual of the Lanczos backend
+ * @pram: limits of the restarts of the matching algorithm
+ * @pram: budget of the local search that refines every matching, none by default
+ * @pram: key of the random streams of the pair (pair_stream in RandomStream.h), the same key gives the same result
+ */
+template <template <typename> class Matrix, typename T>
+struct IsoRank_Result isoRank(Matrix<T>& matrix_A, Matrix<T>& matrix_B, int matching_algorithm,
+                              int eigen_backend = EIGEN_BACKEND_AUTO, double eigen_tolerance = 1e-6,
+                              const RestartPolicy& restarts = RestartPolicy(),
+                              const LocalSearchPolicy& local_search = LocalSearchPolicy(),
+                              unsigned long long stream = 0)
+{
+    static thread_local MatchContext context;
+    switch (matching_algorithm)
     {
-    	delete vertices[i];
+        case CON_ENF_1:
+            return IsoRankEngine<Matrix, T, T, Connectivity_1_Matcher, Frobenius_Scorer>::run(matrix_A, matrix_B, context, eigen_backend, eigen_tolerance, restarts, local_search, stream);
+        case CON_ENF_2:
+            return IsoRankEngine<Matrix, T, T, Connectivity_2_Matcher, Frobenius_Scorer>::run(matrix_A, matrix_B, context, eigen_backend, eigen_tolerance, restarts, local_search, stream);
+        case CON_ENF_3:
+            return IsoRankEngine<Matrix, T, T, Connectivity_3_Matcher, Frobenius_Scorer>::run(matrix_A, matrix_B, context, eigen_backend, eigen_tolerance, restarts, local_search, stream);
+        case CON_ENF_4:
+            return IsoRankEngine<Matrix, T, T, Connectivity_4_Matcher, Frobenius_Scorer>::run(matrix_A, matrix_B, context, eigen_backend, eigen_tolerance, restarts, local_search, stream);
+        case GREEDY:
+        default:
+            return IsoRankEngine<Matrix, T, T, Greedy_Matcher, Frobenius_Scorer>::run(matrix_A, matrix_B, context, eigen_backend, eigen_tolerance, restarts, local_search, stream);
     }
-    
-    delete []eigenValues;
-    return ret_val;
 }
 
 #endif
@@ -0,0 +1,529 @@
+/************************************************************************************
+ * This file contains the local search that refines the assignment of a matching   *
+ * algorithm. ||A - P*B*P'||^2 = ||A||^2 + ||B||^2 - 2*sum(A(i,k)*B(p(i),p(k))), so *
+ * a move is better exactly when it increases the overlap of the edges of A with   *
+ * the mapped edges of B. Moving the images of a few nodes S only changes the      *
+ * terms of the rows and columns of S, so the change of the overlap is read from   *
+ * the neighbors of the nodes of S in A: a move is evaluated in O(deg) instead of  *
+ * the O(n^2) of a new frobenius norm.                                             *
+ *                                                                                  *
+ * Moves:                                                                           *
+ *      2-swap:     two nodes of graph1 exchange their images                       *
+ *      3-rotation: the images of a path a-b-c of graph1 are rotated, in both       *
+ *                  directions, for the moves that no single swap improves          *
+ * The smaller graph is padded with isolated nodes as in frobenius_score, so a node *
+ * can also be moved to a node of graph2 that has no preimage. The search stops at  *
+ * a local optimum or when the budget of evaluations of the trial is spent. With    *
+ * more than one thread the swaps of a pass are evaluated in parallel and the best  *
+ * one is applied (best improvement), otherwise the first improving move is applied.*
+ * The helper threads are started once per pair, at the first parallel pass, and   *
+ * every thread of a pass stops at its share of the budget that is left.            *
+ ************************************************************************************/
+
+#ifndef _LocalSearch_h
+#define _LocalSearch_h
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include "Arena.h"
+
+/*
+ * LocalSearchPolicy: the budget of the local search, set with -local_search and -local_search_threads.
+ * max_evaluations 0 disables the local search.
+ */
+struct LocalSearchPolicy
+{
+    int max_evaluations;
+    int threads;
+
+    LocalSearchPolicy() : max_evaluations(0), threads(1) {}
+};
+
+/*
+ * LocalSearch class: refines the assignments of the trials of one pair of graphs. The adjacency
+ * lists of graph1 are built once per pair in the arena of the pair.
+ */
+template <template <typename> class Matrix, typename T>
+class LocalSearch
+{
+private:
+    Matrix<T>& _graph1;
+    Matrix<T>& _graph2;
+    const LocalSearchPolicy& _policy;
+    int _n1;
+    int _n2;
+    int _size;
+    int* _offsets;
+    int* _neighbors;
+    T* _weights;
+    int* _perm;
+    long long _evaluations;
+    long long _moves;
+
+    //helper threads of the parallel passes and the share of the pass of every thread
+    std::vector<std::thread> _workers;
+    std::mutex _pool_mutex;
+    std::condition_variable _pool_start;
+    std::condition_variable _pool_done;
+    long long _pool_generation;
+    int _pool_pending;
+    bool _pool_stop;
+    std::vector<long long> _pass_budget;
+    std::vector<long long> _pass_evaluations;
+    std::vector<T> _best_delta;
+    std::vector<int> _best_a;
+    std::vector<int> _best_b;
+
+    T _b(int x, int y);
+    T _a(int i, int k);
+    T _delta(const int* nodes, const int* images, int count);
+    bool _swapPass(long long budget, T& gain);
+    bool _parallelSwapPass(long long budget, T& gain);
+    void _scanSwaps(int thread);
+    void _workerLoop(int thread);
+    bool _rotationPass(long long budget, T& gain);
+
+public:
+    LocalSearch(Matrix<T>& graph1, Matrix<T>& graph2, const LocalSearchPolicy& policy, Arena& arena);
+    ~LocalSearch();
+
+    T refine(int* assignment, T frob_norm);
+    long long getEvaluations();
+    long long getMoves();
+};
+
+/*
+ * Constructor: builds the adjacency lists of graph1 without the diagonal, nothing if the search is disabled.
+ * @pram Matrix<T>: adjacency matrix of graph1
+ * @pram Matrix<T>: adjacency matrix of graph2
+ * @pram LocalSearchPolicy: budget of the search
+ * @pram Arena: arena of the pair, the lists and the permutation are taken from it
+ */
+template <template <typename> class Matrix, typename T>
+inline LocalSearch<Matrix, T>::LocalSearch(Matrix<T>& graph1, Matrix<T>& graph2, const LocalSearchPolicy& policy, Arena& arena)
+    : _graph1(graph1), _graph2(graph2), _policy(policy)
+{
+    this->_n1 = graph1.getNumberOfRows();
+    this->_n2 = graph2.getNumberOfRows();
+    this->_size = std::max(this->_n1, this->_n2);
+    this->_evaluations = 0;
+    this->_moves = 0;
+    this->_offsets = NULL;
+    this->_neighbors = NULL;
+    this->_weights = NULL;
+    this->_perm = NULL;
+    this->_pool_generation = 0;
+    this->_pool_pending = 0;
+    this->_pool_stop = false;
+    if (policy.max_evaluations <= 0)
+    {
+        return;
+    }
+
+    int num_edges = 0;
+    for (int i = 0; i < this->_n1; i++)
+    {
+        for (int k = 0; k < this->_n1; k++)
+        {
+            if (i != k && graph1(i, k) != 0)
+            {
+                num_edges++;
+            }
+        }
+    }
+    this->_offsets = arena.allocate<int>(this->_size + 1);
+    this->_neighbors = arena.allocate<int>(num_edges);
+    this->_weights = arena.allocate<T>(num_edges);
+    this->_perm = arena.allocate<int>(this->_size);
+
+    int edge = 0;
+    for (int i = 0; i < this->_size; i++)
+    {
+        this->_offsets[i] = edge;
+        for (int k = 0; i < this->_n1 && k < this->_n1; k++)
+        {
+            if (i != k && graph1(i, k) != 0)
+            {
+                this->_neighbors[edge] = k;
+                this->_weights[edge] = graph1(i, k);
+                edge++;
+            }
+        }
+    }
+    this->_offsets[this->_size] = edge;
+}
+
+/*
+ * Destructor: stops the helper threads.
+ */
+template <template <typename> class Matrix, typename T>
+inline LocalSearch<Matrix, T>::~LocalSearch()
+{
+    if (this->_workers.empty())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->_pool_mutex);
+        this->_pool_stop = true;
+    }
+    this->_pool_start.notify_all();
+    for (int t = 0; t < this->_workers.size(); t++)
+    {
+        this->_workers[t].join();
+    }
+}
+
+/*
+ * Refines an assignment in place and returns its frobenius norm.
+ * @pram int*: assignment of a matching algorithm, nodes of graph1 to nodes of graph2
+ * @pram T: frobenius norm of the assignment
+ */
+template <template <typename> class Matrix, typename T>
+inline T LocalSearch<Matrix, T>::refine(int* assignment, T frob_norm)
+{
+    if (this->_policy.max_evaluations <= 0)
+    {
+        return frob_norm;
+    }
+
+    //padded nodes of graph1 take the nodes of graph2 that were not assigned, as in frobenius_score
+    std::vector<char> used(this->_size, 0);
+    for (int i = 0; i < this->_n1; i++)
+    {
+        this->_perm[i] = assignment[i];
+        if (assignment[i] >= 0 && assignment[i] < this->_size)
+        {
+            used[assignment[i]] = 1;
+        }
+    }
+    int next_free = 0;
+    for (int i = this->_n1; i < this->_size; i++)
+    {
+        while (used[next_free] == 1)
+        {
+            next_free++;
+        }
+        this->_perm[i] = next_free;
+        used[next_free] = 1;
+    }
+    for (int i = 0; i < this->_n1; i++)
+    {
+        //the assignment is not a permutation, there is nothing to refine
+        if (this->_perm[i] < 0 || this->_perm[i] >= this->_size)
+        {
+            return frob_norm;
+        }
+    }
+
+    long long budget = this->_evaluations + this->_policy.max_evaluations;
+    T gain = 0;
+    bool improved = true;
+    while (improved && this->_evaluations < budget)
+    {
+        improved = this->_policy.threads > 1 ? _parallelSwapPass(budget, gain) : _swapPass(budget, gain);
+        if (!improved && this->_evaluations < budget)
+        {
+            improved = _rotationPass(budget, gain);
+        }
+    }
+
+    for (int i = 0; i < this->_n1; i++)
+    {
+        assignment[i] = this->_perm[i];
+    }
+    return frob_norm - 2 * gain;
+}
+
+/*
+ * Returns the number of moves evaluated.
+ */
+template <template <typename> class Matrix, typename T>
+inline long long LocalSearch<Matrix, T>::getEvaluations()
+{
+    return this->_evaluations;
+}
+
+/*
+ * Returns the number of moves applied.
+ */
+template <template <typename> class Matrix, typename T>
+inline long long LocalSearch<Matrix, T>::getMoves()
+{
+    return this->_moves;
+}
+
+/*
+ * entry of graph2, 0 for the padded nodes
+ */
+template <template <typename> class Matrix, typename T>
+inline T LocalSearch<Matrix, T>::_b(int x, int y)
+{
+    return (x < this->_n2 && y < this->_n2) ? this->_graph2(x, y) : 0;
+}
+
+/*
+ * entry of graph1, 0 for the padded nodes
+ */
+template <template <typename> class Matrix, typename T>
+inline T LocalSearch<Matrix, T>::_a(int i, int k)
+{
+    return (i < this->_n1 && k < this->_n1) ? this->_graph1(i, k) : 0;
+}
+
+/*
+ * returns the change of the overlap sum(A(i,k)*B(p(i),p(k))) if the nodes get the new images
+ */
+template <template <typename> class Matrix, typename T>
+inline T LocalSearch<Matrix, T>::_delta(const int* nodes, const int* images, int count)
+{
+    T delta = 0;
+    for (int s = 0; s < count; s++)
+    {
+        int node = nodes[s];
+        for (int e = this->_offsets[node]; e < this->_offsets[node + 1]; e++)
+        {
+            int k = this->_neighbors[e];
+            if (k == nodes[0] || (count > 1 && k == nodes[1]) || (count > 2 && k == nodes[2]))
+            {
+                continue;
+            }
+            //the row and the column of the node, A and B are symmetric
+            delta += 2 * this->_weights[e] * (_b(images[s], this->_perm[k]) - _b(this->_perm[node], this->_perm[k]));
+        }
+        for (int t = 0; t < count; t++)
+        {
+            T a = _a(node, nodes[t]);
+            if (a != 0)
+            {
+                delta += a * (_b(images[s], images[t]) - _b(this->_perm[node], this->_perm[nodes[t]]));
+            }
+        }
+    }
+    return delta;
+}
+
+/*
+ * applies the first improving swap of every node, returns true if a swap was applied
+ */
+template <template <typename> class Matrix, typename T>
+inline bool LocalSearch<Matrix, T>::_swapPass(long long budget, T& gain)
+{
+    bool improved = false;
+    int nodes[2];
+    int images[2];
+    for (int a = 0; a < this->_size && this->_evaluations < budget; a++)
+    {
+        for (int b = a + 1; b < this->_size && this->_evaluations < budget; b++)
+        {
+            //two isolated nodes of graph1 can not change the overlap
+            if (this->_offsets[a] == this->_offsets[a + 1] && this->_offsets[b] == this->_offsets[b + 1]
+                && _a(a, a) == 0 && _a(b, b) == 0)
+            {
+                continue;
+            }
+            nodes[0] = a;
+            nodes[1] = b;
+            images[0] = this->_perm[b];
+            images[1] = this->_perm[a];
+            T delta = _delta(nodes, images, 2);
+            this->_evaluations++;
+            if (delta > (T)1e-6)
+            {
+                std::swap(this->_perm[a], this->_perm[b]);
+                gain += delta;
+                this->_moves++;
+                improved = true;
+            }
+        }
+    }
+    return improved;
+}
+
+/*
+ * evaluates the swaps in parallel and applies the best one, returns true if a swap was applied. The budget
+ * that is left is split between the threads, the calling thread takes the first share.
+ */
+template <template <typename> class Matrix, typename T>
+inline bool LocalSearch<Matrix, T>::_parallelSwapPass(long long budget, T& gain)
+{
+    int num_threads = this->_policy.threads;
+    if (this->_workers.empty())
+    {
+        this->_pass_budget.resize(num_threads);
+        this->_pass_evaluations.resize(num_threads);
+        this->_best_delta.resize(num_threads);
+        this->_best_a.resize(num_threads);
+        this->_best_b.resize(num_threads);
+        for (int t = 1; t < num_threads; t++)
+        {
+            this->_workers.push_back(std::thread(&LocalSearch<Matrix, T>::_workerLoop, this, t));
+        }
+    }
+
+    long long remaining = budget - this->_evaluations;
+    for (int t = 0; t < num_threads; t++)
+    {
+        this->_pass_budget[t] = remaining / num_threads + (t < remaining % num_threads ? 1 : 0);
+        this->_pass_evaluations[t] = 0;
+        this->_best_delta[t] = 0;
+        this->_best_a[t] = -1;
+        this->_best_b[t] = -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->_pool_mutex);
+        this->_pool_pending = num_threads - 1;
+        this->_pool_generation++;
+    }
+    this->_pool_start.notify_all();
+    _scanSwaps(0);
+    {
+        std::unique_lock<std::mutex> lock(this->_pool_mutex);
+        this->_pool_done.wait(lock, [this]() { return this->_pool_pending == 0; });
+    }
+
+    //equal gains go to the first swap in row order, so the move does not depend on the number of threads
+    int best = 0;
+    for (int t = 0; t < num_threads; t++)
+    {
+        this->_evaluations += this->_pass_evaluations[t];
+        if (this->_best_delta[t] > this->_best_delta[best]
+            || (this->_best_delta[t] == this->_best_delta[best] && this->_best_a[t] >= 0
+                && (this->_best_a[best] < 0 || this->_best_a[t] < this->_best_a[best]
+                    || (this->_best_a[t] == this->_best_a[best] && this->_best_b[t] < this->_best_b[best]))))
+        {
+            best = t;
+        }
+    }
+    if (this->_best_a[best] < 0 || !(this->_best_delta[best] > (T)1e-6))
+    {
+        return false;
+    }
+    std::swap(this->_perm[this->_best_a[best]], this->_perm[this->_best_b[best]]);
+    gain += this->_best_delta[best];
+    this->_moves++;
+    return true;
+}
+
+/*
+ * evaluates the swaps of the rows of one thread of a parallel pass until its share of the budget is spent
+ */
+template <template <typename> class Matrix, typename T>
+inline void LocalSearch<Matrix, T>::_scanSwaps(int thread)
+{
+    int num_threads = this->_policy.threads;
+    long long budget = this->_pass_budget[thread];
+    long long evaluations = 0;
+    int nodes[2];
+    int images[2];
+    //rows are dealt round robin, the rows of small a have more pairs
+    for (int a = thread; a < this->_size && evaluations < budget; a += num_threads)
+    {
+        for (int b = a + 1; b < this->_size && evaluations < budget; b++)
+        {
+            if (this->_offsets[a] == this->_offsets[a + 1] && this->_offsets[b] == this->_offsets[b + 1]
+                && _a(a, a) == 0 && _a(b, b) == 0)
+            {
+                continue;
+            }
+            nodes[0] = a;
+            nodes[1] = b;
+            images[0] = this->_perm[b];
+            images[1] = this->_perm[a];
+            T delta = _delta(nodes, images, 2);
+            evaluations++;
+            if (delta > this->_best_delta[thread])
+            {
+                this->_best_delta[thread] = delta;
+                this->_best_a[thread] = a;
+                this->_best_b[thread] = b;
+            }
+        }
+    }
+    this->_pass_evaluations[thread] = evaluations;
+}
+
+/*
+ * loop of a helper thread: runs its share of every parallel pass until the search is destroyed
+ */
+template <template <typename> class Matrix, typename T>
+inline void LocalSearch<Matrix, T>::_workerLoop(int thread)
+{
+    long long generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(this->_pool_mutex);
+            this->_pool_start.wait(lock, [&]() { return this->_pool_stop || this->_pool_generation != generation; });
+            if (this->_pool_stop)
+            {
+                return;
+            }
+            generation = this->_pool_generation;
+        }
+        _scanSwaps(thread);
+        {
+            std::lock_guard<std::mutex> lock(this->_pool_mutex);
+            this->_pool_pending--;
+            if (this->_pool_pending == 0)
+            {
+                this->_pool_done.notify_one();
+            }
+        }
+    }
+}
+
+/*
+ * applies the first improving rotation of every path a-b-c of graph1, returns true if a rotation was applied
+ */
+template <template <typename> class Matrix, typename T>
+inline bool LocalSearch<Matrix, T>::_rotationPass(long long budget, T& gain)
+{
+    bool improved = false;
+    int nodes[3];
+    int images[3];
+    for (int a = 0; a < this->_n1 && this->_evaluations < budget; a++)
+    {
+        for (int e = this->_offsets[a]; e < this->_offsets[a + 1] && this->_evaluations < budget; e++)
+        {
+            int b = this->_neighbors[e];
+            for (int f = this->_offsets[b]; f < this->_offsets[b + 1] && this->_evaluations < budget; f++)
+            {
+                int c = this->_neighbors[f];
+                if (c == a)
+                {
+                    continue;
+                }
+                nodes[0] = a;
+                nodes[1] = b;
+                nodes[2] = c;
+                for (int direction = 1; direction <= 2; direction++)
+                {
+                    for (int s = 0; s < 3; s++)
+                    {
+                        images[s] = this->_perm[nodes[(s + direction) % 3]];
+                    }
+                    T delta = _delta(nodes, images, 3);
+                    this->_evaluations++;
+                    if (delta > (T)1e-6)
+                    {
+                        for (int s = 0; s < 3; s++)
+                        {
+                            this->_perm[nodes[s]] = images[s];
+                        }
+                        gain += delta;
+                        this->_moves++;
+                        improved = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return improved;
+}
+
+#endif
@@ -0,0 +1,191 @@
+/************************************************************************************
+ * This file contains the compact form used to send matrices between processors.    *
+ * It is a CSR layout where the column indices are delta and varint encoded, so the *
+ * 0/1 adjacency matrix of a sparse graph takes about one byte per edge:            *
+ *      header: varint rows, varint cols, one byte of flags                         *
+ *      row:    varint number of entries, varint gap before every column, then the  *
+ *              values of the row if the matrix is not 0/1                          *
+ * For a symmetric matrix only the entries with j >= i are stored. The gap of the   *
+ * first column of a row is counted from the row start (i or 0), the gap of the     *
+ * next columns from the previous column + 1.                                       *
+ ************************************************************************************/
+
+#ifndef _CompactForm_h
+#define _CompactForm_h
+
+#include <vector>
+#include <cstring>
+#include "MatrixExceptions.h"
+
+static const unsigned char _COMPACT_SYMMETRIC = 1;
+static const unsigned char _COMPACT_VALUES = 2;
+
+/*
+ * appends an unsigned integer to a buffer, 7 bits per byte
+ * @pram: buffer
+ * @pram: value
+ */
+inline void varint_append(std::vector<unsigned char>& buffer, unsigned int value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back((unsigned char)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((unsigned char)value);
+}
+
+/*
+ * reads an unsigned integer written by varint_append
+ * @pram: buffer
+ * @pram: position of the integer, moved past it
+ */
+inline unsigned int varint_read(const std::vector<unsigned char>& buffer, size_t& position)
+{
+    unsigned int value = 0;
+    int shift = 0;
+    while (true)
+    {
+        if (position >= buffer.size() || shift > 28)
+        {
+            throw IndexOutOfBoundsException();
+        }
+        unsigned char byte = buffer[position++];
+        value |= (unsigned int)(byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            return value;
+        }
+        shift += 7;
+    }
+}
+
+/*
+ * returns the compact form of a matrix
+ * @pram: the matrix, read with operator()
+ * @pram: number of rows
+ * @pram: number of columns
+ * @pram: true to only store the entries with j >= i
+ */
+template <typename T, typename Matrix>
+std::vector<unsigned char> compact_encode(Matrix& matrix, int rows, int cols, bool symmetric)
+{
+    bool binary = true;
+    for (int i = 0; i < rows && binary; i++)
+    {
+        for (int j = symmetric ? i : 0; j < cols; j++)
+        {
+            if (matrix(i, j) != 0 && matrix(i, j) != 1)
+            {
+                binary = false;
+                break;
+            }
+        }
+    }
+
+    std::vector<unsigned char> buffer;
+    varint_append(buffer, rows);
+    varint_append(buffer, cols);
+    buffer.push_back((symmetric ? _COMPACT_SYMMETRIC : 0) | (binary ? 0 : _COMPACT_VALUES));
+
+    std::vector<int> columns;
+    std::vector<T> values;
+    for (int i = 0; i < rows; i++)
+    {
+        columns.clear();
+        values.clear();
+        for (int j = symmetric ? i : 0; j < cols; j++)
+        {
+            if (matrix(i, j) != 0)
+            {
+                columns.push_back(j);
+                values.push_back(matrix(i, j));
+            }
+        }
+        varint_append(buffer, columns.size());
+        int next_column = symmetric ? i : 0;
+        for (int k = 0; k < columns.size(); k++)
+        {
+            varint_append(buffer, columns[k] - next_column);
+            next_column = columns[k] + 1;
+        }
+        if (!binary && !values.empty())
+        {
+            size_t position = buffer.size();
+            buffer.resize(position + values.size() * sizeof(T));
+            std::memcpy(&buffer[position], &values[0], values.size() * sizeof(T));
+        }
+    }
+    return buffer;
+}
+
+/*
+ * reads the size of the matrix stored in a compact form
+ * @pram: compact form
+ * @pram: set to the number of rows
+ * @pram: set to the number of columns
+ */
+inline void compact_size(const std::vector<unsigned char>& buffer, int& rows, int& cols)
+{
+    size_t position = 0;
+    rows = varint_read(buffer, position);
+    cols = varint_read(buffer, position);
+}
+
+/*
+ * writes the entries stored in a compact form to a matrix. The matrix must have the right size
+ * and be filled with 0's. The entries of a symmetric matrix are written to (i, j) and (j, i).
+ * @pram: compact form
+ * @pram: the matrix, written with operator()
+ */
+template <typename T, typename Matrix>
+void compact_decode(const std::vector<unsigned char>& buffer, Matrix& matrix)
+{
+    size_t position = 0;
+    int rows = varint_read(buffer, position);
+    int cols = varint_read(buffer, position);
+    if (position >= buffer.size())
+    {
+        throw IndexOutOfBoundsException();
+    }
+    unsigned char flags = buffer[position++];
+    bool symmetric = (flags & _COMPACT_SYMMETRIC) != 0;
+    bool binary = (flags & _COMPACT_VALUES) == 0;
+
+    std::vector<int> columns;
+    for (int i = 0; i < rows; i++)
+    {
+        int count = varint_read(buffer, position);
+        columns.resize(count);
+        int next_column = symmetric ? i : 0;
+        for (int k = 0; k < count; k++)
+        {
+            columns[k] = next_column + varint_read(buffer, position);
+            next_column = columns[k] + 1;
+            if (columns[k] >= cols)
+            {
+                throw IndexOutOfBoundsException();
+            }
+        }
+        for (int k = 0; k < count; k++)
+        {
+            T value = 1;
+            if (!binary)
+            {
+                if (position + sizeof(T) > buffer.size())
+                {
+                    throw IndexOutOfBoundsException();
+                }
+                std::memcpy(&value, &buffer[position], sizeof(T));
+                position += sizeof(T);
+            }
+            matrix(i, columns[k]) = value;
+            if (symmetric)
+            {
+                matrix(columns[k], i) = value;
+            }
+        }
+    }
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include <fstream>
 #include "MatrixExceptions.h"
 #include "SparseElement.h"
+#include "../PerfCounters.h"
 
 #ifdef ARPACK
 #include "dsmatrxa.h"
@@ -32,6 +33,7 @@
 #ifdef USE_MPI
 #include "mpi.h"
 #include "MPI_Structs.h"
+#include "CompactForm.h"
 #endif
 
 template <typename T>
@@ -54,6 +56,9 @@ private:
     size_t _getArrSize() const;
     void _initializeMatrix(bool);
     void _copy(const DenseMatrix1D<T>&);
+    #ifdef USE_MPI
+    int _chooseSendForm(int, std::vector<unsigned char>&);
+    #endif
 
     /*
      * Private constants.
@@ -64,6 +69,7 @@ protected:
     int _rows;
     int _cols;
     T* _edges;
+    bool _owns_edges;
     
     
 public:
@@ -74,6 +80,7 @@ public:
     DenseMatrix1D(int, int, bool fill = true);
     DenseMatrix1D(const DenseMatrix1D<T>&);
     DenseMatrix1D(const std::string&);
+    DenseMatrix1D(T* edges, int rows, int cols);
 
     #ifdef USE_MPI
     DenseMatrix1D(int,MPI_Status&);
@@ -94,6 +101,7 @@ public:
     int getNumberOfColumns();
     std::vector<SparseElement<T> >getSparseForm();
     DenseMatrix1D<T> getScatteredSelection(const std::vector<int>& vec_A, const std::vector<int> vec_B);
+    DenseMatrix1D<T> getSymmetricSelection(const std::vector<int>& vec);
     
     /**********
      *MUTATORS*
@@ -110,13 +118,14 @@ public:
     DenseMatrix1D<T> kron(const DenseMatrix1D<T>& matrix);
     DenseMatrix1D<T> diagonalVectorTimesMatrix(const std::vector<T>&);
     DenseMatrix1D<T> matrixTimesDiagonalVector(const std::vector<T>&);
+    DenseMatrix1D<T> diagonalScaling(const std::vector<T>&);
 
     /*************
     *  MPI Send  *
     **************/
     #ifdef USE_MPI
-    void MPI_Send_Matrix(int, int,bool sparse = false);
-    void MPI_Bcast_Send_Matrix(int,bool sparse = false);
+    void MPI_Send_Matrix(int, int, int send_form = _AUTO_FORM);
+    void MPI_Bcast_Send_Matrix(int, int send_form = _AUTO_FORM);
     #endif
 
     /**********
@@ -200,6 +209,23 @@ inline DenseMatrix1D<T>::DenseMatrix1D(int rows, int cols, bool fill)
     _initializeMatrix(fill);
 }
 
+/*
+ * DensMatrix constructor:
+ * Construct a matrix on top of an array that is owned by someone else (e.g. an Arena).
+ * Nothing is copied and the array is not deleted with the matrix, so it has to outlive the matrix.
+ * @pram T*: row major array of rows*cols values
+ * @pram int rows: number of rows
+ * @pram int cols: number of columns
+ */
+template <typename T>
+inline DenseMatrix1D<T>::DenseMatrix1D(T* edges, int rows, int cols)
+{
+    this->_rows = rows;
+    this->_cols = cols;
+    this->_edges = edges;
+    this->_owns_edges = false;
+}
+
 #ifdef USE_MPI
 /*
  * DensMatrix constructor:
@@ -239,30 +265,14 @@ inline DenseMatrix1D<T>::DenseMatrix1D(int source, int tag, MPI_Status& stat)
         _initializeMatrix(false);
         MPI_Recv(this->_edges, mat_info.recv_size*sizeof(T), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
     }
-    else if (mat_info.send_form == _SYM_SPARSE_FORM)
+    else if (mat_info.send_form == _COMPACT_FORM)
     {
         this->_rows = mat_info.rows;
         this->_cols = mat_info.cols;
         _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Recv(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
-
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            (*this)(recv_edges[i].getJ(),recv_edges[i].getI()) = (*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-        }
-    }
-    else if (mat_info.send_form == _SPARSE_FORM)
-    {
-        this->_rows = mat_info.rows;
-        this->_cols = mat_info.cols;
-        _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Recv(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            (*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-        }
+        std::vector<unsigned char> compact_form(mat_info.recv_size);
+        MPI_Recv(&compact_form[0], mat_info.recv_size, MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
+        compact_decode<T>(compact_form, *this);
     }
 }
 
@@ -303,29 +313,14 @@ inline DenseMatrix1D<T>::DenseMatrix1D(int source, MPI_Status& stat)
         _initializeMatrix(false);
         MPI_Bcast(this->_edges, mat_info.recv_size*sizeof(T), MPI_BYTE, source, MPI_COMM_WORLD);
     }
-    else if (mat_info.send_form == _SYM_SPARSE_FORM)
+    else if (mat_info.send_form == _COMPACT_FORM)
     {
         this->_rows = mat_info.rows;
         this->_cols = mat_info.cols;
         _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Bcast(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            (*this)(recv_edges[i].getJ(),recv_edges[i].getI()) = (*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-        }
-    }
-    else if (mat_info.send_form == _SPARSE_FORM)
-    {
-        this->_rows = mat_info.rows;
-        this->_cols = mat_info.cols;
-        _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Bcast(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            (*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-        }
+        std::vector<unsigned char> compact_form(mat_info.recv_size);
+        MPI_Bcast(&compact_form[0], mat_info.recv_size, MPI_BYTE, source, MPI_COMM_WORLD);
+        compact_decode<T>(compact_form, *this);
     }
 }
 #endif
@@ -349,7 +344,10 @@ inline DenseMatrix1D<T>::DenseMatrix1D(const DenseMatrix1D<T>& matrix)
 template <typename T>
 inline DenseMatrix1D<T>::~DenseMatrix1D()
 {
-    delete [] this->_edges;
+    if (this->_owns_edges)
+    {
+        delete [] this->_edges;
+    }
 }
 
 //===========================================================ACCESSORS===============================================================
@@ -468,6 +466,16 @@ inline DenseMatrix1D<T> DenseMatrix1D<T>::getScatteredSelection(const std::vecto
     return res_matrix;
 }
 
+/*
+ * Returns a DenseMatrix1D that has the rows and the columns that are marked 1 in vec
+ * @pram std::vector<int>: vector of 0's and 1's for row and column selection
+ */
+template <typename T>
+inline DenseMatrix1D<T> DenseMatrix1D<T>::getSymmetricSelection(const std::vector<int>& vec)
+{
+    return getScatteredSelection(vec, vec);
+}
+
 
 
 //===========================================================MUTATORS================================================================
@@ -494,10 +502,11 @@ inline T DenseMatrix1D<T>::getFrobNorm()
 template <typename T>
 inline T* DenseMatrix1D<T>::getTopEigenVector()
 {
+    PERF_SCOPE(PERF_SITE_TOP_EIGENVECTOR);
 #ifdef ARPACK
-    int arr_size = (0.5 * this->_rows * (this->_rows+1));
-    T sym_edges[arr_size];
-    int counter = 0;
+    //the packed triangle is kept on the heap, it is too large for the stack once the kronecker product has a few thousand nodes
+    std::vector<T> sym_edges(size_t(this->_rows) * (this->_rows + 1) / 2);
+    size_t counter = 0;
     
     for(int i = 0; i < this->_rows; i++)
     {
@@ -508,7 +517,7 @@ inline T* DenseMatrix1D<T>::getTopEigenVector()
         }
     }
     
-    ARdsSymMatrix<T> ARMatrix(this->_rows, sym_edges, 'L');
+    ARdsSymMatrix<T> ARMatrix(this->_rows, &sym_edges[0], 'L');
     ARluSymStdEig<T> eigProb(1, ARMatrix, "LM", 10);
     eigProb.FindEigenvectors();
     T* eigen_vector = new T[this->_rows];
@@ -518,9 +527,7 @@ inline T* DenseMatrix1D<T>::getTopEigenVector()
         eigen_vector[i] = eigProb.Eigenvector(0,i);
     }
     return eigen_vector;
-#endif
-
-#ifdef EIGEN
+#elif defined(EIGEN)
     Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> A_eigen = Eigen::MatrixXd::Zero(this->_rows, this->_cols);
     for (long i=0; i< this->_rows; i++) 
     {
@@ -612,6 +619,7 @@ inline std::vector<int> DenseMatrix1D<T>::getNeighbors(int vertex)
 template <typename T>
 inline DenseMatrix1D<T> DenseMatrix1D<T>::kron(const DenseMatrix1D<T>& matrix)
 {
+    PERF_SCOPE(PERF_SITE_KRON);
     //Initializing and allocating the product matrix
     int prod_size = this->_rows * matrix._rows;
     DenseMatrix1D<T> prod_matrix(prod_size, prod_size);
@@ -684,24 +692,69 @@ inline DenseMatrix1D<T> DenseMatrix1D<T>::matrixTimesDiagonalVector(const std::v
     return ret_matrix;
 }
 
+/*
+ * Returns a DenseMatrix1D<T> of D*this*D where D is the diagonal matrix that has the values of vec on its diagonal.
+ * @pram std::vector<T> diagonal entires of a diagonal matrix
+ */
+template <typename T>
+inline DenseMatrix1D<T> DenseMatrix1D<T>::diagonalScaling(const std::vector<T>& vec)
+{
+    if(this->_rows != vec.size() || this->_cols != vec.size())
+    {
+        throw DimensionMismatchException();
+    }
+    
+    DenseMatrix1D<T> ret_matrix(this->_rows, this->_cols, false);
+    for(int i = 0; i < this->_rows; i++)
+    {
+        for(int j = 0; j < this->_cols; j++)
+        {
+            ret_matrix._edges[i * this->_cols + j] = vec[i] * this->_edges[i * this->_cols + j] * vec[j];
+        }
+    }
+    return ret_matrix;
+}
+
 //===========================================================MPI SEND/REC================================================================
 #ifdef USE_MPI
+/*
+ * returns the form the matrix is sent in and fills compact_form when it is _COMPACT_FORM.
+ * _AUTO_FORM sends the compact form unless it is not smaller than the dense one.
+ * @pram int send form requested by the caller
+ * @pram std::vector<unsigned char> set to the compact form of the matrix
+ */
+template <typename T>
+inline int DenseMatrix1D<T>::_chooseSendForm(int send_form, std::vector<unsigned char>& compact_form)
+{
+    if (send_form == _DENSE_FORM || send_form == _SYM_DENSE_FORM)
+    {
+        return send_form;
+    }
+    compact_form = compact_encode<T>(*this, this->_rows, this->_cols, false);
+    if (send_form == _AUTO_FORM && compact_form.size() >= this->_getArrSize() * sizeof(T))
+    {
+        compact_form.clear();
+        return _DENSE_FORM;
+    }
+    return _COMPACT_FORM;
+}
+
 /*
  * Sends a DenseMatrix1D<T> using MPI_Send.
  * @pram int destination processor
  * @pram int tag 
- * @pram bool sending sparse form, default value is false.
+ * @pram int send form: dense, _COMPACT_FORM or _AUTO_FORM (default) to send the smaller one.
  */
 template <typename T>
-inline void DenseMatrix1D<T>::MPI_Send_Matrix(int dest, int tag, bool sparse)
+inline void DenseMatrix1D<T>::MPI_Send_Matrix(int dest, int tag, int send_form)
 {
-    if(sparse)
+    std::vector<unsigned char> compact_form;
+    if (_chooseSendForm(send_form, compact_form) == _COMPACT_FORM)
     {
         MPI_MatrixInfo mat_info;
-        std::vector<SparseElement<T> > sparse_form = this->getSparseForm();
-        mat_info.setValues(this->_rows, this->_cols, sparse_form.size(), _SPARSE_FORM);
+        mat_info.setValues(this->_rows, this->_cols, compact_form.size(), _COMPACT_FORM);
         MPI_Send(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, dest, tag + 1, MPI_COMM_WORLD);
-        MPI_Send(&sparse_form[0], sparse_form.size()*sizeof(SparseElement<T>), MPI_BYTE, dest, tag + 2, MPI_COMM_WORLD);
+        MPI_Send(&compact_form[0], compact_form.size(), MPI_BYTE, dest, tag + 2, MPI_COMM_WORLD);
     }
     else
     {
@@ -715,18 +768,18 @@ inline void DenseMatrix1D<T>::MPI_Send_Matrix(int dest, int tag, bool sparse)
 /*
  * Sends a DenseMatrix1D<T> using MPI_Bcast.
  * @pram int source sender's ID
- * @pram bool sending sparse form, default value is false.
+ * @pram int send form: dense, _COMPACT_FORM or _AUTO_FORM (default) to send the smaller one.
  */
 template <typename T>
-inline void DenseMatrix1D<T>::MPI_Bcast_Send_Matrix(int source, bool sparse)
+inline void DenseMatrix1D<T>::MPI_Bcast_Send_Matrix(int source, int send_form)
 {
-    if(sparse)
+    std::vector<unsigned char> compact_form;
+    if (_chooseSendForm(send_form, compact_form) == _COMPACT_FORM)
     {
         MPI_MatrixInfo mat_info;
-        std::vector<SparseElement<T> > sparse_form = this->getSparseForm();
-        mat_info.setValues(this->_rows, this->_cols, sparse_form.size(), _SPARSE_FORM);
+        mat_info.setValues(this->_rows, this->_cols, compact_form.size(), _COMPACT_FORM);
         MPI_Bcast(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, source, MPI_COMM_WORLD);
-        MPI_Bcast(&sparse_form[0], sparse_form.size()*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
+        MPI_Bcast(&compact_form[0], compact_form.size(), MPI_BYTE, source, MPI_COMM_WORLD);
     }
     else
     {
@@ -751,13 +804,27 @@ inline T& DenseMatrix1D<T>::operator()(int i, int j)
 }
 
 /*
- * Overloaded = operator copies the content of another matrix to this
+ * Overloaded = operator copies the content of another matrix to this. The array is
+ * reused when both matrices have the same size, so a matrix built on top of someone
+ * else's array keeps using it.
  * @pram: DenseMatrix1D<T> 
  */
 template <typename T>
 inline void DenseMatrix1D<T>::operator=(const DenseMatrix1D<T>& matrix)
 {
-    delete [] this->_edges;
+    if (this == &matrix)
+    {
+        return;
+    }
+    if (this->_rows == matrix._rows && this->_cols == matrix._cols)
+    {
+        memcpy(this->_edges, matrix._edges, this->_getArrSize() * sizeof(T));
+        return;
+    }
+    if (this->_owns_edges)
+    {
+        delete [] this->_edges;
+    }
     _copy(matrix);
 }
 
@@ -822,6 +889,7 @@ inline DenseMatrix1D<T> DenseMatrix1D<T>::operator-(const DenseMatrix1D<T>& othe
 template <typename T>
 inline DenseMatrix1D<T> DenseMatrix1D<T>::operator*(const DenseMatrix1D<T>& other_matrix)
 {
+    PERF_SCOPE(PERF_SITE_MATRIX_MULTIPLY);
     DenseMatrix1D<T> ret_matrix(this->_rows,this->_cols);
     T ret_val;
     for(int i = 0; i < this->_rows;i++)
@@ -896,6 +964,7 @@ inline void DenseMatrix1D<T>::_initializeMatrix(bool fill)
     {
         throw OutOfMemoryException();
     }
+    this->_owns_edges = true;
 }
 
 /*
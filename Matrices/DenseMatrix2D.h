@@ -32,6 +32,7 @@
 #ifdef USE_MPI
 #include "mpi.h"
 #include "MPI_Structs.h"
+#include "CompactForm.h"
 #endif
 
 
@@ -53,6 +54,9 @@ private:
      */
     void _copy(const DenseMatrix2D<T>&);
     void _initializeMatrix(bool);
+    #ifdef USE_MPI
+    int _chooseSendForm(int, std::vector<unsigned char>&);
+    #endif
 
     /*
      * Private constants.
@@ -114,8 +118,8 @@ public:
     *  MPI Send  *
     **************/
     #ifdef USE_MPI
-    void MPI_Send_Matrix(int, int, bool sparse = false);
-    void MPI_Bcast_Send_Matrix(int, bool sparse = false);
+    void MPI_Send_Matrix(int, int, int send_form = _AUTO_FORM);
+    void MPI_Bcast_Send_Matrix(int, int send_form = _AUTO_FORM);
     #endif
 
     /**********
@@ -243,30 +247,14 @@ inline DenseMatrix2D<T>::DenseMatrix2D(int source, int tag, MPI_Status& stat)
         }
         delete recv_edges;
     }
-    else if (mat_info.send_form == _SYM_SPARSE_FORM)
+    else if (mat_info.send_form == _COMPACT_FORM)
     {
         this->_rows = mat_info.rows;
         this->_cols = mat_info.cols;
         _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Recv(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
-
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            this->_edges[recv_edges[i].getJ()][recv_edges[i].getI()] = this->_edges[recv_edges[i].getI()][ recv_edges[i].getJ()] = recv_edges[i].getValue();
-        }
-    }
-    else if (mat_info.send_form == _SPARSE_FORM)
-    {
-        this->_rows = mat_info.rows;
-        this->_cols = mat_info.cols;
-        _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Recv(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            this->_edges[recv_edges[i].getI()][ recv_edges[i].getJ()] = recv_edges[i].getValue();
-        }
+        std::vector<unsigned char> compact_form(mat_info.recv_size);
+        MPI_Recv(&compact_form[0], mat_info.recv_size, MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
+        compact_decode<T>(compact_form, *this);
     }
 }
 
@@ -314,29 +302,14 @@ inline DenseMatrix2D<T>::DenseMatrix2D(int source, MPI_Status& stat)
         }
         delete recv_edges;
     }
-    else if (mat_info.send_form == _SYM_SPARSE_FORM)
-    {
-        this->_rows = mat_info.rows;
-        this->_cols = mat_info.cols;
-        _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Bcast(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            this->_edges[recv_edges[i].getJ()][recv_edges[i].getI()] = this->_edges[recv_edges[i].getI()][recv_edges[i].getJ()] = recv_edges[i].getValue();
-        }
-    }
-    else if (mat_info.send_form == _SPARSE_FORM)
+    else if (mat_info.send_form == _COMPACT_FORM)
     {
         this->_rows = mat_info.rows;
         this->_cols = mat_info.cols;
         _initializeMatrix(true);
-        std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-        MPI_Bcast(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
-        for(int i = 0;  i < mat_info.recv_size; i++)
-        {
-            this->_edges[recv_edges[i].getI()][ recv_edges[i].getJ()] = recv_edges[i].getValue();
-        }
+        std::vector<unsigned char> compact_form(mat_info.recv_size);
+        MPI_Bcast(&compact_form[0], mat_info.recv_size, MPI_BYTE, source, MPI_COMM_WORLD);
+        compact_decode<T>(compact_form, *this);
     }
 }
 #endif
@@ -536,9 +509,7 @@ inline T* DenseMatrix2D<T>::getTopEigenVector()
         eigen_vector[i] = eigProb.Eigenvector(0,i);
     }
     return eigen_vector;
-#endif
-
-#ifdef EIGEN
+#elif defined(EIGEN)
         Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> A_eigen = Eigen::MatrixXd::Zero(this->_rows, this->_cols);
         for (int i=0; i< this->_rows; i++) 
         {
@@ -711,22 +682,44 @@ inline DenseMatrix2D<T> DenseMatrix2D<T>::matrixTimesDiagonalVector(const std::v
 
 //===========================================================MPI SEND/REC================================================================
 #ifdef USE_MPI
+/*
+ * returns the form the matrix is sent in and fills compact_form when it is _COMPACT_FORM.
+ * _AUTO_FORM sends the compact form unless it is not smaller than the dense one.
+ * @pram int send form requested by the caller
+ * @pram std::vector<unsigned char> set to the compact form of the matrix
+ */
+template <typename T>
+inline int DenseMatrix2D<T>::_chooseSendForm(int send_form, std::vector<unsigned char>& compact_form)
+{
+    if (send_form == _DENSE_FORM || send_form == _SYM_DENSE_FORM)
+    {
+        return send_form;
+    }
+    compact_form = compact_encode<T>(*this, this->_rows, this->_cols, false);
+    if (send_form == _AUTO_FORM && compact_form.size() >= size_t(this->_rows) * this->_cols * sizeof(T))
+    {
+        compact_form.clear();
+        return _DENSE_FORM;
+    }
+    return _COMPACT_FORM;
+}
+
 /*
  * Sends a DenseMatrix2D<T> using MPI_Send.
  * @pram int destination processor
  * @pram int tag 
- * @pram bool sending sparse form, default value is false.
+ * @pram int send form: dense, _COMPACT_FORM or _AUTO_FORM (default) to send the smaller one.
  */
 template <typename T>
-inline void DenseMatrix2D<T>::MPI_Send_Matrix(int dest, int tag, bool sparse)
+inline void DenseMatrix2D<T>::MPI_Send_Matrix(int dest, int tag, int send_form)
 {
-    if(sparse)
+    std::vector<unsigned char> compact_form;
+    if (_chooseSendForm(send_form, compact_form) == _COMPACT_FORM)
     {
         MPI_MatrixInfo mat_info;
-        std::vector<SparseElement<T> > sparse_form = this->getSparseForm();
-        mat_info.setValues(this->_rows, this->_cols, sparse_form.size(), _SPARSE_FORM);
+        mat_info.setValues(this->_rows, this->_cols, compact_form.size(), _COMPACT_FORM);
         MPI_Send(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, dest, tag + 1, MPI_COMM_WORLD);
-        MPI_Send(&sparse_form[0], sparse_form.size()*sizeof(SparseElement<T>), MPI_BYTE, dest, tag + 2, MPI_COMM_WORLD);
+        MPI_Send(&compact_form[0], compact_form.size(), MPI_BYTE, dest, tag + 2, MPI_COMM_WORLD);
     }
     else
     {
@@ -750,18 +743,18 @@ inline void DenseMatrix2D<T>::MPI_Send_Matrix(int dest, int tag, bool sparse)
 /*
  * Sends a DenseMatrix2D<T> using MPI_Bcast.
  * @pram int sourse sender's ID
- * @pram bool sending sparse form, default value is false.
+ * @pram int send form: dense, _COMPACT_FORM or _AUTO_FORM (default) to send the smaller one.
  */
 template <typename T>
-inline void DenseMatrix2D<T>::MPI_Bcast_Send_Matrix(int source, bool sparse)
+inline void DenseMatrix2D<T>::MPI_Bcast_Send_Matrix(int source, int send_form)
 {
-    if(sparse)
+    std::vector<unsigned char> compact_form;
+    if (_chooseSendForm(send_form, compact_form) == _COMPACT_FORM)
     {
         MPI_MatrixInfo mat_info;
-        std::vector<SparseElement<T> > sparse_form = this->getSparseForm();
-        mat_info.setValues(this->_rows, this->_cols, sparse_form.size(), _SPARSE_FORM);
+        mat_info.setValues(this->_rows, this->_cols, compact_form.size(), _COMPACT_FORM);
         MPI_Bcast(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, source, MPI_COMM_WORLD);
-        MPI_Bcast(&sparse_form[0], sparse_form.size()*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
+        MPI_Bcast(&compact_form[0], compact_form.size(), MPI_BYTE, source, MPI_COMM_WORLD);
     }
     else
     {
@@ -0,0 +1,211 @@
+/************************************************************************************
+ * This file contains the selector of the eigen solver backend of a component.      *
+ * Every backend of EigenSolvers.h that was compiled in is available in the same    *
+ * binary and the backend is chosen per component by its size: the dense solver     *
+ * wins on tiny components, where building the full matrix costs nothing and the    *
+ * Krylov solvers pay for their iterations, while ARPACK and Lanczos win on the     *
+ * large ones, where the dense solve is cubic. By default the selector uses a fixed *
+ * crossover, so a run gives the same results on every machine. Where the fastest   *
+ * crossover is depends on the machine: calibrate() times the backends on synthetic *
+ * components of a few sizes and a component then uses the backend that was         *
+ * fastest for the largest calibrated size that is not larger than it.              *
+ ************************************************************************************/
+
+#ifndef _EigenBackends_h
+#define _EigenBackends_h
+
+#include <chrono>
+#include <vector>
+#include "SymMatrix.h"
+#include "NormalizedOperator.h"
+#include "EigenSolvers.h"
+
+/*
+ * sizes of the synthetic components timed by calibrate(), the dense solver is not timed any more
+ * once it is DENSE_CALIBRATION_CUTOFF times slower than the fastest backend
+ */
+static const int NUM_OF_CALIBRATION_SIZES = 4;
+static const int CALIBRATION_SIZES[NUM_OF_CALIBRATION_SIZES] = {8, 32, 128, 512};
+static const int CALIBRATION_REPEATS = 3;
+static const double DENSE_CALIBRATION_CUTOFF = 2;
+
+/*
+ * EigenSolverSelector class: the backend of every calibrated size.
+ */
+class EigenSolverSelector
+{
+private:
+    int _backends[NUM_OF_CALIBRATION_SIZES];
+    double _times[NUM_OF_CALIBRATION_SIZES][NUM_OF_EIGEN_BACKENDS];
+    bool _calibrated;
+
+    template <typename T>
+    double _timeBackend(int backend, int size, double tolerance);
+
+public:
+    EigenSolverSelector();
+
+    template <typename T>
+    void calibrate(double tolerance);
+    int choose(int size);
+    bool isCalibrated();
+    double getTime(int size_index, int backend);
+    void getTable(int* backends);
+    void setTable(const int* backends);
+};
+
+/*
+ * Constructor: the fixed crossover, the dense solver up to 32 nodes and a Krylov solver above.
+ */
+inline EigenSolverSelector::EigenSolverSelector()
+{
+    for (int s = 0; s < NUM_OF_CALIBRATION_SIZES; s++)
+    {
+        int krylov = eigen_backend_available(EIGEN_BACKEND_ARPACK) ? EIGEN_BACKEND_ARPACK : EIGEN_BACKEND_LANCZOS;
+        this->_backends[s] = CALIBRATION_SIZES[s] <= 32 ? EIGEN_BACKEND_DENSE : krylov;
+        for (int b = 0; b < NUM_OF_EIGEN_BACKENDS; b++)
+        {
+            this->_times[s][b] = -1;
+        }
+    }
+    this->_calibrated = false;
+}
+
+/*
+ * Times every available backend on a synthetic component of every calibrated size and keeps the
+ * fastest one of each size. A backend is timed CALIBRATION_REPEATS times and its best time is kept.
+ * @pram double: tolerance of the residual of the Lanczos backend
+ */
+template <typename T>
+inline void EigenSolverSelector::calibrate(double tolerance)
+{
+    bool time_dense = true;
+    for (int s = 0; s < NUM_OF_CALIBRATION_SIZES; s++)
+    {
+        int best = -1;
+        for (int b = 0; b < NUM_OF_EIGEN_BACKENDS; b++)
+        {
+            if (!eigen_backend_available(b) || (b == EIGEN_BACKEND_DENSE && !time_dense))
+            {
+                continue;
+            }
+            double time = _timeBackend<T>(b, CALIBRATION_SIZES[s], tolerance);
+            for (int r = 1; r < CALIBRATION_REPEATS; r++)
+            {
+                time = std::min(time, _timeBackend<T>(b, CALIBRATION_SIZES[s], tolerance));
+            }
+            this->_times[s][b] = time;
+            if (best < 0 || time < this->_times[s][best])
+            {
+                best = b;
+            }
+        }
+        this->_backends[s] = best;
+
+        //the dense solve is cubic, once it lost by far it only gets worse
+        if (time_dense && this->_times[s][EIGEN_BACKEND_DENSE] > DENSE_CALIBRATION_CUTOFF * this->_times[s][best])
+        {
+            time_dense = false;
+        }
+    }
+    this->_calibrated = true;
+}
+
+/*
+ * Returns the backend of a component: the backend of the largest calibrated size that is not
+ * larger than the component, or of the smallest size for smaller components.
+ * @pram int: number of nodes of the component
+ */
+inline int EigenSolverSelector::choose(int size)
+{
+    int s = 0;
+    while (s + 1 < NUM_OF_CALIBRATION_SIZES && CALIBRATION_SIZES[s + 1] <= size)
+    {
+        s++;
+    }
+    return this->_backends[s];
+}
+
+/*
+ * Returns true if the backends were chosen by calibrate() or setTable().
+ */
+inline bool EigenSolverSelector::isCalibrated()
+{
+    return this->_calibrated;
+}
+
+/*
+ * Returns the best time in milliseconds of a backend on a calibrated size, -1 if it was not timed.
+ * @pram int: index of the size in CALIBRATION_SIZES
+ * @pram int: one of the EIGEN_BACKEND_ constants
+ */
+inline double EigenSolverSelector::getTime(int size_index, int backend)
+{
+    return this->_times[size_index][backend];
+}
+
+/*
+ * Copies the backend of every calibrated size, so the master can send its calibration to the other processors.
+ * @pram int*: array of NUM_OF_CALIBRATION_SIZES backends
+ */
+inline void EigenSolverSelector::getTable(int* backends)
+{
+    for (int s = 0; s < NUM_OF_CALIBRATION_SIZES; s++)
+    {
+        backends[s] = this->_backends[s];
+    }
+}
+
+/*
+ * Sets the backend of every calibrated size.
+ * @pram int*: array of NUM_OF_CALIBRATION_SIZES backends
+ */
+inline void EigenSolverSelector::setTable(const int* backends)
+{
+    for (int s = 0; s < NUM_OF_CALIBRATION_SIZES; s++)
+    {
+        this->_backends[s] = backends[s];
+    }
+    this->_calibrated = true;
+}
+
+/*
+ * returns the time in milliseconds one backend takes to solve a synthetic component: a ring with a chord
+ * from every other node to a node picked by its square. The degrees are not all the same, like in a
+ * component of a kronecker product, otherwise the constant start vector of the Lanczos backend would
+ * already be the eigenvector.
+ */
+template <typename T>
+inline double EigenSolverSelector::_timeBackend(int backend, int size, double tolerance)
+{
+    SymMatrix<T> matrix(size);
+    std::vector<int> members(size);
+    for (int i = 0; i < size; i++)
+    {
+        members[i] = i;
+        matrix(i, (i + 1) % size) = 1;
+        int chord = (i * i + 3) % size;
+        if (i % 2 == 0 && chord != i)
+        {
+            matrix(i, chord) = 1;
+        }
+    }
+    NormalizedOperator<T> component(matrix, &members[0], size);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    T* eigen_vector = component.getTopEigenVector(backend, tolerance);
+    std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+    delete [] eigen_vector;
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/*
+ * Returns the selector shared by all threads, it is only changed before the pairs are computed.
+ */
+inline EigenSolverSelector& eigen_solver_selector()
+{
+    static EigenSolverSelector selector;
+    return selector;
+}
+
+#endif
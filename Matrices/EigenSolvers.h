@@ -0,0 +1,256 @@
+/************************************************************************************
+ * Eigen solvers that do not depend on ARPACK or Eigen.                             *
+ *                                                                                  *
+ * lanczos_top_eigenvector is the mixed precision solver of the Lanczos backend:     *
+ * the operator keeps its entries in the matrix type (float by default) and only    *
+ * reads them, while the Lanczos vectors, the dot products and the norms are kept   *
+ * in double. After every Lanczos sweep the residual ||A*x - theta*x|| of the Ritz  *
+ * vector is computed in double and the sweep is restarted from the Ritz vector     *
+ * until it is below the requested tolerance, so the result is as accurate as the   *
+ * float entries allow while the matvecs only stream half the bytes of double.      *
+ ************************************************************************************/
+
+#ifndef _EigenSolvers_h
+#define _EigenSolvers_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+static const int LANCZOS_SWEEP_SIZE = 40;
+static const int LANCZOS_MAX_RESTARTS = 50;
+
+/*
+ * Backends of the eigen solve of a component (NormalizedOperator::getTopEigenVector). ARPACK is only
+ * available with -DARPACK, the dense backend uses Eigen with -DEIGEN and jacobi_eigen otherwise, and the
+ * Lanczos backend is lanczos_top_eigenvector. EIGEN_BACKEND_AUTO leaves the choice to the size
+ * selector of EigenBackends.h.
+ */
+static const int EIGEN_BACKEND_AUTO = -1;
+static const int EIGEN_BACKEND_ARPACK = 0;
+static const int EIGEN_BACKEND_DENSE = 1;
+static const int EIGEN_BACKEND_LANCZOS = 2;
+static const int NUM_OF_EIGEN_BACKENDS = 3;
+static const char* const EIGEN_BACKEND_NAMES[NUM_OF_EIGEN_BACKENDS] = {"arpack", "dense", "lanczos"};
+
+/*
+ * returns true if the backend was compiled in
+ * @pram: one of the EIGEN_BACKEND_ constants
+ */
+inline bool eigen_backend_available(int backend)
+{
+#ifndef ARPACK
+    if (backend == EIGEN_BACKEND_ARPACK)
+    {
+        return false;
+    }
+#endif
+    return backend >= 0 && backend < NUM_OF_EIGEN_BACKENDS;
+}
+
+/*
+ * Computes the eigenvalues and eigenvectors of a small dense symmetric matrix with the cyclic Jacobi method.
+ * @pram: row major k x k matrix, destroyed
+ * @pram: size k
+ * @pram: set to the k eigenvalues
+ * @pram: set to the row major k x k matrix whose column c is the eigenvector of eigenvalue c
+ */
+inline void jacobi_eigen(std::vector<double>& matrix, int k, std::vector<double>& eigenvalues, std::vector<double>& eigenvectors)
+{
+    eigenvectors.assign(k * k, 0);
+    for (int i = 0; i < k; i++)
+    {
+        eigenvectors[i * k + i] = 1;
+    }
+
+    for (int sweep = 0; sweep < 100; sweep++)
+    {
+        double off_diagonal = 0;
+        for (int p = 0; p < k; p++)
+        {
+            for (int q = p + 1; q < k; q++)
+            {
+                off_diagonal += matrix[p * k + q] * matrix[p * k + q];
+            }
+        }
+        if (off_diagonal < 1e-30)
+        {
+            break;
+        }
+
+        for (int p = 0; p < k; p++)
+        {
+            for (int q = p + 1; q < k; q++)
+            {
+                double a_pq = matrix[p * k + q];
+                if (std::fabs(a_pq) < 1e-300)
+                {
+                    continue;
+                }
+                double theta = (matrix[q * k + q] - matrix[p * k + p]) / (2 * a_pq);
+                double t = (theta >= 0 ? 1.0 : -1.0) / (std::fabs(theta) + std::sqrt(theta * theta + 1));
+                double c = 1 / std::sqrt(t * t + 1);
+                double s = t * c;
+                for (int r = 0; r < k; r++)
+                {
+                    double a_rp = matrix[r * k + p];
+                    double a_rq = matrix[r * k + q];
+                    matrix[r * k + p] = c * a_rp - s * a_rq;
+                    matrix[r * k + q] = s * a_rp + c * a_rq;
+                }
+                for (int r = 0; r < k; r++)
+                {
+                    double a_pr = matrix[p * k + r];
+                    double a_qr = matrix[q * k + r];
+                    matrix[p * k + r] = c * a_pr - s * a_qr;
+                    matrix[q * k + r] = s * a_pr + c * a_qr;
+                }
+                for (int r = 0; r < k; r++)
+                {
+                    double v_rp = eigenvectors[r * k + p];
+                    double v_rq = eigenvectors[r * k + q];
+                    eigenvectors[r * k + p] = c * v_rp - s * v_rq;
+                    eigenvectors[r * k + q] = s * v_rp + c * v_rq;
+                }
+            }
+        }
+    }
+
+    eigenvalues.resize(k);
+    for (int i = 0; i < k; i++)
+    {
+        eigenvalues[i] = matrix[i * k + i];
+    }
+}
+
+/*
+ * Returns the unit eigenvector of the largest eigenvalue of a symmetric operator, computed with
+ * restarted Lanczos and full reorthogonalization in double.
+ * @pram: the operator, it must have a method multMvMixed(const double* vec, double* result)
+ * @pram: number of rows of the operator
+ * @pram: the sweeps stop once ||A*x - theta*x|| <= tolerance * max(|theta|, 1)
+ * @pram: set to the largest eigenvalue
+ */
+template <typename Operator>
+std::vector<double> lanczos_top_eigenvector(Operator& op, int size, double tolerance, double& eigenvalue)
+{
+    std::vector<double> ritz_vector(size, 1.0 / std::sqrt((double)size));
+    eigenvalue = 0;
+    if (size == 1)
+    {
+        std::vector<double> result(1);
+        op.multMvMixed(&ritz_vector[0], &result[0]);
+        eigenvalue = result[0];
+        return ritz_vector;
+    }
+
+    int sweep_size = std::min(size, LANCZOS_SWEEP_SIZE);
+    std::vector<double> basis(size_t(sweep_size) * size);
+    std::vector<double> alpha(sweep_size);
+    std::vector<double> beta(sweep_size);
+    std::vector<double> w(size);
+
+    for (int restart = 0; restart < LANCZOS_MAX_RESTARTS; restart++)
+    {
+        std::copy(ritz_vector.begin(), ritz_vector.end(), basis.begin());
+        int steps = 0;
+        while (steps < sweep_size)
+        {
+            double* v = &basis[size_t(steps) * size];
+            op.multMvMixed(v, &w[0]);
+            alpha[steps] = 0;
+            for (int i = 0; i < size; i++)
+            {
+                alpha[steps] += w[i] * v[i];
+            }
+            steps++;
+
+            //orthogonalize against every basis vector, twice, so the basis stays orthogonal in double
+            for (int pass = 0; pass < 2; pass++)
+            {
+                for (int b = 0; b < steps; b++)
+                {
+                    const double* u = &basis[size_t(b) * size];
+                    double dot = 0;
+                    for (int i = 0; i < size; i++)
+                    {
+                        dot += w[i] * u[i];
+                    }
+                    for (int i = 0; i < size; i++)
+                    {
+                        w[i] -= dot * u[i];
+                    }
+                }
+            }
+            double norm = 0;
+            for (int i = 0; i < size; i++)
+            {
+                norm += w[i] * w[i];
+            }
+            norm = std::sqrt(norm);
+            //the basis spans an invariant subspace, its Ritz values are exact
+            if (steps == sweep_size || norm < 1e-12)
+            {
+                break;
+            }
+            beta[steps - 1] = norm;
+            double* next = &basis[size_t(steps) * size];
+            for (int i = 0; i < size; i++)
+            {
+                next[i] = w[i] / norm;
+            }
+        }
+
+        //largest Ritz pair of the tridiagonal matrix of the sweep
+        std::vector<double> tridiagonal(size_t(steps) * steps, 0);
+        for (int i = 0; i < steps; i++)
+        {
+            tridiagonal[i * steps + i] = alpha[i];
+            if (i + 1 < steps)
+            {
+                tridiagonal[i * steps + i + 1] = tridiagonal[(i + 1) * steps + i] = beta[i];
+            }
+        }
+        std::vector<double> ritz_values, ritz_coefficients;
+        jacobi_eigen(tridiagonal, steps, ritz_values, ritz_coefficients);
+        int top = std::max_element(ritz_values.begin(), ritz_values.end()) - ritz_values.begin();
+        eigenvalue = ritz_values[top];
+
+        std::fill(ritz_vector.begin(), ritz_vector.end(), 0.0);
+        for (int b = 0; b < steps; b++)
+        {
+            double coefficient = ritz_coefficients[b * steps + top];
+            const double* u = &basis[size_t(b) * size];
+            for (int i = 0; i < size; i++)
+            {
+                ritz_vector[i] += coefficient * u[i];
+            }
+        }
+        double norm = 0;
+        for (int i = 0; i < size; i++)
+        {
+            norm += ritz_vector[i] * ritz_vector[i];
+        }
+        norm = std::sqrt(norm);
+        for (int i = 0; i < size; i++)
+        {
+            ritz_vector[i] /= norm;
+        }
+
+        //refinement: stop once the residual of the Ritz pair is small enough
+        op.multMvMixed(&ritz_vector[0], &w[0]);
+        double residual = 0;
+        for (int i = 0; i < size; i++)
+        {
+            double r = w[i] - eigenvalue * ritz_vector[i];
+            residual += r * r;
+        }
+        if (std::sqrt(residual) <= tolerance * std::max(std::fabs(eigenvalue), 1.0))
+        {
+            break;
+        }
+    }
+    return ritz_vector;
+}
+
+#endif
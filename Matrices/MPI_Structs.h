@@ -11,31 +11,44 @@
  */
 struct IsoRank_Result
 {
+    int graph_i;
+    int graph_j;
     int frob_norm;
+    float score;
     int assignment_length;
     int* assignments;
+    int trials;
 };
 
 
 #ifdef USE_MPI
 #include "mpi.h"
+#include <vector>
+#include <list>
+#include <cstring>
+#include <algorithm>
 
 
-static const unsigned short _DENSE_FORM = 0;
-static const unsigned short _SPARSE_FORM = 1;
-static const unsigned short _SYM_DENSE_FORM = 2;
-static const unsigned short _SYM_SPARSE_FORM = 3;
+/*
+ * Forms a matrix is sent in. _AUTO_FORM is only requested by the sender, it picks the
+ * compact form (see CompactForm.h) when it is smaller than the dense one.
+ */
+static const int _DENSE_FORM = 0;
+static const int _COMPACT_FORM = 1;
+static const int _SYM_DENSE_FORM = 2;
+static const int _AUTO_FORM = 3;
 
 /*
- * Structure to send the matrix meta data.
+ * Structure to send the matrix meta data. recv_size is the number of values of
+ * the dense forms and the number of bytes of the compact form.
  */
 struct MPI_MatrixInfo
 {
-    unsigned short rows;
-    unsigned short cols;
-    unsigned short recv_size;
-    unsigned short send_form;
-    void setValues(unsigned short num_rows, unsigned short num_cols, unsigned short num_recv_size, const unsigned short const_send_form)
+    int rows;
+    int cols;
+    int recv_size;
+    int send_form;
+    void setValues(int num_rows, int num_cols, int num_recv_size, int const_send_form)
     {
         rows = num_rows;
         cols = num_cols;
@@ -77,6 +90,10 @@ void MPI_Send_IsoRank_Result (IsoRank_Result result, int dest, int tag)
     MPI_Send(&result.assignment_length, 1, MPI_INT, dest, tag + 1, MPI_COMM_WORLD);
     MPI_Send(result.assignments, result.assignment_length, MPI_INT, dest, tag + 2, MPI_COMM_WORLD);
     MPI_Send(&result.frob_norm, 1, MPI_INT, dest, tag + 3, MPI_COMM_WORLD);
+    int pair[2] = {result.graph_i, result.graph_j};
+    MPI_Send(pair, 2, MPI_INT, dest, tag + 4, MPI_COMM_WORLD);
+    MPI_Send(&result.score, 1, MPI_FLOAT, dest, tag + 5, MPI_COMM_WORLD);
+    MPI_Send(&result.trials, 1, MPI_INT, dest, tag + 6, MPI_COMM_WORLD);
 }
 
 /*
@@ -92,8 +109,123 @@ struct IsoRank_Result MPI_Recv_IsoRank_Result(int source, int tag, MPI_Status& s
     result.assignments = new int[result.assignment_length];
     MPI_Recv(result.assignments ,result.assignment_length , MPI_INT, source, tag + 2, MPI_COMM_WORLD, &stat);
     MPI_Recv(&result.frob_norm, 1, MPI_INT, source, tag + 3, MPI_COMM_WORLD, &stat);
+    int pair[2];
+    MPI_Recv(pair, 2, MPI_INT, source, tag + 4, MPI_COMM_WORLD, &stat);
+    result.graph_i = pair[0];
+    result.graph_j = pair[1];
+    MPI_Recv(&result.score, 1, MPI_FLOAT, source, tag + 5, MPI_COMM_WORLD, &stat);
+    MPI_Recv(&result.trials, 1, MPI_INT, source, tag + 6, MPI_COMM_WORLD, &stat);
     return result;
 }
 
+/*
+ * class used to send batches of IsoRank_Result structs without blocking. Every batch is one
+ * message: the number of results followed by graph_i, graph_j, frob_norm, score, trials, assignment_length
+ * and the assignments of every result. The buffers are kept until the messages are delivered.
+ */
+class IsoRank_Result_Sender
+{
+private:
+    std::list<std::vector<int> > _buffers;
+    std::list<MPI_Request> _requests;
+
+    /*
+     * frees the buffers of the messages that were delivered
+     */
+    void _release()
+    {
+        std::list<std::vector<int> >::iterator buffer_it = _buffers.begin();
+        std::list<MPI_Request>::iterator request_it = _requests.begin();
+        while (request_it != _requests.end())
+        {
+            int done;
+            MPI_Test(&(*request_it), &done, MPI_STATUS_IGNORE);
+            if (done)
+            {
+                buffer_it = _buffers.erase(buffer_it);
+                request_it = _requests.erase(request_it);
+            }
+            else
+            {
+                ++buffer_it;
+                ++request_it;
+            }
+        }
+    }
+
+public:
+    /*
+     * starts sending a batch of results, the results can be deleted as soon as it returns
+     * @pram: result structs of isorank
+     * @pram: the destination processor
+     * @pram: the tag used for the MPI call
+     */
+    void send(const std::vector<IsoRank_Result>& results, int dest, int tag)
+    {
+        _release();
+        _buffers.push_back(std::vector<int>(1, results.size()));
+        std::vector<int>& buffer = _buffers.back();
+        for (int r = 0; r < results.size(); r++)
+        {
+            int score;
+            std::memcpy(&score, &results[r].score, sizeof(int));
+            buffer.push_back(results[r].graph_i);
+            buffer.push_back(results[r].graph_j);
+            buffer.push_back(results[r].frob_norm);
+            buffer.push_back(score);
+            buffer.push_back(results[r].trials);
+            buffer.push_back(results[r].assignment_length);
+            buffer.insert(buffer.end(), results[r].assignments, results[r].assignments + results[r].assignment_length);
+        }
+        _requests.push_back(MPI_Request());
+        MPI_Isend(&buffer[0], buffer.size(), MPI_INT, dest, tag, MPI_COMM_WORLD, &_requests.back());
+    }
+
+    /*
+     * waits until every batch was delivered
+     */
+    void waitAll()
+    {
+        std::list<MPI_Request>::iterator request_it;
+        for (request_it = _requests.begin(); request_it != _requests.end(); ++request_it)
+        {
+            MPI_Wait(&(*request_it), MPI_STATUS_IGNORE);
+        }
+        _requests.clear();
+        _buffers.clear();
+    }
+};
+
+/*
+ * function used to receive a batch of IsoRank_Result structs sent by an IsoRank_Result_Sender
+ * @pram: the source processor, can be MPI_ANY_SOURCE. stat.MPI_SOURCE is set to the sender
+ * @pram: the tag used by the MPI call
+ * @pram: the MPI_Status object used by the MPI_calls
+ */
+std::vector<IsoRank_Result> MPI_Recv_IsoRank_Results(int source, int tag, MPI_Status& stat)
+{
+    int buffer_size;
+    MPI_Probe(source, tag, MPI_COMM_WORLD, &stat);
+    MPI_Get_count(&stat, MPI_INT, &buffer_size);
+    std::vector<int> buffer(buffer_size);
+    MPI_Recv(&buffer[0], buffer_size, MPI_INT, stat.MPI_SOURCE, tag, MPI_COMM_WORLD, &stat);
+
+    std::vector<IsoRank_Result> results(buffer[0]);
+    int position = 1;
+    for (int r = 0; r < results.size(); r++)
+    {
+        results[r].graph_i = buffer[position++];
+        results[r].graph_j = buffer[position++];
+        results[r].frob_norm = buffer[position++];
+        std::memcpy(&results[r].score, &buffer[position++], sizeof(int));
+        results[r].trials = buffer[position++];
+        results[r].assignment_length = buffer[position++];
+        results[r].assignments = new int[results[r].assignment_length];
+        std::copy(buffer.begin() + position, buffer.begin() + position + results[r].assignment_length, results[r].assignments);
+        position += results[r].assignment_length;
+    }
+    return results;
+}
+
 #endif
 #endif
\ No newline at end of file
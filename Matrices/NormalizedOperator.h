@@ -0,0 +1,402 @@
+/************************************************************************************
+ * NormalizedOperator: the normalized matrix D^-1/2 * L * D^-1/2 of a component of  *
+ * a symmetric matrix, where L is the part of the matrix on the rows and columns of *
+ * the component and D the diagonal matrix of the row sums of L. Nothing is copied: *
+ * the entries are computed from the packed SymMatrix and the member list of the    *
+ * component when they are needed, so a component takes O(n) memory instead of the *
+ * selection, the two scaled copies and the symmetry check of the dense path.       *
+ ************************************************************************************/
+
+#ifndef _NormalizedOperator_h
+#define _NormalizedOperator_h
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "MatrixExceptions.h"
+#include "SymMatrix.h"
+#include "EigenSolvers.h"
+
+#ifdef EIGEN
+#include <Eigen/Dense>
+#endif
+
+#ifdef ARPACK
+#include <mutex>
+#include "arssym.h"
+
+/*
+ * ARPACK keeps its state in static Fortran variables, so only one thread at a time can use it.
+ */
+std::mutex& arpack_mutex()
+{
+    static std::mutex mutex;
+    return mutex;
+}
+#endif
+
+/*
+ * NormalizedOperator class definition and method declarations.
+ */
+template <typename T>
+class NormalizedOperator
+{
+private:
+    SymMatrix<T>* _matrix;
+    const int* _members;
+    int _size;
+    std::vector<size_t> _column_starts;
+    std::vector<T> _d_0pt5;
+    std::vector<T> _d_neg0pt5;
+    std::vector<T> _scaled_vec;
+    std::vector<double> _mixed_scaled_vec;
+
+    T* _topEigenVectorArpack();
+    T* _topEigenVectorDense();
+
+public:
+    /**************
+     *Constructors*
+     **************/
+    NormalizedOperator(SymMatrix<T>& matrix, const int* members, int size);
+
+    /***********
+     *ACCESSORS*
+     ***********/
+    int getSize();
+    const std::vector<T>& getSqrtOfDegrees();
+    bool isSymmetric();
+
+    /**********
+    *OPERATIONS*
+    **********/
+    void multMv(T* vec, T* result);
+    void multMvMixed(const double* vec, double* result);
+    T* getTopEigenVector();
+    T* getTopEigenVector(int backend, double tolerance);
+    T* getTopEigenVectorMixed(double tolerance);
+
+    /**********
+     *OPERATORS*
+     **********/
+    T operator()(int i, int j);
+};
+
+//==========================================================CONSTRUCTORS============================================================
+/*
+ * NormalizedOperator constructor:
+ * Computes the row sums of the component, the only values that are stored.
+ * @pram SymMatrix<T>: the matrix, it has to outlive the operator
+ * @pram int*: rows (and columns) of the matrix that are in the component, in increasing order. They are not copied
+ * @pram int: number of rows in the component
+ */
+template <typename T>
+inline NormalizedOperator<T>::NormalizedOperator(SymMatrix<T>& matrix, const int* members, int size)
+{
+    this->_matrix = &matrix;
+    this->_members = members;
+    this->_size = size;
+    this->_column_starts.resize(size);
+    this->_scaled_vec.resize(size);
+    for (int j = 0; j < size; j++)
+    {
+        if (members[j] < 0 || members[j] >= matrix._size || (j > 0 && members[j] <= members[j-1]))
+        {
+            throw IndexOutOfBoundsException();
+        }
+        this->_column_starts[j] = size_t(members[j]) * (members[j] + 1) / 2;
+    }
+
+    //row sums in the same order as SymMatrix::getSumOfRows
+    std::vector<T> sum(size);
+    for (int j = 0; j < size; j++)
+    {
+        const T* column = matrix._edges + this->_column_starts[j];
+        for (int i = 0; i < j; i++)
+        {
+            sum[i] += column[members[i]];
+            sum[j] += column[members[i]];
+        }
+        sum[j] += column[members[j]];
+    }
+
+    this->_d_0pt5.resize(size);
+    this->_d_neg0pt5.resize(size);
+    for (int j = 0; j < size; j++)
+    {
+        this->_d_0pt5[j] = sqrt(sum[j]);
+        this->_d_neg0pt5[j] = 1.0/this->_d_0pt5[j];
+    }
+}
+
+//===========================================================ACCESSORS===============================================================
+/*
+ * Returns the number of nodes in the component.
+ */
+template <typename T>
+inline int NormalizedOperator<T>::getSize()
+{
+    return this->_size;
+}
+
+/*
+ * Returns the diagonal of D^1/2, used to turn the eigenvector of the operator back into scores.
+ */
+template <typename T>
+inline const std::vector<T>& NormalizedOperator<T>::getSqrtOfDegrees()
+{
+    return this->_d_0pt5;
+}
+
+/*
+ * Returns true if entry (i, j) is equal to entry (j, i) for every i, j. This is O(n^2) and
+ * only meant for debug assertions: the entries are always computed in the same order so
+ * the operator is symmetric by construction.
+ */
+template <typename T>
+inline bool NormalizedOperator<T>::isSymmetric()
+{
+    for (int i = 0; i < this->getSize(); i++)
+    {
+        for (int j = 0; j < i; j++)
+        {
+            if ((*this)(i, j) != (*this)(j, i))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+//===========================================================OPERATIONS================================================================
+/*
+ * result = D^-1/2 * L * D^-1/2 * vec, computed from the packed matrix without building L.
+ * The signature is the one ARPACK++ expects for the product of the operator and a vector.
+ * @pram T* vector of size n
+ * @pram T* array of size n that is set to the product
+ */
+template <typename T>
+inline void NormalizedOperator<T>::multMv(T* vec, T* result)
+{
+    int size = this->getSize();
+    const int* members = this->_members;
+    for (int j = 0; j < size; j++)
+    {
+        this->_scaled_vec[j] = this->_d_neg0pt5[j] * vec[j];
+        result[j] = 0;
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        const T* column = this->_matrix->_edges + this->_column_starts[j];
+        T scaled_j = this->_scaled_vec[j];
+        T column_sum = 0;
+        for (int i = 0; i < j; i++)
+        {
+            T value = column[members[i]];
+            result[i] += value * scaled_j;
+            column_sum += value * this->_scaled_vec[i];
+        }
+        result[j] += column_sum + column[members[j]] * scaled_j;
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        result[j] *= this->_d_neg0pt5[j];
+    }
+}
+
+/*
+ * result = D^-1/2 * L * D^-1/2 * vec like multMv, but the vectors and the sums are in double while
+ * the entries are still read in T. Used by the mixed precision solver.
+ * @pram double* vector of size n
+ * @pram double* array of size n that is set to the product
+ */
+template <typename T>
+inline void NormalizedOperator<T>::multMvMixed(const double* vec, double* result)
+{
+    int size = this->getSize();
+    const int* members = this->_members;
+    this->_mixed_scaled_vec.resize(size);
+    for (int j = 0; j < size; j++)
+    {
+        this->_mixed_scaled_vec[j] = this->_d_neg0pt5[j] * vec[j];
+        result[j] = 0;
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        const T* column = this->_matrix->_edges + this->_column_starts[j];
+        double scaled_j = this->_mixed_scaled_vec[j];
+        double column_sum = 0;
+        for (int i = 0; i < j; i++)
+        {
+            double value = column[members[i]];
+            result[i] += value * scaled_j;
+            column_sum += value * this->_mixed_scaled_vec[i];
+        }
+        result[j] += column_sum + column[members[j]] * scaled_j;
+    }
+
+    for (int j = 0; j < size; j++)
+    {
+        result[j] *= this->_d_neg0pt5[j];
+    }
+}
+
+/*
+ * Returns an array that contains the values of the eigenvector associated to the largest eigenvalue,
+ * computed by ARPACK if it was compiled in and by the dense solver otherwise.
+ */
+template <typename T>
+inline T* NormalizedOperator<T>::getTopEigenVector()
+{
+#ifdef ARPACK
+    return getTopEigenVector(EIGEN_BACKEND_ARPACK, 0);
+#else
+    return getTopEigenVector(EIGEN_BACKEND_DENSE, 0);
+#endif
+}
+
+/*
+ * Returns an array that contains the values of the eigenvector associated to the largest eigenvalue,
+ * computed by one of the backends of EigenSolvers.h. A backend that was not compiled in falls back
+ * to the dense solver.
+ * @pram int: one of the EIGEN_BACKEND_ constants, not EIGEN_BACKEND_AUTO
+ * @pram double: tolerance of the residual of the Lanczos backend
+ */
+template <typename T>
+inline T* NormalizedOperator<T>::getTopEigenVector(int backend, double tolerance)
+{
+    switch (backend)
+    {
+        case EIGEN_BACKEND_LANCZOS:
+            return getTopEigenVectorMixed(tolerance);
+#ifdef ARPACK
+        case EIGEN_BACKEND_ARPACK:
+            return _topEigenVectorArpack();
+#endif
+        case EIGEN_BACKEND_DENSE:
+        default:
+            return _topEigenVectorDense();
+    }
+}
+
+/*
+ * Returns an array that contains the values of the eigenvector associated to the largest eigenvalue,
+ * computed by the mixed precision Lanczos solver of EigenSolvers.h instead of ARPACK/Eigen.
+ * @pram double: tolerance of the residual of the eigenvector
+ */
+template <typename T>
+inline T* NormalizedOperator<T>::getTopEigenVectorMixed(double tolerance)
+{
+    PERF_SCOPE(PERF_SITE_TOP_EIGENVECTOR);
+    int size = this->getSize();
+    double eigenvalue;
+    std::vector<double> top_vector = lanczos_top_eigenvector(*this, size, tolerance, eigenvalue);
+    T* eigen_vector = new T[size];
+    for (int i = 0; i < size; i++)
+    {
+        eigen_vector[i] = top_vector[i];
+    }
+    return eigen_vector;
+}
+
+/*
+ * eigenvector of the largest eigenvalue computed by ARPACK, which only needs the product of the operator and a vector
+ */
+#ifdef ARPACK
+template <typename T>
+inline T* NormalizedOperator<T>::_topEigenVectorArpack()
+{
+    PERF_SCOPE(PERF_SITE_TOP_EIGENVECTOR);
+    int size = this->getSize();
+    std::lock_guard<std::mutex> arpack_lock(arpack_mutex());
+    ARSymStdEig<T, NormalizedOperator<T> > eigProb(size, 1, this, &NormalizedOperator<T>::multMv, "LM", 10);
+    eigProb.FindEigenvectors();
+    T* eigen_vector = new T[size];
+
+    for (int i=0; i < size; i++)
+    {
+        eigen_vector[i] = eigProb.Eigenvector(0,i);
+    }
+    return eigen_vector;
+}
+#endif
+
+/*
+ * eigenvector of the largest eigenvalue computed from the full matrix of the operator, by Eigen if it was
+ * compiled in and by jacobi_eigen otherwise
+ */
+template <typename T>
+inline T* NormalizedOperator<T>::_topEigenVectorDense()
+{
+    PERF_SCOPE(PERF_SITE_TOP_EIGENVECTOR);
+    int size = this->getSize();
+    T* eigen_vector = new T[size];
+#ifdef EIGEN
+    //the solver only reads the lower triangle
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> A_eigen(size, size);
+    for (int j = 0; j < size; j++)
+    {
+        for (int i = 0; i <= j; i++)
+        {
+            A_eigen(j,i) = (*this)(i, j);
+        }
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es;
+    es.compute(A_eigen);
+
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> evals_eigen = es.eigenvalues();
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> evecs_eigen = es.eigenvectors();
+
+    for ( int i=0; i < size; i++)
+    {
+        if (evals_eigen(i) == evals_eigen.maxCoeff())
+        {
+            for (int j= 0; j < size ; j++)
+            {
+                eigen_vector[j] = evecs_eigen(j,i);
+            }
+            break;
+        }
+    }
+#else
+    std::vector<double> matrix(size_t(size) * size);
+    for (int i = 0; i < size; i++)
+    {
+        for (int j = 0; j < size; j++)
+        {
+            matrix[size_t(i) * size + j] = (*this)(i, j);
+        }
+    }
+    std::vector<double> eigenvalues, eigenvectors;
+    jacobi_eigen(matrix, size, eigenvalues, eigenvectors);
+    int top = std::max_element(eigenvalues.begin(), eigenvalues.end()) - eigenvalues.begin();
+    for (int j = 0; j < size; j++)
+    {
+        eigen_vector[j] = eigenvectors[size_t(j) * size + top];
+    }
+#endif
+    return eigen_vector;
+}
+
+//==========================================================OPERATORS================================================================
+/*
+ * Returns entry (i, j) of D^-1/2 * L * D^-1/2. The smaller index is always scaled first,
+ * so (i, j) and (j, i) give the same value.
+ * @pram: int i
+ * @pram: int j
+ */
+template <typename T>
+inline T NormalizedOperator<T>::operator()(int i, int j)
+{
+    if (i > j)
+    {
+        std::swap(i, j);
+    }
+    return this->_d_neg0pt5[i] * this->_matrix->_edges[this->_column_starts[j] + this->_members[i]] * this->_d_neg0pt5[j];
+}
+
+#endif
@@ -236,6 +236,7 @@ template <typename T>
 inline SparseElement<T>& SparseElement<T>::operator=(const SparseElement<T>& rhs)
 {
     _copy (rhs);
+    return *this;
 }
 
 /*
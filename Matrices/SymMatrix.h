@@ -1,6 +1,10 @@
 /************************************************************************************
  * SymMatrix Matrix Data Structure. This structure uses an array to store the values* 
  * of a lower triangular matrix.                                                     *
+ * Entry (i, j) with i <= j is stored at i + j*(j+1)/2, which is the column major    *
+ * packed upper triangle (the row major packed lower triangle), so a n*n symmetric  *
+ * matrix only takes n*(n+1)/2 values. The operations below work directly on the    *
+ * packed array.                                                                     *
  ************************************************************************************/
 
 #ifndef _SymMatrix_h
@@ -28,11 +32,13 @@
 #include "ardsmat.h"
 #include "ardssym.h"
 #include "lsymsol.h"
+#include "arssym.h"
 #endif
 
 #ifdef USE_MPI
 #include "mpi.h"
 #include "MPI_Structs.h"
+#include "CompactForm.h"
 #endif
 
 template <typename T>
@@ -41,6 +47,12 @@ class SymMatrix;
 template <typename T>
 std::ostream& operator<< (std::ostream&, const SymMatrix<T>&);
 
+template <typename T>
+class NormalizedOperator;
+
+template <typename T>
+class SharedGraphs;
+
 /*
  * SymMatrix class definition and method declarations.
  */
@@ -52,8 +64,12 @@ private:
      * Private methods (used internally)
      */
     size_t _getArrSize() const;
+    size_t _getIndex(int, int) const;
     void _initializeMatrix(bool);
     void _copy(const SymMatrix<T>&);
+    #ifdef USE_MPI
+    int _chooseSendForm(int, std::vector<unsigned char>&);
+    #endif
 
     /*
      * Private constants.
@@ -64,6 +80,7 @@ private:
 protected:
     int _size;
     T* _edges;
+    bool _owns_edges;
 
 public:
       
@@ -73,7 +90,9 @@ public:
     SymMatrix(bool fill = true);
     SymMatrix(int size, bool fill = true);
     SymMatrix(const SymMatrix<T>&);
+    explicit SymMatrix(DenseMatrix1D<T>&);
     SymMatrix(const std::string&);
+    SymMatrix(T*, int);
 
     #ifdef USE_MPI
     SymMatrix(int,MPI_Status&);
@@ -88,10 +107,13 @@ public:
     /***********
      *ACCESSORS*
      ***********/
+    bool isSquare();
+    bool isSymmetric();
     int getNumberOfRows();
     int getNumberOfColumns();
     std::vector<SparseElement<T> >getSparseForm();
     DenseMatrix1D<T> getScatteredSelection(const std::vector<int>& vec_A, const std::vector<int>& vec_B);
+    SymMatrix<T> getSymmetricSelection(const std::vector<int>& vec);
     
     /**********
      *MUTATORS*
@@ -108,13 +130,15 @@ public:
     SymMatrix<T> kron(const SymMatrix<T>& matrix);
     DenseMatrix1D<T> diagonalVectorTimesMatrix(const std::vector<T>&);
     DenseMatrix1D<T> matrixTimesDiagonalVector(const std::vector<T>&);
+    SymMatrix<T> diagonalScaling(const std::vector<T>&);
+    void multMv(T* vec, T* result);
 
     /*************
     *  MPI Send  *
     **************/
     #ifdef USE_MPI
-    void MPI_Send_Matrix(int, int, bool sparse = false);
-    void MPI_Bcast_Send_Matrix(int, bool sparse = false);
+    void MPI_Send_Matrix(int, int, int send_form = _AUTO_FORM);
+    void MPI_Bcast_Send_Matrix(int, int send_form = _AUTO_FORM);
     #endif
 
     /**********
@@ -127,6 +151,8 @@ public:
     DenseMatrix1D<T> operator-(const DenseMatrix1D<T>& other_matrix);
     DenseMatrix1D<T> operator*(const DenseMatrix1D<T>& other_matrix);
     friend std::ostream& operator<< <> (std::ostream& stream, const SymMatrix<T>& matrix);
+    friend class NormalizedOperator<T>;
+    friend class SharedGraphs<T>;
 };
 
 //==========================================================CONSTANTS============================================================
@@ -238,30 +264,13 @@ inline SymMatrix<T>::SymMatrix(int source, int tag, MPI_Status& stat)
         }
         delete recv_edges;
     }
-    else if (mat_info.send_form == _SYM_SPARSE_FORM)
-    {
-		this->_size = mat_info.rows;
-		this->_size = mat_info.cols;
-		_initializeMatrix(true);
-		std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-		MPI_Recv(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
-
-		for(int i = 0;  i < mat_info.recv_size; i++)
-		{
-			(*this)(recv_edges[i].getJ(),recv_edges[i].getI()) = (*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-		}
-    }
-    else if (mat_info.send_form == _SPARSE_FORM)
+    else if (mat_info.send_form == _COMPACT_FORM)
     {
-		this->_size = mat_info.rows;
-		this->_size = mat_info.cols;
-		_initializeMatrix(true);
-		std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-		MPI_Recv(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
-		for(int i = 0;  i < mat_info.recv_size; i++)
-		{
-			(*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-		}
+        this->_size = mat_info.rows;
+        _initializeMatrix(true);
+        std::vector<unsigned char> compact_form(mat_info.recv_size);
+        MPI_Recv(&compact_form[0], mat_info.recv_size, MPI_BYTE, source, tag + 2, MPI_COMM_WORLD, &stat);
+        compact_decode<T>(compact_form, *this);
     }
 }
 
@@ -299,31 +308,16 @@ inline SymMatrix<T>::SymMatrix(int source, MPI_Status& stat)
         }
         delete recv_edges;
     }
-    else if (mat_info.send_form == _SYM_SPARSE_FORM)
+    else if (mat_info.send_form == _COMPACT_FORM)
     {
-    	this->_size = mat_info.rows;
-		this->_size = mat_info.cols;
-		_initializeMatrix(true);
-		std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-		MPI_Bcast(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
-		for(int i = 0;  i < mat_info.recv_size; i++)
-		{
-			(*this)(recv_edges[i].getJ(),recv_edges[i].getI()) = (*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-		}
-    }
-    else if (mat_info.send_form == _SPARSE_FORM)
-    {
-    	this->_size = mat_info.rows;
-		this->_size = mat_info.cols;
-		_initializeMatrix(true);
-		std::vector<SparseElement<T> > recv_edges(mat_info.recv_size);
-		MPI_Bcast(&recv_edges[0], mat_info.recv_size*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
-		for(int i = 0;  i < mat_info.recv_size; i++)
-		{
-			(*this)(recv_edges[i].getI(), recv_edges[i].getJ()) = recv_edges[i].getValue();
-		}
+        this->_size = mat_info.rows;
+        _initializeMatrix(true);
+        std::vector<unsigned char> compact_form(mat_info.recv_size);
+        MPI_Bcast(&compact_form[0], mat_info.recv_size, MPI_BYTE, source, MPI_COMM_WORLD);
+        compact_decode<T>(compact_form, *this);
     }
 }
+
 #endif
 
 /*
@@ -337,6 +331,45 @@ inline SymMatrix<T>::SymMatrix(const SymMatrix<T>& matrix)
     _copy(matrix);
 }
 
+/*
+ * SymMatrix constructor:
+ * Construct a packed copy of a DenseMatrix1D. Only the upper triangle is read, so the matrix is assumed to be symmetric.
+ * @pram DenseMatrix1D<T>
+ */
+template <typename T>
+inline SymMatrix<T>::SymMatrix(DenseMatrix1D<T>& matrix)
+{
+    if (!matrix.isSquare())
+    {
+        throw NotASquareMatrixException();
+    }
+    this->_size = matrix.getNumberOfRows();
+    _initializeMatrix(false);
+    size_t counter = 0;
+    for (int j = 0; j < this->_size; j++)
+    {
+        for (int i = 0; i <= j; i++)
+        {
+            this->_edges[counter++] = matrix(i, j);
+        }
+    }
+}
+
+/*
+ * SymMatrix constructor:
+ * Construct a matrix on top of a packed array that is owned by someone else (e.g. a MPI shared memory window).
+ * Nothing is copied and the array is not deleted with the matrix, so it has to outlive the matrix.
+ * @pram T*: packed array of size*(size+1)/2 values
+ * @pram int size: number of rows and columns
+ */
+template <typename T>
+inline SymMatrix<T>::SymMatrix(T* edges, int size)
+{
+    this->_size = size;
+    this->_edges = edges;
+    this->_owns_edges = false;
+}
+
 //==========================================================DESTRUCTOR==============================================================
 /*
  * SymMatrix destructor:
@@ -345,10 +378,31 @@ inline SymMatrix<T>::SymMatrix(const SymMatrix<T>& matrix)
 template <typename T>
 inline SymMatrix<T>::~SymMatrix()
 {
-    delete [] _edges;
+    if (this->_owns_edges)
+    {
+        delete [] _edges;
+    }
 }
 
 //===========================================================ACCESSORS===============================================================
+/*
+ * Returns true, a SymMatrix is always square.
+ */
+template <typename T>
+inline bool SymMatrix<T>::isSquare()
+{
+    return true;
+}
+
+/*
+ * Returns true, only one triangle is stored so a SymMatrix is always symmetric.
+ */
+template <typename T>
+inline bool SymMatrix<T>::isSymmetric()
+{
+    return true;
+}
+
 /*
  * Returns the number of the rows.
  */
@@ -395,6 +449,62 @@ inline std::vector<SparseElement<T> > SymMatrix<T>::getSparseForm()
 template <typename T>
 inline DenseMatrix1D<T> SymMatrix<T>::getScatteredSelection(const std::vector<int>& vec_A, const std::vector<int>& vec_B)
 {
+    std::vector<int> rows;
+    std::vector<int> cols;
+    for (int i = 0; i < vec_A.size(); i++)
+    {
+        if (vec_A[i] == 1)
+        {
+            rows.push_back(i);
+        }
+    }
+    for (int j = 0; j < vec_B.size(); j++)
+    {
+        if (vec_B[j] == 1)
+        {
+            cols.push_back(j);
+        }
+    }
+    
+    DenseMatrix1D<T> res_matrix(rows.size(), cols.size(), false);
+    for (int i = 0; i < rows.size(); i++)
+    {
+        for (int j = 0; j < cols.size(); j++)
+        {
+            res_matrix(i, j) = this->_edges[_getIndex(rows[i], cols[j])];
+        }
+    }
+    return res_matrix;
+}
+
+/*
+ * Returns a SymMatrix that has the rows and the columns that are marked 1 in vec.
+ * Selecting the same rows and columns keeps the matrix symmetric, so only the packed triangle is copied.
+ * @pram std::vector<int>: vector of 0's and 1's for row and column selection
+ */
+template <typename T>
+inline SymMatrix<T> SymMatrix<T>::getSymmetricSelection(const std::vector<int>& vec)
+{
+    std::vector<int> selected;
+    for (int i = 0; i < vec.size(); i++)
+    {
+        if (vec[i] == 1)
+        {
+            selected.push_back(i);
+        }
+    }
+    
+    SymMatrix<T> res_matrix(selected.size(), false);
+    size_t counter = 0;
+    for (int j = 0; j < selected.size(); j++)
+    {
+        size_t column_start = size_t(selected[j]) * (selected[j] + 1) / 2;
+        for (int i = 0; i <= j; i++)
+        {
+            res_matrix._edges[counter++] = this->_edges[column_start + selected[i]];
+        }
+    }
+    return res_matrix;
 }
 //===========================================================MUTATORS==================================================================
 
@@ -405,7 +515,20 @@ inline DenseMatrix1D<T> SymMatrix<T>::getScatteredSelection(const std::vector<in
 template <typename T>
 inline T SymMatrix<T>::getFrobNorm()
 {
-
+    //the entries above the diagonal are counted twice
+    T ret_val = 0;
+    size_t counter = 0;
+    for (int j = 0; j < this->_size; j++)
+    {
+        for (int i = 0; i < j; i++)
+        {
+            ret_val += 2 * this->_edges[counter] * this->_edges[counter];
+            counter++;
+        }
+        ret_val += this->_edges[counter] * this->_edges[counter];
+        counter++;
+    }
+    return ret_val;
 }
 
 /*
@@ -414,9 +537,10 @@ inline T SymMatrix<T>::getFrobNorm()
 template <typename T>
 inline T* SymMatrix<T>::getTopEigenVector()
 {
+    PERF_SCOPE(PERF_SITE_TOP_EIGENVECTOR);
 #ifdef ARPACK
-    ARdsSymMatrix<T> ARMatrix(this->_size, this->_edges, 'L');
-    ARluSymStdEig<T> eigProb(1, ARMatrix, "LM", 10);
+    //ARPACK only needs the product of the matrix and a vector, which is done on the packed array by multMv
+    ARSymStdEig<T, SymMatrix<T> > eigProb(this->_size, 1, this, &SymMatrix<T>::multMv, "LM", 10);
     eigProb.FindEigenvectors();
     T* eigen_vector = new T[this->_size];
      
@@ -426,10 +550,36 @@ inline T* SymMatrix<T>::getTopEigenVector()
     }
     
     return eigen_vector;
-#endif
-
-#ifdef EIGEN
+#elif defined(EIGEN)
+    //the solver only reads the lower triangle
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> A_eigen(this->_size, this->_size);
+    size_t counter = 0;
+    for (int j = 0; j < this->_size; j++)
+    {
+        for (int i = 0; i <= j; i++)
+        {
+            A_eigen(j,i) = this->_edges[counter++];
+        }
+    }
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> es;
+    es.compute(A_eigen);
+    
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> evals_eigen = es.eigenvalues();
+    Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::ColMajor> evecs_eigen = es.eigenvectors();
+    T* eigen_vector = new T[this->_size];
 
+    for ( int i=0; i < this->_size; i++)
+    {   
+        if (evals_eigen(i) == evals_eigen.maxCoeff())
+        {
+            for (int j= 0; j < this->_size ; j++)
+            {
+                eigen_vector[j] = evecs_eigen(j,i);
+            }
+            break;
+        }
+    }
+    return eigen_vector;
 #endif
 }
 
@@ -439,6 +589,7 @@ inline T* SymMatrix<T>::getTopEigenVector()
 template <typename T>
 inline SymMatrix<T> SymMatrix<T>::transpose()
 {
+    return SymMatrix<T>(*this);
 }
 
 /*
@@ -447,6 +598,20 @@ inline SymMatrix<T> SymMatrix<T>::transpose()
 template <typename T>
 inline std::vector<T> SymMatrix<T>::getSumOfRows()
 {
+    //an entry above the diagonal belongs to row i and, mirrored, to row j
+    std::vector<T> sum_vector(this->_size);
+    size_t counter = 0;
+    for (int j = 0; j < this->_size; j++)
+    {
+        for (int i = 0; i < j; i++)
+        {
+            sum_vector[i] += this->_edges[counter];
+            sum_vector[j] += this->_edges[counter];
+            counter++;
+        }
+        sum_vector[j] += this->_edges[counter++];
+    }
+    return sum_vector;
 }
 
 /*
@@ -456,6 +621,15 @@ inline std::vector<T> SymMatrix<T>::getSumOfRows()
 template <typename T>
 inline std::vector<int> SymMatrix<T>::getNeighbors(int vertex)
 {
+    std::vector<int> neighbors;
+    for (int i = 0; i < this->_size; i++)
+    {
+        if (this->_edges[_getIndex(i, vertex)] == 1)
+        {
+            neighbors.push_back(i);
+        }
+    }
+    return neighbors;
 }
 
 /*
@@ -465,6 +639,40 @@ inline std::vector<int> SymMatrix<T>::getNeighbors(int vertex)
 template <typename T> 
 inline SymMatrix<T> SymMatrix<T>::kron(const SymMatrix<T>& matrix)
 {
+    PERF_SCOPE(PERF_SITE_KRON);
+    //the kronecker product of two symmetric matrices is symmetric
+    int prod_size = this->_size * matrix._size;
+    SymMatrix<T> prod_matrix(prod_size, false);
+    std::vector<T> inner_column(matrix._size);
+    
+    /*
+     *  Calculating the packed columns of the kronecker product:
+     *  The indices of the product matrix is calculated by:
+     *      i = (i_outer*size) + i_inner
+     *      j = (j_outer*size) + j_inner
+     *  and only the entries with i <= j are stored.
+     */
+    size_t counter = 0;
+    for (int j_outer = 0; j_outer < this->_size; j_outer++)
+    {
+        for (int j_inner = 0; j_inner < matrix._size; j_inner++)
+        {
+            for (int i_inner = 0; i_inner < matrix._size; i_inner++)
+            {
+                inner_column[i_inner] = matrix._edges[matrix._getIndex(i_inner, j_inner)];
+            }
+            for (int i_outer = 0; i_outer <= j_outer; i_outer++)
+            {
+                T outer_value = this->_edges[this->_getIndex(i_outer, j_outer)];
+                int inner_rows = (i_outer == j_outer) ? j_inner + 1 : matrix._size;
+                for (int i_inner = 0; i_inner < inner_rows; i_inner++)
+                {
+                    prod_matrix._edges[counter++] = inner_column[i_inner] * outer_value;
+                }
+            }
+        }
+    }
+    return prod_matrix;
 }
 
 /*
@@ -474,6 +682,20 @@ inline SymMatrix<T> SymMatrix<T>::kron(const SymMatrix<T>& matrix)
 template <typename T>
 inline DenseMatrix1D<T> SymMatrix<T>::diagonalVectorTimesMatrix(const std::vector<T>& vec)
 {
+    if(this->_size != vec.size())
+    {
+        throw DimensionMismatchException();
+    }
+    
+    DenseMatrix1D<T> ret_matrix(this->_size, this->_size, false);
+    for (int i = 0; i < this->_size; i++)
+    {
+        for (int j = 0; j < this->_size; j++)
+        {
+            ret_matrix(i, j) = vec[i] * this->_edges[_getIndex(i, j)];
+        }
+    }
+    return ret_matrix;
 }
 
 /*
@@ -483,37 +705,115 @@ inline DenseMatrix1D<T> SymMatrix<T>::diagonalVectorTimesMatrix(const std::vecto
 template <typename T>
 inline DenseMatrix1D<T> SymMatrix<T>::matrixTimesDiagonalVector(const std::vector<T>& vec)
 {
+    if(this->_size != vec.size())
+    {
+        throw DimensionMismatchException();
+    }
+    
+    DenseMatrix1D<T> ret_matrix(this->_size, this->_size, false);
+    for (int i = 0; i < this->_size; i++)
+    {
+        for (int j = 0; j < this->_size; j++)
+        {
+            ret_matrix(i, j) = this->_edges[_getIndex(i, j)] * vec[j];
+        }
+    }
+    return ret_matrix;
+}
+
+/*
+ * Returns a SymMatrix<T> of D*this*D where D is the diagonal matrix that has the values of vec on its diagonal.
+ * Unlike diagonalVectorTimesMatrix followed by matrixTimesDiagonalVector the result stays symmetric and packed.
+ * @pram std::vector<T> diagonal entires of a diagonal matrix
+ */
+template <typename T>
+inline SymMatrix<T> SymMatrix<T>::diagonalScaling(const std::vector<T>& vec)
+{
+    if(this->_size != vec.size())
+    {
+        throw DimensionMismatchException();
+    }
+    
+    SymMatrix<T> ret_matrix(this->_size, false);
+    size_t counter = 0;
+    for (int j = 0; j < this->_size; j++)
+    {
+        for (int i = 0; i <= j; i++)
+        {
+            ret_matrix._edges[counter] = vec[i] * this->_edges[counter] * vec[j];
+            counter++;
+        }
+    }
+    return ret_matrix;
+}
+
+/*
+ * Symmetric packed matrix vector product (SPMV): result = this * vec.
+ * Every stored entry is read once and used for both of its mirrored positions.
+ * The signature is the one ARPACK++ expects for the product of the operator and a vector.
+ * @pram T* vector of size n
+ * @pram T* array of size n that is set to the product
+ */
+template <typename T>
+inline void SymMatrix<T>::multMv(T* vec, T* result)
+{
+    std::fill(result, result + this->_size, T(0));
+    size_t counter = 0;
+    for (int j = 0; j < this->_size; j++)
+    {
+        T column_sum = 0;
+        T vec_j = vec[j];
+        for (int i = 0; i < j; i++)
+        {
+            T value = this->_edges[counter++];
+            result[i] += value * vec_j;
+            column_sum += value * vec[i];
+        }
+        result[j] += column_sum + this->_edges[counter++] * vec_j;
+    }
 }
 
 
 //===========================================================MPI SEND/REC================================================================
 #ifdef USE_MPI
+/*
+ * returns the form the matrix is sent in and fills compact_form when it is _COMPACT_FORM.
+ * _AUTO_FORM sends the compact form unless it is not smaller than the dense one.
+ * @pram int send form requested by the caller
+ * @pram std::vector<unsigned char> set to the compact form of the matrix
+ */
+template <typename T>
+int SymMatrix<T>::_chooseSendForm(int send_form, std::vector<unsigned char>& compact_form)
+{
+    if (send_form == _DENSE_FORM || send_form == _SYM_DENSE_FORM)
+    {
+        return send_form;
+    }
+    compact_form = compact_encode<T>(*this, this->_size, this->_size, true);
+    if (send_form == _AUTO_FORM && compact_form.size() >= this->_getArrSize() * sizeof(T))
+    {
+        compact_form.clear();
+        return _DENSE_FORM;
+    }
+    return _COMPACT_FORM;
+}
+
 /*
  * Sends a SymMatrix<T> using MPI_Send.
  * @pram int destination processor
  * @pram int tag 
- * @pram bool sending sparse form, default value is false.
- */
-template <typename T>
-void SymMatrix<T>::MPI_Send_Matrix(int dest, int tag, bool sparse)
-{
-    if(sparse)
-    {
-		std::vector<SparseElement<T> > sparse_form;
-		for (int i = 0; i < this->_size; i++)
-		{
-			for (int j = i ; j < this->_size; j++)
-			{   
-				if ((*this)(i,j) != 0)
-				{
-					sparse_form.push_back(SparseElement<T>(i,j,(*this)(i,j)));
-				}
-			}
-		}
-		MPI_MatrixInfo mat_info;
-        mat_info.setValues(this->_size, this->_size, sparse_form.size(), _SYM_SPARSE_FORM);
+ * @pram int send form: dense, _COMPACT_FORM or _AUTO_FORM (default) to send the smaller one.
+ */
+template <typename T>
+void SymMatrix<T>::MPI_Send_Matrix(int dest, int tag, int send_form)
+{
+    std::vector<unsigned char> compact_form;
+    if (_chooseSendForm(send_form, compact_form) == _COMPACT_FORM)
+    {
+        MPI_MatrixInfo mat_info;
+        mat_info.setValues(this->_size, this->_size, compact_form.size(), _COMPACT_FORM);
         MPI_Send(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, dest, tag + 1, MPI_COMM_WORLD);
-		MPI_Send(&sparse_form[0], sparse_form.size()*sizeof(SparseElement<T>), MPI_BYTE, dest, tag + 2, MPI_COMM_WORLD);
+        MPI_Send(&compact_form[0], compact_form.size(), MPI_BYTE, dest, tag + 2, MPI_COMM_WORLD);
     }
     else
     {
@@ -527,28 +827,18 @@ void SymMatrix<T>::MPI_Send_Matrix(int dest, int tag, bool sparse)
 /*
  * Sends a SymMatrix<T> using MPI_Bcast.
  * @pram int source sender's ID
- * @pram bool sending sparse form, default value is false.
+ * @pram int send form: dense, _COMPACT_FORM or _AUTO_FORM (default) to send the smaller one.
  */
 template <typename T>
-void SymMatrix<T>::MPI_Bcast_Send_Matrix(int source, bool sparse)
+void SymMatrix<T>::MPI_Bcast_Send_Matrix(int source, int send_form)
 {
-    if(sparse)
+    std::vector<unsigned char> compact_form;
+    if (_chooseSendForm(send_form, compact_form) == _COMPACT_FORM)
     {
-		std::vector<SparseElement<T> > sparse_form;
-		for (int i = 0; i < this->_size; i++)
-		{
-			for (int j = i ; j < this->_size; j++)
-			{   
-				if ((*this)(i,j) != 0)
-				{
-					sparse_form.push_back(SparseElement<T>(i,j,(*this)(i,j)));
-				}
-			}
-		}
-		MPI_MatrixInfo mat_info;
-        mat_info.setValues(this->_size, this->_size, sparse_form.size(), _SYM_SPARSE_FORM);
-		MPI_Bcast(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, source, MPI_COMM_WORLD);
-		MPI_Bcast(&sparse_form[0], sparse_form.size()*sizeof(SparseElement<T>), MPI_BYTE, source, MPI_COMM_WORLD);
+        MPI_MatrixInfo mat_info;
+        mat_info.setValues(this->_size, this->_size, compact_form.size(), _COMPACT_FORM);
+        MPI_Bcast(&mat_info, sizeof(MPI_MatrixInfo), MPI_BYTE, source, MPI_COMM_WORLD);
+        MPI_Bcast(&compact_form[0], compact_form.size(), MPI_BYTE, source, MPI_COMM_WORLD);
     }
     else
     {
@@ -571,14 +861,7 @@ void SymMatrix<T>::MPI_Bcast_Send_Matrix(int source, bool sparse)
 template <typename T>
 inline T& SymMatrix<T>::operator()(int i, int j)
 {
-    if(i<=j)
-    {
-        return this->_edges[i+size_t(j)*(j+1)/2];
-    }
-    else
-    {
-        return this->_edges[j+size_t(i)*(i+1)/2];
-    }
+    return this->_edges[_getIndex(i, j)];
 }
 
 /*
@@ -588,7 +871,10 @@ inline T& SymMatrix<T>::operator()(int i, int j)
 template <typename T>
 inline void SymMatrix<T>::operator=(const SymMatrix<T>& matrix)
 {
-    delete [] this->_edges;
+    if (this->_owns_edges)
+    {
+        delete [] this->_edges;
+    }
     _copy(matrix);
 }
 
@@ -621,6 +907,20 @@ inline void SymMatrix<T>::operator=(const SymMatrix<T>& matrix)
 template <typename T>
 inline DenseMatrix1D<T> SymMatrix<T>::operator+(const DenseMatrix1D<T>& other_matrix)
 {
+    DenseMatrix1D<T> ret_matrix(other_matrix);
+    if(ret_matrix.getNumberOfRows() != this->_size || ret_matrix.getNumberOfColumns() != this->_size)
+    {
+        throw DimensionMismatchException();
+    }
+    
+    for (int i = 0; i < this->_size; i++)
+    {
+        for (int j = 0; j < this->_size; j++)
+        {
+            ret_matrix(i, j) = this->_edges[_getIndex(i, j)] + ret_matrix(i, j);
+        }
+    }
+    return ret_matrix;
 }
 
 /*
@@ -630,6 +930,20 @@ inline DenseMatrix1D<T> SymMatrix<T>::operator+(const DenseMatrix1D<T>& other_ma
 template <typename T>
 inline DenseMatrix1D<T> SymMatrix<T>::operator-(const DenseMatrix1D<T>& other_matrix)
 {
+    DenseMatrix1D<T> ret_matrix(other_matrix);
+    if(ret_matrix.getNumberOfRows() != this->_size || ret_matrix.getNumberOfColumns() != this->_size)
+    {
+        throw DimensionMismatchException();
+    }
+    
+    for (int i = 0; i < this->_size; i++)
+    {
+        for (int j = 0; j < this->_size; j++)
+        {
+            ret_matrix(i, j) = this->_edges[_getIndex(i, j)] - ret_matrix(i, j);
+        }
+    }
+    return ret_matrix;
 }
 
 /*
@@ -639,6 +953,31 @@ inline DenseMatrix1D<T> SymMatrix<T>::operator-(const DenseMatrix1D<T>& other_ma
 template <typename T>
 inline DenseMatrix1D<T> SymMatrix<T>::operator*(const DenseMatrix1D<T>& other_matrix)
 {
+    PERF_SCOPE(PERF_SITE_MATRIX_MULTIPLY);
+    DenseMatrix1D<T> other(other_matrix);
+    if(other.getNumberOfRows() != this->_size)
+    {
+        throw DimensionMismatchException();
+    }
+    
+    //each column of the product is a symmetric packed matrix vector product
+    int cols = other.getNumberOfColumns();
+    DenseMatrix1D<T> ret_matrix(this->_size, cols, false);
+    std::vector<T> column(this->_size);
+    std::vector<T> product(this->_size);
+    for (int j = 0; j < cols; j++)
+    {
+        for (int k = 0; k < this->_size; k++)
+        {
+            column[k] = other(k, j);
+        }
+        multMv(&column[0], &product[0]);
+        for (int i = 0; i < this->_size; i++)
+        {
+            ret_matrix(i, j) = product[i];
+        }
+    }
+    return ret_matrix;
 }
 
 /*
@@ -704,6 +1043,7 @@ inline void SymMatrix<T>::_initializeMatrix(bool fill)
     {
         throw OutOfMemoryException();
     }
+    this->_owns_edges = true;
 }
 
 /*
@@ -713,7 +1053,26 @@ inline void SymMatrix<T>::_initializeMatrix(bool fill)
 template<typename T>
 inline size_t SymMatrix<T>::_getArrSize() const
 {
-    return (int)(0.5 * this->_size * (this->_size + 1));
+    return size_t(this->_size) * (this->_size + 1) / 2;
+}
+
+/*
+ * Return the index of entry (i, j) in the internal array
+ * @pram: int i
+ * @pram: int j
+ * @return: size_t
+ */
+template<typename T>
+inline size_t SymMatrix<T>::_getIndex(int i, int j) const
+{
+    if(i<=j)
+    {
+        return i+size_t(j)*(j+1)/2;
+    }
+    else
+    {
+        return j+size_t(i)*(i+1)/2;
+    }
 }
 
 //===================================================================================================================================
@@ -0,0 +1,294 @@
+/************************************************************************************
+ * This file contains the hardware performance counters used to measure the hot     *
+ * kernels of the program (kron, operator*, getTopEigenVector, return_max and       *
+ * find_all_values). On Linux, when compiled with -DPERF_COUNTERS, the cycles,      *
+ * instructions, last level cache misses and branch misses of every call are read   *
+ * with perf_event_open and added to the statistics of the call site. Without the   *
+ * flag PERF_SCOPE expands to nothing, so the kernels are not slowed down.          *
+ ************************************************************************************/
+
+#ifndef _PerfCounters_h
+#define _PerfCounters_h
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+
+#if defined(PERF_COUNTERS) && defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#define PERF_COUNTERS_ENABLED 1
+#endif
+
+/*
+ * Call sites that are measured
+ */
+static const int PERF_SITE_KRON = 0;
+static const int PERF_SITE_MATRIX_MULTIPLY = 1;
+static const int PERF_SITE_TOP_EIGENVECTOR = 2;
+static const int PERF_SITE_RETURN_MAX = 3;
+static const int PERF_SITE_FIND_ALL_VALUES = 4;
+static const int NUM_OF_PERF_SITES = 5;
+static const char* const PERF_SITE_NAMES[NUM_OF_PERF_SITES] = {"kron", "operator*", "getTopEigenVector", "return_max", "find_all_values"};
+
+/*
+ * Events that are counted
+ */
+static const int PERF_CYCLES = 0;
+static const int PERF_INSTRUCTIONS = 1;
+static const int PERF_LLC_MISSES = 2;
+static const int PERF_BRANCH_MISSES = 3;
+static const int NUM_OF_PERF_EVENTS = 4;
+static const char* const PERF_EVENT_NAMES[NUM_OF_PERF_EVENTS] = {"cycles", "instructions", "llc_misses", "branch_misses"};
+
+/*
+ * struct used to store the counters of a call site
+ */
+struct Perf_Site_Stats
+{
+    long long calls;
+    long long events[NUM_OF_PERF_EVENTS];
+};
+
+/*
+ * PerfCounters class: the group of hardware counters of a thread and the
+ * statistics of every call site measured on that thread.
+ */
+class PerfCounters
+{
+private:
+    int _group_fd;
+    int _fds[NUM_OF_PERF_EVENTS];
+    bool _available;
+    Perf_Site_Stats _sites[NUM_OF_PERF_SITES];
+
+    static std::mutex& _registryMutex()
+    {
+        static std::mutex registry_mutex;
+        return registry_mutex;
+    }
+
+    static std::vector<PerfCounters*>& _registry()
+    {
+        static std::vector<PerfCounters*> registry;
+        return registry;
+    }
+
+    PerfCounters()
+    {
+        _group_fd = -1;
+        _available = false;
+        std::memset(_sites, 0, sizeof(_sites));
+        std::fill(_fds, _fds + NUM_OF_PERF_EVENTS, -1);
+#ifdef PERF_COUNTERS_ENABLED
+        const unsigned long long configs[NUM_OF_PERF_EVENTS] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+                                                                PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+        _available = true;
+        for (int e = 0; e < NUM_OF_PERF_EVENTS; e++)
+        {
+            struct perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = configs[e];
+            attr.disabled = (e == 0);
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP;
+            _fds[e] = syscall(__NR_perf_event_open, &attr, 0, -1, _group_fd, 0);
+            if (_fds[e] < 0)
+            {
+                _available = false;
+                break;
+            }
+            if (e == 0)
+            {
+                _group_fd = _fds[0];
+            }
+        }
+        if (_available)
+        {
+            ioctl(_group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(_group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+#endif
+    }
+
+public:
+    ~PerfCounters()
+    {
+#ifdef PERF_COUNTERS_ENABLED
+        for (int e = 0; e < NUM_OF_PERF_EVENTS; e++)
+        {
+            if (_fds[e] >= 0)
+            {
+                close(_fds[e]);
+            }
+        }
+#endif
+    }
+
+    /*
+     * returns the counters of the calling thread. They stay registered after the
+     * thread has exited, so their statistics are still printed.
+     */
+    static PerfCounters& local()
+    {
+        static thread_local PerfCounters* counters = NULL;
+        if (counters == NULL)
+        {
+            std::lock_guard<std::mutex> lock(_registryMutex());
+            counters = new PerfCounters();
+            _registry().push_back(counters);
+        }
+        return *counters;
+    }
+
+    bool isAvailable()
+    {
+        return _available;
+    }
+
+    /*
+     * reads the current value of every event
+     * @pram: array of NUM_OF_PERF_EVENTS values
+     */
+    void read(long long* values)
+    {
+        std::fill(values, values + NUM_OF_PERF_EVENTS, 0);
+#ifdef PERF_COUNTERS_ENABLED
+        if (!_available)
+        {
+            return;
+        }
+        unsigned long long buffer[1 + NUM_OF_PERF_EVENTS];
+        if (::read(_group_fd, buffer, sizeof(buffer)) == (ssize_t)sizeof(buffer))
+        {
+            for (int e = 0; e < NUM_OF_PERF_EVENTS; e++)
+            {
+                values[e] = buffer[1 + e];
+            }
+        }
+#endif
+    }
+
+    /*
+     * adds the events of one call to the statistics of a call site
+     * @pram: call site
+     * @pram: values read before the call
+     * @pram: values read after the call
+     */
+    void add(int site, const long long* before, const long long* after)
+    {
+        _sites[site].calls++;
+        for (int e = 0; e < NUM_OF_PERF_EVENTS; e++)
+        {
+            _sites[site].events[e] += after[e] - before[e];
+        }
+    }
+
+    /*
+     * returns the statistics of every call site summed over all threads
+     * @pram: set to false if the counters could not be opened on any thread
+     */
+    static std::vector<Perf_Site_Stats> collect(bool* available)
+    {
+        std::lock_guard<std::mutex> lock(_registryMutex());
+        std::vector<Perf_Site_Stats> total(NUM_OF_PERF_SITES);
+        std::memset(&total[0], 0, NUM_OF_PERF_SITES * sizeof(Perf_Site_Stats));
+        *available = false;
+        for (int t = 0; t < _registry().size(); t++)
+        {
+            *available = *available || _registry()[t]->_available;
+            for (int s = 0; s < NUM_OF_PERF_SITES; s++)
+            {
+                total[s].calls += _registry()[t]->_sites[s].calls;
+                for (int e = 0; e < NUM_OF_PERF_EVENTS; e++)
+                {
+                    total[s].events[e] += _registry()[t]->_sites[s].events[e];
+                }
+            }
+        }
+        return total;
+    }
+};
+
+/*
+ * ScopedPerfCounters class: adds the events between its construction and its
+ * destruction to a call site of the calling thread.
+ */
+class ScopedPerfCounters
+{
+private:
+    int _site;
+    long long _start[NUM_OF_PERF_EVENTS];
+
+public:
+    explicit ScopedPerfCounters(int site)
+    {
+        _site = site;
+        PerfCounters::local().read(_start);
+    }
+
+    ~ScopedPerfCounters()
+    {
+        long long end[NUM_OF_PERF_EVENTS];
+        PerfCounters& counters = PerfCounters::local();
+        counters.read(end);
+        counters.add(_site, _start, end);
+    }
+};
+
+#ifdef PERF_COUNTERS_ENABLED
+#define PERF_SCOPE(site) ScopedPerfCounters perf_scope_counters(site)
+#else
+#define PERF_SCOPE(site)
+#endif
+
+/*
+ * prints the counters of every call site that was measured. Prints nothing when
+ * the program was compiled without -DPERF_COUNTERS.
+ * @pram: output stream
+ * @pram: label printed in front of every line, e.g. the processor ID
+ */
+inline void print_perf_counters(std::ostream& out, const std::string& label)
+{
+#ifdef PERF_COUNTERS_ENABLED
+    bool available;
+    std::vector<Perf_Site_Stats> sites = PerfCounters::collect(&available);
+    if (!available)
+    {
+        out << label << "Hardware counters are not available (perf_event_open failed)." << std::endl;
+        return;
+    }
+    out << label << "Hardware counters per call site:" << std::endl;
+    for (int s = 0; s < NUM_OF_PERF_SITES; s++)
+    {
+        if (sites[s].calls == 0)
+        {
+            continue;
+        }
+        out << label << "  " << std::left << std::setw(18) << PERF_SITE_NAMES[s] << std::right << " calls: " << sites[s].calls;
+        for (int e = 0; e < NUM_OF_PERF_EVENTS; e++)
+        {
+            out << ", " << PERF_EVENT_NAMES[e] << ": " << sites[s].events[e];
+        }
+        if (sites[s].events[PERF_CYCLES] > 0)
+        {
+            out << ", ipc: " << (double)sites[s].events[PERF_INSTRUCTIONS] / sites[s].events[PERF_CYCLES];
+        }
+        out << std::endl;
+    }
+#else
+    (void)out;
+    (void)label;
+#endif
+}
+
+#endif
@@ -0,0 +1,402 @@
+/************************************************************************************
+ * This file contains the wall clock profiler used to see where the time of the     *
+ * IsoRank algorithm goes. Scoped timers measure the phases of every isoRank() call *
+ * with steady_clock and counters count events such as the number of components.    *
+ * Every thread accumulates into its own statistics, so the timers do not need a    *
+ * lock. At the end of the run the statistics of all threads are merged, gathered   *
+ * from every rank and written as JSON. Durations are kept in log2 histograms of    *
+ * nanoseconds. Profiling is off unless a profile file is set (-profile).           *
+ ************************************************************************************/
+
+#ifndef _Profiler_h
+#define _Profiler_h
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include "Matrices/MatrixExceptions.h"
+
+typedef std::chrono::steady_clock WallClock;
+
+/*
+ * Phases that are timed
+ */
+static const int PHASE_ISORANK = 0;
+static const int PHASE_KRON = 1;
+static const int PHASE_SCC = 2;
+static const int PHASE_NORMALIZE = 3;
+static const int PHASE_EIGEN_SOLVE = 4;
+static const int PHASE_RESHAPE = 5;
+static const int PHASE_MATCHING = 6;
+static const int PHASE_FROBENIUS = 7;
+static const int PHASE_LOCAL_SEARCH = 8;
+static const int NUM_OF_PHASES = 9;
+static const char* const PHASE_NAMES[NUM_OF_PHASES] = {"isorank", "kron", "scc", "normalize", "eigen_solve",
+                                                       "reshape", "matching", "frobenius", "local_search"};
+
+/*
+ * Events that are counted
+ */
+static const int COUNTER_ISORANK_CALLS = 0;
+static const int COUNTER_KRON_NODES = 1;
+static const int COUNTER_COMPONENTS = 2;
+static const int COUNTER_MATCHING_TRIALS = 3;
+//one counter per reason the restarts stop (RestartPolicy.h), COUNTER_RESTART_STOPS + STOP_ constant
+static const int COUNTER_RESTART_STOPS = 4;
+static const int COUNTER_LOCAL_SEARCH_EVALUATIONS = 9;
+static const int COUNTER_LOCAL_SEARCH_MOVES = 10;
+//one counter per eigen solver backend (EigenSolvers.h), COUNTER_EIGEN_BACKENDS + EIGEN_BACKEND_ constant
+static const int COUNTER_EIGEN_BACKENDS = 11;
+static const int NUM_OF_COUNTERS = 14;
+static const char* const COUNTER_NAMES[NUM_OF_COUNTERS] = {"isorank_calls", "kron_nodes", "components", "matching_trials",
+                                                           "stop_trial_budget", "stop_perfect_match", "stop_no_ties",
+                                                           "stop_no_improvement", "stop_time_budget",
+                                                           "local_search_evaluations", "local_search_moves",
+                                                           "eigen_arpack", "eigen_dense", "eigen_lanczos"};
+
+/*
+ * bucket b of a histogram counts the durations in [2^b, 2^(b+1)) nanoseconds
+ */
+static const int NUM_OF_BUCKETS = 48;
+
+/*
+ * struct used to store the statistics of a phase
+ */
+struct Phase_Stats
+{
+    long long calls;
+    long long total_ns;
+    long long min_ns;
+    long long max_ns;
+    long long histogram[NUM_OF_BUCKETS];
+
+    void clear()
+    {
+        calls = total_ns = max_ns = 0;
+        min_ns = -1;
+        std::fill(histogram, histogram + NUM_OF_BUCKETS, 0);
+    }
+
+    /*
+     * adds a duration to the statistics
+     * @pram: duration in nanoseconds
+     */
+    void add(long long ns)
+    {
+        int bucket = 0;
+        while (bucket < NUM_OF_BUCKETS - 1 && (ns >> (bucket + 1)) > 0)
+        {
+            bucket++;
+        }
+        histogram[bucket]++;
+        calls++;
+        total_ns += ns;
+        max_ns = std::max(max_ns, ns);
+        min_ns = (min_ns < 0) ? ns : std::min(min_ns, ns);
+    }
+
+    /*
+     * adds the statistics of another thread or rank
+     * @pram: statistics of the same phase
+     */
+    void merge(const Phase_Stats& other)
+    {
+        if (other.calls == 0)
+        {
+            return;
+        }
+        for (int b = 0; b < NUM_OF_BUCKETS; b++)
+        {
+            histogram[b] += other.histogram[b];
+        }
+        min_ns = (min_ns < 0) ? other.min_ns : std::min(min_ns, other.min_ns);
+        max_ns = std::max(max_ns, other.max_ns);
+        calls += other.calls;
+        total_ns += other.total_ns;
+    }
+};
+
+/*
+ * struct used to store the statistics of a thread, a rank or the whole run
+ */
+struct Profile_Stats
+{
+    Phase_Stats phases[NUM_OF_PHASES];
+    long long counters[NUM_OF_COUNTERS];
+
+    Profile_Stats()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (int p = 0; p < NUM_OF_PHASES; p++)
+        {
+            phases[p].clear();
+        }
+        std::fill(counters, counters + NUM_OF_COUNTERS, 0);
+    }
+
+    void merge(const Profile_Stats& other)
+    {
+        for (int p = 0; p < NUM_OF_PHASES; p++)
+        {
+            phases[p].merge(other.phases[p]);
+        }
+        for (int c = 0; c < NUM_OF_COUNTERS; c++)
+        {
+            counters[c] += other.counters[c];
+        }
+    }
+
+    /*
+     * number of long longs used by flatten
+     */
+    static int flatSize()
+    {
+        return NUM_OF_PHASES * (4 + NUM_OF_BUCKETS) + NUM_OF_COUNTERS;
+    }
+
+    /*
+     * writes the statistics to an array of long longs, used to send them between ranks
+     * @pram: array of flatSize() long longs
+     */
+    void flatten(long long* out) const
+    {
+        for (int p = 0; p < NUM_OF_PHASES; p++)
+        {
+            *out++ = phases[p].calls;
+            *out++ = phases[p].total_ns;
+            *out++ = phases[p].min_ns;
+            *out++ = phases[p].max_ns;
+            out = std::copy(phases[p].histogram, phases[p].histogram + NUM_OF_BUCKETS, out);
+        }
+        std::copy(counters, counters + NUM_OF_COUNTERS, out);
+    }
+
+    /*
+     * reads statistics written by flatten
+     * @pram: array of flatSize() long longs
+     */
+    void unflatten(const long long* in)
+    {
+        for (int p = 0; p < NUM_OF_PHASES; p++)
+        {
+            phases[p].calls = *in++;
+            phases[p].total_ns = *in++;
+            phases[p].min_ns = *in++;
+            phases[p].max_ns = *in++;
+            std::copy(in, in + NUM_OF_BUCKETS, phases[p].histogram);
+            in += NUM_OF_BUCKETS;
+        }
+        std::copy(in, in + NUM_OF_COUNTERS, counters);
+    }
+};
+
+/*
+ * Profiler class: owns the statistics of every thread that used a timer or a counter.
+ */
+class Profiler
+{
+private:
+    bool _enabled;
+    std::mutex _threads_mutex;
+    std::vector<Profile_Stats*> _threads;
+
+    Profiler()
+    {
+        _enabled = false;
+    }
+
+public:
+    ~Profiler()
+    {
+        for (int t = 0; t < _threads.size(); t++)
+        {
+            delete _threads[t];
+        }
+    }
+
+    /*
+     * returns the profiler of the process
+     */
+    static Profiler& instance()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    /*
+     * returns the statistics of the calling thread. They stay owned by the
+     * profiler, so they are still merged after the thread has exited.
+     */
+    static Profile_Stats& local()
+    {
+        static thread_local Profile_Stats* stats = NULL;
+        if (stats == NULL)
+        {
+            Profiler& profiler = instance();
+            std::lock_guard<std::mutex> lock(profiler._threads_mutex);
+            stats = new Profile_Stats();
+            profiler._threads.push_back(stats);
+        }
+        return *stats;
+    }
+
+    static bool enabled()
+    {
+        return instance()._enabled;
+    }
+
+    static void setEnabled(bool enabled)
+    {
+        instance()._enabled = enabled;
+    }
+
+    /*
+     * adds value to a counter of the calling thread
+     * @pram: counter
+     * @pram: value
+     */
+    static void count(int counter, long long value)
+    {
+        if (enabled())
+        {
+            local().counters[counter] += value;
+        }
+    }
+
+    /*
+     * returns the merged statistics of all threads of the process
+     */
+    static Profile_Stats collect()
+    {
+        Profiler& profiler = instance();
+        std::lock_guard<std::mutex> lock(profiler._threads_mutex);
+        Profile_Stats total;
+        for (int t = 0; t < profiler._threads.size(); t++)
+        {
+            total.merge(*profiler._threads[t]);
+        }
+        return total;
+    }
+};
+
+/*
+ * ScopedTimer class: adds the wall clock time between its construction and
+ * its destruction (or stop) to a phase of the calling thread.
+ */
+class ScopedTimer
+{
+private:
+    int _phase;
+    bool _running;
+    WallClock::time_point _start;
+
+public:
+    explicit ScopedTimer(int phase)
+    {
+        _phase = phase;
+        _running = Profiler::enabled();
+        if (_running)
+        {
+            _start = WallClock::now();
+        }
+    }
+
+    ~ScopedTimer()
+    {
+        stop();
+    }
+
+    void stop()
+    {
+        if (_running)
+        {
+            long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(WallClock::now() - _start).count();
+            Profiler::local().phases[_phase].add(ns);
+            _running = false;
+        }
+    }
+};
+
+/*
+ * writes the statistics of a phase as a JSON object
+ * @pram: output stream
+ * @pram: statistics of the phase
+ */
+void write_phase_json(std::ostream& out, const Phase_Stats& phase)
+{
+    int last_bucket = NUM_OF_BUCKETS - 1;
+    while (last_bucket >= 0 && phase.histogram[last_bucket] == 0)
+    {
+        last_bucket--;
+    }
+    out << "{\"calls\": " << phase.calls
+        << ", \"total_ms\": " << phase.total_ns / 1e6
+        << ", \"mean_us\": " << (phase.calls > 0 ? phase.total_ns / 1e3 / phase.calls : 0)
+        << ", \"min_us\": " << (phase.calls > 0 ? phase.min_ns / 1e3 : 0)
+        << ", \"max_us\": " << phase.max_ns / 1e3
+        << ", \"histogram_log2_ns\": [";
+    for (int b = 0; b <= last_bucket; b++)
+    {
+        out << (b > 0 ? ", " : "") << phase.histogram[b];
+    }
+    out << "]}";
+}
+
+/*
+ * writes the statistics of a rank or of the whole run as a JSON object
+ * @pram: output stream
+ * @pram: statistics
+ * @pram: indentation of the object
+ */
+void write_profile_json(std::ostream& out, const Profile_Stats& stats, const std::string& indent)
+{
+    out << "{\n" << indent << "  \"phases\": {\n";
+    for (int p = 0; p < NUM_OF_PHASES; p++)
+    {
+        out << indent << "    \"" << PHASE_NAMES[p] << "\": ";
+        write_phase_json(out, stats.phases[p]);
+        out << (p + 1 < NUM_OF_PHASES ? ",\n" : "\n");
+    }
+    out << indent << "  },\n" << indent << "  \"counters\": {";
+    for (int c = 0; c < NUM_OF_COUNTERS; c++)
+    {
+        out << (c > 0 ? ", " : "") << "\"" << COUNTER_NAMES[c] << "\": " << stats.counters[c];
+    }
+    out << "}\n" << indent << "}";
+}
+
+/*
+ * writes the statistics of every rank and their sum to a JSON file
+ * @pram: path to the file
+ * @pram: statistics of every rank, indexed by rank
+ */
+void write_profile_file(const std::string& file_path, const std::vector<Profile_Stats>& ranks)
+{
+    std::ofstream file_writer(file_path.c_str(), std::ios::out | std::ios::trunc);
+    if (file_writer.fail())
+    {
+        throw FileDoesNotExistException(file_path);
+    }
+
+    Profile_Stats total;
+    file_writer << "{\n  \"ranks\": [\n";
+    for (int r = 0; r < ranks.size(); r++)
+    {
+        total.merge(ranks[r]);
+        file_writer << "    ";
+        write_profile_json(file_writer, ranks[r], "    ");
+        file_writer << (r + 1 < ranks.size() ? ",\n" : "\n");
+    }
+    file_writer << "  ],\n  \"total\": ";
+    write_profile_json(file_writer, total, "  ");
+    file_writer << "\n}\n";
+}
+
+#endif
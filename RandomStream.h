@@ -0,0 +1,105 @@
+/************************************************************************************
+ * This file contains the random numbers of the matching algorithms. They only use  *
+ * randomness to break ties between equal scores, and every trial of every pair     *
+ * draws from its own counter-based stream: the n-th number of the stream keyed by  *
+ * (seed, graph_i, graph_j, trial) is the SplitMix64 finalizer of key + n*gamma. A  *
+ * stream needs no shared state, so the threads never meet on the lock of rand(),   *
+ * and the matching of a trial only depends on its key: a run gives the same        *
+ * results for the same -seed whatever the number of processors and threads and    *
+ * the order the pairs are computed in (unless -trial_time stops the restarts).     *
+ ************************************************************************************/
+
+#ifndef _RandomStream_h
+#define _RandomStream_h
+
+/*
+ * SplitMix64 finalizer, a bijection of the 64 bit integers that mixes every bit
+ */
+inline unsigned long long splitmix64_mix(unsigned long long z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * returns the key of the streams of a pair of graphs, the trials of the pair are keyed from it
+ * @pram: seed of the run
+ * @pram: index of graph1, -1 for a query graph
+ * @pram: index of graph2
+ */
+inline unsigned long long pair_stream(unsigned long long seed, int graph_i, int graph_j)
+{
+    unsigned long long key = splitmix64_mix(seed + 0x9E3779B97F4A7C15ULL);
+    key = splitmix64_mix(key ^ (unsigned long long)(unsigned int)graph_i);
+    return splitmix64_mix(key ^ ((unsigned long long)(unsigned int)graph_j << 32));
+}
+
+/*
+ * RandomStream class: the stream of one trial, and the number of ties it broke at random.
+ */
+class RandomStream
+{
+private:
+    unsigned long long _key;
+    unsigned long long _counter;
+    long long _ties;
+
+public:
+    RandomStream();
+
+    void seed(unsigned long long pair_key, int trial);
+    unsigned long long next();
+    int below(int n);
+    long long& ties();
+};
+
+/*
+ * Constructor: the stream of trial 0 of the pair key 0.
+ */
+inline RandomStream::RandomStream()
+{
+    seed(0, 0);
+}
+
+/*
+ * Starts the stream of a trial.
+ * @pram unsigned long long: key of the pair, from pair_stream
+ * @pram int: index of the trial
+ */
+inline void RandomStream::seed(unsigned long long pair_key, int trial)
+{
+    this->_key = splitmix64_mix(pair_key ^ splitmix64_mix((unsigned long long)trial + 1));
+    this->_counter = 0;
+    this->_ties = 0;
+}
+
+/*
+ * Returns the next 64 random bits of the stream.
+ */
+inline unsigned long long RandomStream::next()
+{
+    this->_counter++;
+    return splitmix64_mix(this->_key + this->_counter * 0x9E3779B97F4A7C15ULL);
+}
+
+/*
+ * Returns an integer in [0, n), n > 0.
+ * @pram int: number of values
+ */
+inline int RandomStream::below(int n)
+{
+    return (int)(((next() >> 32) * (unsigned long long)n) >> 32);
+}
+
+/*
+ * Returns the number of ties between equal scores broken at random since the stream was
+ * seeded. The restarts of isoRank() stop after a trial that broke no tie, every next trial
+ * would give the same matching.
+ */
+inline long long& RandomStream::ties()
+{
+    return this->_ties;
+}
+
+#endif
@@ -0,0 +1,156 @@
+/************************************************************************************
+ * This file contains the restart controller of isoRank(). The matching algorithms  *
+ * are randomized only where they break ties between equal scores, so the restarts  *
+ * of a pair are stopped as soon as another trial cannot do better:                 *
+ *      - the matching is perfect (frobenius norm 0),                               *
+ *      - the trial did not break any tie at random, every next trial would give    *
+ *        the same matching,                                                        *
+ *      - the last `patience` trials did not improve the best matching. If the      *
+ *        trials are exchangeable, the chance that trial t+1 is the best of all     *
+ *        t+1 trials is 1/(t+1), so a long run without improvement means more      *
+ *        trials are unlikely to pay off,                                           *
+ *      - the trial budget or the time budget of the pair is spent.                 *
+ ************************************************************************************/
+
+#ifndef _RestartPolicy_h
+#define _RestartPolicy_h
+
+#include "Profiler.h"
+
+const int NUM_OF_ISORANK_IT = 20;
+
+/*
+ * Reasons the restarts of a pair were stopped
+ */
+static const int STOP_TRIAL_BUDGET = 0;
+static const int STOP_PERFECT_MATCH = 1;
+static const int STOP_NO_TIES = 2;
+static const int STOP_NO_IMPROVEMENT = 3;
+static const int STOP_TIME_BUDGET = 4;
+
+/*
+ * RestartPolicy: the limits of the restarts of a pair, set with -max_trials, -patience and -trial_time.
+ * patience 0 disables the no-improvement criterion and trial_time 0 disables the time budget.
+ */
+struct RestartPolicy
+{
+    int max_trials;
+    int patience;
+    double trial_time;
+
+    RestartPolicy() : max_trials(NUM_OF_ISORANK_IT), patience(5), trial_time(0) {}
+};
+
+/*
+ * RestartController class: decides after every trial of a pair whether another one is run.
+ */
+class RestartController
+{
+private:
+    const RestartPolicy& _policy;
+    WallClock::time_point _start;
+    int _trials;
+    int _last_improvement;
+    int _stop_reason;
+    bool _stopped;
+
+public:
+    RestartController(const RestartPolicy& policy);
+
+    bool nextTrial();
+    void report(bool improved, double cost, bool used_random_ties);
+    int getTrials();
+    int getStopReason();
+};
+
+/*
+ * Constructor: the time budget starts now.
+ * @pram RestartPolicy: limits of the restarts
+ */
+inline RestartController::RestartController(const RestartPolicy& policy) : _policy(policy)
+{
+    this->_start = WallClock::now();
+    this->_trials = 0;
+    this->_last_improvement = 0;
+    this->_stop_reason = STOP_TRIAL_BUDGET;
+    this->_stopped = false;
+}
+
+/*
+ * Returns true if another trial should be run. The first trial is always run.
+ */
+inline bool RestartController::nextTrial()
+{
+    if (this->_trials == 0)
+    {
+        return true;
+    }
+    if (this->_stopped)
+    {
+        return false;
+    }
+    if (this->_trials >= this->_policy.max_trials)
+    {
+        this->_stop_reason = STOP_TRIAL_BUDGET;
+        return false;
+    }
+    if (this->_policy.trial_time > 0)
+    {
+        double elapsed = std::chrono::duration<double, std::milli>(WallClock::now() - this->_start).count();
+        if (elapsed >= this->_policy.trial_time)
+        {
+            this->_stop_reason = STOP_TIME_BUDGET;
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Records the outcome of a trial.
+ * @pram bool: true if the trial improved the best matching
+ * @pram double: cost of the best matching so far
+ * @pram bool: true if the trial broke a tie at random
+ */
+inline void RestartController::report(bool improved, double cost, bool used_random_ties)
+{
+    this->_trials++;
+    if (improved)
+    {
+        this->_last_improvement = this->_trials;
+    }
+
+    if (cost <= 0)
+    {
+        this->_stopped = true;
+        this->_stop_reason = STOP_PERFECT_MATCH;
+    }
+    else if (!used_random_ties)
+    {
+        this->_stopped = true;
+        this->_stop_reason = STOP_NO_TIES;
+    }
+    else if (this->_policy.patience > 0 && this->_trials - this->_last_improvement >= this->_policy.patience)
+    {
+        this->_stopped = true;
+        this->_stop_reason = STOP_NO_IMPROVEMENT;
+    }
+}
+
+/*
+ * Returns the number of trials run.
+ */
+inline int RestartController::getTrials()
+{
+    return this->_trials;
+}
+
+/*
+ * Returns the reason the restarts were stopped, one of the STOP_ constants.
+ */
+inline int RestartController::getStopReason()
+{
+    return this->_stop_reason;
+}
+
+#endif
@@ -0,0 +1,308 @@
+/************************************************************************************
+ * This file contains the persistent results store used by the incremental mode.   *
+ * Every graph is identified by a hash of its content, so a result computed for a   *
+ * pair of graphs stays valid when files are renumbered or new files are added to   *
+ * the directory. Only pairs that are missing from the store have to be computed    *
+ * and their results are merged into the store, which is written back to disk.      *
+ * The header of the file keeps a hash of the settings that change a result (the    *
+ * matching algorithm, the restarts, the local search, the seed...), a store that   *
+ * was written with other settings is not used.                                     *
+ ************************************************************************************/
+
+#ifndef _ResultsStore_h
+#define _ResultsStore_h
+
+#include <map>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <exception>
+#include "Matrices/MPI_Structs.h"
+#include "Matrices/MatrixExceptions.h"
+
+typedef unsigned long long GraphHash;
+
+static const char STORE_MAGIC[8] = {'I', 'R', 'S', 'T', 'O', 'R', 'E', '2'};
+
+/*
+ * mixes size bytes of data into a 64 bit FNV-1a hash
+ * @pram: current value of the hash
+ * @pram: pointer to the data
+ * @pram: number of bytes
+ */
+GraphHash fnv1a_mix(GraphHash hash, const void* data, int size){
+    const unsigned char* bytes=(const unsigned char*)data;
+    for(int i=0;i<size;i++){
+        hash^=bytes[i];
+        hash*=1099511628211ULL;
+    }
+    return hash;
+}
+
+/*
+ * returns a hash of the content of a graph: its size and the position and value of every
+ * non-zero entry. Works on any matrix class that has operator() and getNumberOfRows/Columns.
+ * @pram: adjacency matrix of the graph
+ */
+template <typename Matrix>
+GraphHash graph_hash(Matrix& graph){
+    GraphHash hash=14695981039346656037ULL;
+    int rows=graph.getNumberOfRows();
+    int cols=graph.getNumberOfColumns();
+    hash=fnv1a_mix(hash,&rows,sizeof(int));
+    hash=fnv1a_mix(hash,&cols,sizeof(int));
+
+    for(int i=0;i<rows;i++){
+        for(int j=0;j<cols;j++){
+            if(graph(i,j)!=0){
+                double value=graph(i,j);
+                hash=fnv1a_mix(hash,&i,sizeof(int));
+                hash=fnv1a_mix(hash,&j,sizeof(int));
+                hash=fnv1a_mix(hash,&value,sizeof(double));
+            }
+        }
+    }
+    return hash;
+}
+
+/*
+ * Thrown when a results store was written with other settings than the ones of this run.
+ */
+class StoreMismatchException : public std::exception
+{
+public:
+    virtual const char* what() const throw()
+    {
+        return "results store was written with other settings";
+    }
+};
+
+/*
+ * returns the position of the pair (i, j), i < j, in the order the all-pairs loop visits them
+ * @pram: index of the first graph
+ * @pram: index of the second graph
+ * @pram: number of graphs
+ */
+int pair_index(int i, int j, int number_of_graphs){
+    return i*number_of_graphs-(i*(i+1))/2+(j-i-1);
+}
+
+/*
+ * struct used to store the result of a pair in the store
+ */
+struct Stored_Result
+{
+    int frob_norm;
+    float score;
+    std::vector<int> assignments;
+};
+
+/*
+ * ResultsStore class: maps pairs of graph hashes to the result of IsoRank on that pair.
+ */
+class ResultsStore
+{
+private:
+    std::map<std::pair<GraphHash, GraphHash>, Stored_Result> _results;
+    GraphHash _settings;
+    bool _writable;
+
+public:
+    ResultsStore() : _settings(0), _writable(true) {}
+
+    /*
+     * reads the results saved in a file. A file that does not exist is an empty store. A store that
+     * was written with other settings is not read and is not overwritten by save().
+     * @pram: path to the file
+     * @pram: hash of the settings of this run that change a result
+     */
+    void load(const std::string& file_path, GraphHash settings)
+    {
+        _settings = settings;
+        std::ifstream file_reader(file_path.c_str(), std::ios::in | std::ios::binary);
+        if(file_reader.fail())
+        {
+            return;
+        }
+
+        char magic[8];
+        GraphHash file_settings;
+        int count;
+        file_reader.read(magic, 8);
+        file_reader.read((char*)&file_settings, sizeof(GraphHash));
+        file_reader.read((char*)&count, sizeof(int));
+        if(file_reader.fail() || std::memcmp(magic, STORE_MAGIC, 8) != 0)
+        {
+            throw MatrixReaderException();
+        }
+        if(file_settings != settings)
+        {
+            _writable = false;
+            throw StoreMismatchException();
+        }
+
+        for(int r = 0; r < count; r++)
+        {
+            GraphHash hash_A, hash_B;
+            int length;
+            Stored_Result stored;
+            file_reader.read((char*)&hash_A, sizeof(GraphHash));
+            file_reader.read((char*)&hash_B, sizeof(GraphHash));
+            file_reader.read((char*)&stored.frob_norm, sizeof(int));
+            file_reader.read((char*)&stored.score, sizeof(float));
+            file_reader.read((char*)&length, sizeof(int));
+            if(file_reader.fail() || length < 0)
+            {
+                throw MatrixReaderException();
+            }
+            stored.assignments.resize(length);
+            if(length > 0)
+            {
+                file_reader.read((char*)&stored.assignments[0], length*sizeof(int));
+            }
+            _results[std::make_pair(hash_A, hash_B)] = stored;
+        }
+        file_reader.close();
+    }
+
+    /*
+     * writes the store to a file. The results are written to a temporary file first
+     * so a crash during the write does not destroy the previous store.
+     * @pram: path to the file
+     */
+    void save(const std::string& file_path)
+    {
+        std::string tmp_path = file_path + ".tmp";
+        std::ofstream file_writer(tmp_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(file_writer.fail())
+        {
+            throw FileDoesNotExistException(tmp_path);
+        }
+
+        int count = _results.size();
+        file_writer.write(STORE_MAGIC, 8);
+        file_writer.write((const char*)&_settings, sizeof(GraphHash));
+        file_writer.write((const char*)&count, sizeof(int));
+
+        std::map<std::pair<GraphHash, GraphHash>, Stored_Result>::iterator it;
+        for(it = _results.begin(); it != _results.end(); ++it)
+        {
+            int length = it->second.assignments.size();
+            file_writer.write((const char*)&it->first.first, sizeof(GraphHash));
+            file_writer.write((const char*)&it->first.second, sizeof(GraphHash));
+            file_writer.write((const char*)&it->second.frob_norm, sizeof(int));
+            file_writer.write((const char*)&it->second.score, sizeof(float));
+            file_writer.write((const char*)&length, sizeof(int));
+            if(length > 0)
+            {
+                file_writer.write((const char*)&it->second.assignments[0], length*sizeof(int));
+            }
+        }
+        file_writer.close();
+        std::rename(tmp_path.c_str(), file_path.c_str());
+    }
+
+    /*
+     * returns true if the store has a result for the pair of graphs
+     * @pram: hash of the first graph
+     * @pram: hash of the second graph
+     */
+    bool contains(GraphHash hash_A, GraphHash hash_B)
+    {
+        return _results.find(std::make_pair(hash_A, hash_B)) != _results.end();
+    }
+
+    /*
+     * adds the result of a pair of graphs to the store, replacing an older result
+     * @pram: hash of the first graph
+     * @pram: hash of the second graph
+     * @pram: result of IsoRank on the pair
+     */
+    void insert(GraphHash hash_A, GraphHash hash_B, const IsoRank_Result& result)
+    {
+        Stored_Result stored;
+        stored.frob_norm = result.frob_norm;
+        stored.score = result.score;
+        stored.assignments.assign(result.assignments, result.assignments + result.assignment_length);
+        _results[std::make_pair(hash_A, hash_B)] = stored;
+    }
+
+    /*
+     * returns the stored result of a pair of graphs, the pair must be in the store
+     * @pram: hash of the first graph
+     * @pram: hash of the second graph
+     */
+    const Stored_Result& get(GraphHash hash_A, GraphHash hash_B)
+    {
+        return _results[std::make_pair(hash_A, hash_B)];
+    }
+
+    /*
+     * returns the result of a pair of graphs in the store as the result of the pair (graph_i, graph_j),
+     * the assignments are allocated with new
+     * @pram: hash of the first graph
+     * @pram: hash of the second graph
+     * @pram: index of the first graph
+     * @pram: index of the second graph
+     */
+    IsoRank_Result getResult(GraphHash hash_A, GraphHash hash_B, int graph_i, int graph_j)
+    {
+        const Stored_Result& stored = get(hash_A, hash_B);
+        IsoRank_Result result;
+        result.graph_i = graph_i;
+        result.graph_j = graph_j;
+        result.frob_norm = stored.frob_norm;
+        result.score = stored.score;
+        result.trials = 0;
+        result.assignment_length = stored.assignments.size();
+        result.assignments = new int[result.assignment_length];
+        std::copy(stored.assignments.begin(), stored.assignments.end(), result.assignments);
+        return result;
+    }
+
+    /*
+     * returns false if the file of the store was written with other settings, it is then not saved
+     */
+    bool isWritable()
+    {
+        return _writable;
+    }
+
+    /*
+     * returns the number of pairs in the store
+     */
+    int size()
+    {
+        return _results.size();
+    }
+
+    /*
+     * returns the n*n matrix of frobenius norms between the graphs, in row major order.
+     * Entry (i, j) with i < j is the stored result of the pair, the matrix is symmetric
+     * and pairs that are not in the store are set to -1.
+     * @pram: hashes of the graphs
+     */
+    std::vector<int> similarityMatrix(const std::vector<GraphHash>& hashes)
+    {
+        int n = hashes.size();
+        std::vector<int> matrix(n*n, 0);
+        for(int i = 0; i < n; i++)
+        {
+            for(int j = i + 1; j < n; j++)
+            {
+                int value = -1;
+                if(contains(hashes[i], hashes[j]))
+                {
+                    value = get(hashes[i], hashes[j]).frob_norm;
+                }
+                matrix[i*n + j] = matrix[j*n + i] = value;
+            }
+        }
+        return matrix;
+    }
+};
+
+#endif
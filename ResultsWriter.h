@@ -0,0 +1,303 @@
+/************************************************************************************
+ * This file contains the streaming writer for the results of the all-pairs mode.   *
+ * Results are handed to the writer as they arrive and are written to disk by a     *
+ * background thread, so the receive loop of the master never waits on the disk.    *
+ * The results are written to a binary columnar file and optionally to a CSV or     *
+ * TSV file.                                                                        *
+ *                                                                                  *
+ * Layout of the binary file:                                                       *
+ *      magic                                                                       *
+ *      row groups of up to ROW_GROUP_SIZE results:                                 *
+ *          number of rows n                                                        *
+ *          graph_i[n], graph_j[n], frob_norm[n] (int), score[n] (float)            *
+ *          assignment_offsets[n+1], assignments[assignment_offsets[n]] (int)       *
+ *      an empty row group, the total number of rows and the number of row groups   *
+ * A file that was cut off can still be read up to its last complete row group.     *
+ ************************************************************************************/
+
+#ifndef _ResultsWriter_h
+#define _ResultsWriter_h
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "Matrices/MPI_Structs.h"
+#include "Matrices/MatrixExceptions.h"
+
+static const char RESULTS_MAGIC[8] = {'I', 'R', 'C', 'O', 'L', 'S', '0', '1'};
+static const int ROW_GROUP_SIZE = 1024;
+static const int RESULTS_QUEUE_CAPACITY = 4096;
+
+/*
+ * struct used to store a result in the queue of the writer
+ */
+struct Result_Record
+{
+    int graph_i;
+    int graph_j;
+    int frob_norm;
+    float score;
+    std::vector<int> assignments;
+};
+
+/*
+ * ResultsWriter class: writes the results to disk on a background thread.
+ */
+class ResultsWriter
+{
+private:
+    std::ofstream _binary_writer;
+    std::ofstream _text_writer;
+    char _delimiter;
+
+    std::deque<Result_Record> _queue;
+    int _queue_capacity;
+    bool _closing;
+    std::mutex _queue_mutex;
+    std::condition_variable _not_empty;
+    std::condition_variable _not_full;
+    std::thread _io_thread;
+
+    //columns of the row group that is being filled
+    std::vector<int> _graph_i;
+    std::vector<int> _graph_j;
+    std::vector<int> _frob_norm;
+    std::vector<float> _score;
+    std::vector<int> _assignment_offsets;
+    std::vector<int> _assignments;
+    int _total_rows;
+    int _row_groups;
+
+    /*
+     * writes a column to the binary file
+     * @pram: values of the column
+     */
+    template <typename T>
+    void _writeColumn(const std::vector<T>& column)
+    {
+        if(!column.empty())
+        {
+            _binary_writer.write((const char*)&column[0], column.size()*sizeof(T));
+        }
+    }
+
+    /*
+     * writes the buffered row group to the binary file and starts a new one
+     */
+    void _flushRowGroup()
+    {
+        int rows = _graph_i.size();
+        if(rows == 0)
+        {
+            return;
+        }
+        _binary_writer.write((const char*)&rows, sizeof(int));
+        _writeColumn(_graph_i);
+        _writeColumn(_graph_j);
+        _writeColumn(_frob_norm);
+        _writeColumn(_score);
+        _writeColumn(_assignment_offsets);
+        _writeColumn(_assignments);
+        _binary_writer.flush();
+        _total_rows += rows;
+        _row_groups++;
+
+        _graph_i.clear();
+        _graph_j.clear();
+        _frob_norm.clear();
+        _score.clear();
+        _assignments.clear();
+        _assignment_offsets.assign(1, 0);
+    }
+
+    /*
+     * adds a result to the row group and to the text file
+     * @pram: result
+     */
+    void _writeRecord(const Result_Record& record)
+    {
+        if(_binary_writer.is_open())
+        {
+            _graph_i.push_back(record.graph_i);
+            _graph_j.push_back(record.graph_j);
+            _frob_norm.push_back(record.frob_norm);
+            _score.push_back(record.score);
+            _assignments.insert(_assignments.end(), record.assignments.begin(), record.assignments.end());
+            _assignment_offsets.push_back(_assignments.size());
+            if(_graph_i.size() == ROW_GROUP_SIZE)
+            {
+                _flushRowGroup();
+            }
+        }
+
+        if(_text_writer.is_open())
+        {
+            _text_writer << record.graph_i << _delimiter << record.graph_j << _delimiter << record.frob_norm
+                         << _delimiter << record.score << _delimiter;
+            for(int k = 0; k < record.assignments.size(); k++)
+            {
+                _text_writer << (k > 0 ? " " : "") << record.assignments[k];
+            }
+            _text_writer << '\n';
+        }
+    }
+
+    /*
+     * body of the I/O thread: writes the queued results until the writer is closed
+     */
+    void _run()
+    {
+        while(true)
+        {
+            std::deque<Result_Record> batch;
+            {
+                std::unique_lock<std::mutex> lock(_queue_mutex);
+                while(_queue.empty() && !_closing)
+                {
+                    _not_empty.wait(lock);
+                }
+                if(_queue.empty())
+                {
+                    break;
+                }
+                batch.swap(_queue);
+            }
+            _not_full.notify_all();
+
+            for(int r = 0; r < batch.size(); r++)
+            {
+                _writeRecord(batch[r]);
+            }
+            if(_text_writer.is_open())
+            {
+                _text_writer.flush();
+            }
+        }
+
+        if(_binary_writer.is_open())
+        {
+            _flushRowGroup();
+            int empty_group = 0;
+            _binary_writer.write((const char*)&empty_group, sizeof(int));
+            _binary_writer.write((const char*)&_total_rows, sizeof(int));
+            _binary_writer.write((const char*)&_row_groups, sizeof(int));
+            _binary_writer.close();
+        }
+        if(_text_writer.is_open())
+        {
+            _text_writer.close();
+        }
+    }
+
+public:
+    ResultsWriter()
+    {
+        _delimiter = ',';
+        _queue_capacity = 0;
+        _closing = false;
+        _total_rows = 0;
+        _row_groups = 0;
+    }
+
+    virtual ~ResultsWriter()
+    {
+        close();
+    }
+
+    /*
+     * returns true if results are being written
+     */
+    bool isOpen()
+    {
+        return _io_thread.joinable();
+    }
+
+    /*
+     * opens the output files and starts the I/O thread. Empty paths are not written.
+     * @pram: path to the binary file
+     * @pram: path to the text file
+     * @pram: delimiter of the text file (',' for CSV, '\t' for TSV)
+     * @pram: maximum number of results that wait in the queue
+     */
+    void open(const std::string& binary_path, const std::string& text_path, char delimiter, int queue_capacity)
+    {
+        if(binary_path.empty() && text_path.empty())
+        {
+            return;
+        }
+        if(!binary_path.empty())
+        {
+            _binary_writer.open(binary_path.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            if(_binary_writer.fail())
+            {
+                throw FileDoesNotExistException(binary_path);
+            }
+            _binary_writer.write(RESULTS_MAGIC, 8);
+            _assignment_offsets.assign(1, 0);
+        }
+        if(!text_path.empty())
+        {
+            _text_writer.open(text_path.c_str(), std::ios::out | std::ios::trunc);
+            if(_text_writer.fail())
+            {
+                throw FileDoesNotExistException(text_path);
+            }
+            _delimiter = delimiter;
+            _text_writer << "graph_i" << _delimiter << "graph_j" << _delimiter << "frob_norm" << _delimiter
+                         << "score" << _delimiter << "assignment" << '\n';
+        }
+        _queue_capacity = queue_capacity;
+        _closing = false;
+        _io_thread = std::thread(&ResultsWriter::_run, this);
+    }
+
+    /*
+     * queues a result to be written. Only waits if the queue is full.
+     * @pram: result with its pair indices
+     */
+    void write(const IsoRank_Result& result)
+    {
+        if(!isOpen())
+        {
+            return;
+        }
+        Result_Record record;
+        record.graph_i = result.graph_i;
+        record.graph_j = result.graph_j;
+        record.frob_norm = result.frob_norm;
+        record.score = result.score;
+        record.assignments.assign(result.assignments, result.assignments + result.assignment_length);
+        {
+            std::unique_lock<std::mutex> lock(_queue_mutex);
+            while(_queue.size() >= _queue_capacity)
+            {
+                _not_full.wait(lock);
+            }
+            _queue.push_back(record);
+        }
+        _not_empty.notify_one();
+    }
+
+    /*
+     * writes the queued results, finishes the files and stops the I/O thread
+     */
+    void close()
+    {
+        if(!isOpen())
+        {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(_queue_mutex);
+            _closing = true;
+        }
+        _not_empty.notify_one();
+        _io_thread.join();
+    }
+};
+
+#endif
@@ -0,0 +1,191 @@
+/************************************************************************************
+ * This file contains the node shared graph store used by the broadcast version     *
+ * with -shared_graphs. Instead of every rank keeping its own copy of all graphs,   *
+ * the ranks of a node share one copy in a MPI-3 shared memory window:              *
+ *      - the ranks are split by node (MPI_COMM_TYPE_SHARED), the lowest rank of    *
+ *        every node is its leader and the master leads its own node                *
+ *      - the leader of every node allocates the window and the master broadcasts   *
+ *        the compact forms of the graphs (CompactForm.h) to the leaders only, who  *
+ *        unpack them directly into their windows                                   *
+ *      - every rank of the node reads the graphs in place through SymMatrix        *
+ *        objects that wrap the window, nothing is copied                           *
+ * The graphs are read only once they are shared.                                   *
+ ************************************************************************************/
+
+#ifndef _SharedGraphs_h
+#define _SharedGraphs_h
+
+#ifdef USE_MPI
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include "mpi.h"
+#include "Matrices/SymMatrix.h"
+#include "Matrices/CompactForm.h"
+
+/*
+ * SharedGraphs class: the graphs of a run, stored once per node.
+ */
+template <typename T>
+class SharedGraphs
+{
+private:
+    MPI_Comm _node_comm;
+    MPI_Comm _leader_comm;
+    MPI_Win _window;
+    bool _is_node_leader;
+    std::vector<SymMatrix<T>*> _graphs;
+
+public:
+    SharedGraphs(int master_id, const std::vector<SymMatrix<T>*>& master_graphs);
+    virtual ~SharedGraphs();
+
+    bool isNodeLeader();
+    int getNumberOfGraphs();
+    std::vector<SymMatrix<T>*>& getGraphs();
+};
+
+/*
+ * Constructor: must be called by every rank of MPI_COMM_WORLD.
+ * @pram int master_id: ID of the rank that read the graphs
+ * @pram std::vector<SymMatrix<T>*>: the graphs, only read on the master
+ */
+template <typename T>
+inline SharedGraphs<T>::SharedGraphs(int master_id, const std::vector<SymMatrix<T>*>& master_graphs)
+{
+    int ID;
+    MPI_Comm_rank(MPI_COMM_WORLD, &ID);
+
+    //the master gets the lowest key so it is the leader of its node and rank 0 of the leaders
+    int key = (ID == master_id) ? 0 : ID + 1;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, key, MPI_INFO_NULL, &this->_node_comm);
+    int node_rank;
+    MPI_Comm_rank(this->_node_comm, &node_rank);
+    this->_is_node_leader = (node_rank == 0);
+    MPI_Comm_split(MPI_COMM_WORLD, this->_is_node_leader ? 0 : MPI_UNDEFINED, key, &this->_leader_comm);
+
+    //number of graphs and their sizes: master -> leaders -> ranks of the node
+    int number_of_graphs = master_graphs.size();
+    if (this->_is_node_leader)
+    {
+        MPI_Bcast(&number_of_graphs, 1, MPI_INT, 0, this->_leader_comm);
+    }
+    MPI_Bcast(&number_of_graphs, 1, MPI_INT, 0, this->_node_comm);
+
+    std::vector<int> sizes(number_of_graphs);
+    for (int i = 0; i < master_graphs.size(); i++)
+    {
+        sizes[i] = master_graphs[i]->_size;
+    }
+    if (number_of_graphs > 0)
+    {
+        if (this->_is_node_leader)
+        {
+            MPI_Bcast(&sizes[0], number_of_graphs, MPI_INT, 0, this->_leader_comm);
+        }
+        MPI_Bcast(&sizes[0], number_of_graphs, MPI_INT, 0, this->_node_comm);
+    }
+
+    //position of every packed graph in the window
+    std::vector<size_t> offsets(number_of_graphs + 1, 0);
+    for (int i = 0; i < number_of_graphs; i++)
+    {
+        offsets[i + 1] = offsets[i] + size_t(sizes[i]) * (sizes[i] + 1) / 2;
+    }
+
+    //only the leader allocates memory, the other ranks of the node map the leader's segment
+    T* window_edges;
+    MPI_Aint window_size = this->_is_node_leader ? offsets[number_of_graphs] * sizeof(T) : 0;
+    MPI_Win_allocate_shared(window_size, sizeof(T), MPI_INFO_NULL, this->_node_comm, &window_edges, &this->_window);
+    int disp_unit;
+    MPI_Win_shared_query(this->_window, 0, &window_size, &disp_unit, &window_edges);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, this->_window);
+
+    if (this->_is_node_leader)
+    {
+        for (int i = 0; i < number_of_graphs; i++)
+        {
+            if (ID == master_id)
+            {
+                memcpy(window_edges + offsets[i], master_graphs[i]->_edges, (offsets[i + 1] - offsets[i]) * sizeof(T));
+            }
+            std::vector<unsigned char> compact_form;
+            int num_bytes = 0;
+            if (ID == master_id)
+            {
+                compact_form = compact_encode<T>(*master_graphs[i], sizes[i], sizes[i], true);
+                num_bytes = compact_form.size();
+            }
+            MPI_Bcast(&num_bytes, 1, MPI_INT, 0, this->_leader_comm);
+            compact_form.resize(num_bytes);
+            MPI_Bcast(&compact_form[0], num_bytes, MPI_BYTE, 0, this->_leader_comm);
+            if (ID != master_id)
+            {
+                std::fill(window_edges + offsets[i], window_edges + offsets[i + 1], T(0));
+                SymMatrix<T> window_graph(window_edges + offsets[i], sizes[i]);
+                compact_decode<T>(compact_form, window_graph);
+            }
+        }
+    }
+
+    //make the leader's writes visible to the other ranks of the node
+    MPI_Win_sync(this->_window);
+    MPI_Barrier(this->_node_comm);
+    MPI_Win_sync(this->_window);
+
+    for (int i = 0; i < number_of_graphs; i++)
+    {
+        this->_graphs.push_back(new SymMatrix<T>(window_edges + offsets[i], sizes[i]));
+    }
+}
+
+/*
+ * Destructor: frees the window. Like the constructor it must be called by every rank,
+ * after the graphs are not used anymore.
+ */
+template <typename T>
+inline SharedGraphs<T>::~SharedGraphs()
+{
+    for (int i = 0; i < this->_graphs.size(); i++)
+    {
+        delete this->_graphs[i];
+    }
+    MPI_Win_unlock_all(this->_window);
+    MPI_Win_free(&this->_window);
+    if (this->_leader_comm != MPI_COMM_NULL)
+    {
+        MPI_Comm_free(&this->_leader_comm);
+    }
+    MPI_Comm_free(&this->_node_comm);
+}
+
+/*
+ * Returns true if this rank allocated the window of its node.
+ */
+template <typename T>
+inline bool SharedGraphs<T>::isNodeLeader()
+{
+    return this->_is_node_leader;
+}
+
+/*
+ * Returns the number of graphs.
+ */
+template <typename T>
+inline int SharedGraphs<T>::getNumberOfGraphs()
+{
+    return this->_graphs.size();
+}
+
+/*
+ * Returns the graphs. They are views of the window and are deleted with the SharedGraphs object.
+ */
+template <typename T>
+inline std::vector<SymMatrix<T>*>& SharedGraphs<T>::getGraphs()
+{
+    return this->_graphs;
+}
+
+#endif
+
+#endif
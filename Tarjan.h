@@ -10,8 +10,10 @@
 #include "Matrices/DenseMatrix1D.h"
 #include "Matrices/SparseElement.h"
 #include "Vertex.h"
+#include "Arena.h"
 #include <vector>
 #include <stack>
+#include <new>
 
 /*
  * performs a binary search on the edges of sparse graph
@@ -173,22 +175,39 @@ void strong_com(std::vector<SparseElement<T> >& sparse_graph, int num_vertices,i
 
 
 /*
- * function that call's strong_connected_component function to find the components of the graph
- * @pram: pointer to array of pointers of sparse_matrix_element structs
- * @pram: the number of sprase_matrix_element's in sparse_graph
- * @pram: the number of vertices in the graph
- * @pram: stack used to perform tarjan's algorithm
+ * runs tarjan's algorithm from every vertex whose low-link has not been set
+ * @pram: the graph
+ * @pram: one vertex object per node of the graph, named after the node and with a low-link of -1
  */
-
-template <typename T>
-std::vector<vertex*> graph_con_com(DenseMatrix1D<T>& sm){
+template <template <typename> class Matrix, typename T>
+void label_con_com(Matrix<T>& sm, std::vector<vertex*>& vertices){
     
     std::stack<vertex*> st;
     int num_vertices = sm.getNumberOfRows();
     std::vector<SparseElement<T> > sparse_form = sm.getSparseForm();
-    std::vector<vertex*> vertices(num_vertices);
     int index=0;
     
+    for(int i=0;i < num_vertices;i++)
+    {
+        //if the low-link of the vertex has not been set call strong-component on the vertex 
+        if( vertices[i]->get_low_link()==-1)
+        {
+            strong_com(sparse_form,num_vertices,&index,i,vertices,st);
+        }
+    }
+}
+
+/*
+ * function that call's strong_connected_component function to find the components of the graph.
+ * The vertex objects are allocated with new and have to be deleted by the caller.
+ * @pram: the graph
+ */
+
+template <template <typename> class Matrix, typename T>
+std::vector<vertex*> graph_con_com(Matrix<T>& sm){
+    
+    int num_vertices = sm.getNumberOfRows();
+    std::vector<vertex*> vertices(num_vertices);
     
     //create an array of vertex objects
     for(int j=0;j<num_vertices;j++)
@@ -196,16 +215,31 @@ std::vector<vertex*> graph_con_com(DenseMatrix1D<T>& sm){
         vertices[j] = new vertex(j,-1);
     }
     
+    label_con_com(sm, vertices);
+    return vertices;
+}
+
+/*
+ * same as graph_con_com(sm), but the vertex objects are taken from an arena and
+ * are released with it instead of being deleted.
+ * @pram: the graph
+ * @pram: the arena of the current pair
+ */
+
+template <template <typename> class Matrix, typename T>
+std::vector<vertex*> graph_con_com(Matrix<T>& sm, Arena& arena){
     
-    for(int i=0;i < num_vertices;i++)
+    int num_vertices = sm.getNumberOfRows();
+    std::vector<vertex*> vertices(num_vertices);
+    vertex* vertex_memory = arena.allocate<vertex>(num_vertices);
+    
+    //vertex has nothing to release, so its destructor does not have to run
+    for(int j=0;j<num_vertices;j++)
     {
-        //if the low-link of the vertex has not been set call strong-component on the vertex 
-        if( vertices[i]->get_low_link()==-1)
-        {
-            strong_com(sparse_form,num_vertices,&index,i,vertices,st);
-        }
+        vertices[j] = new (vertex_memory + j) vertex(j,-1);
     }
     
+    label_con_com(sm, vertices);
     return vertices;
 }
 
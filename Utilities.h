@@ -175,31 +175,66 @@ DT* scalar_multiplication(DT *old_row,int size, DT scaling_factor){
 }
 
 /*
- * takes an array of vertex objects vertices and an integer
- * signifying a component of the graph. The function returns
- * an integer array where vertices that don't belong to the
- * component are masked out.
+ * struct used to store the connected components of a graph in CSR form: the nodes of
+ * component c are members[offsets[c]] to members[offsets[c+1]-1], in increasing order.
+ */
+struct ComponentPartition
+{
+    std::vector<int> offsets;
+    std::vector<int> members;
+
+    int getNumberOfComponents() const
+    {
+        return offsets.size() - 1;
+    }
+
+    int getComponentSize(int component) const
+    {
+        return offsets[component + 1] - offsets[component];
+    }
+
+    const int* getComponentMembers(int component) const
+    {
+        return members.empty() ? NULL : &members[offsets[component]];
+    }
+};
+
+/*
+ * takes an array of vertex objects vertices and groups them by the
+ * component they belong to (their low link), in one pass over the vertices.
+ * Components are ordered by their low link.
  * @param: std::vector of pointers to vertex objects
- * @param: the component we wish to mask
  */
-std::vector<int>* component_mask(std::vector<vertex*>& vertices, int component){
+ComponentPartition component_partition(std::vector<vertex*>& vertices){
     
-    std::vector<int>* comp_mask = NULL;
-    bool hasConnectedComponeents = false;
+    int num_vertices = vertices.size();
+    ComponentPartition partition;
     
-    for(int i=0;i< vertices.size();i++)
+    //component_index[l] is first the size of the component with low link l, then its index
+    std::vector<int> component_index(num_vertices, 0);
+    for(int i=0;i<num_vertices;i++)
     {
-        vertex* curr_vertex= vertices[i];
-        if(curr_vertex->get_low_link()==component){
-            if (!hasConnectedComponeents)
-            {
-                comp_mask = new std::vector<int>(vertices.size(),0);
-                hasConnectedComponeents = true;
-            }
-            (*comp_mask)[i] = 1;
+        component_index[vertices[i]->get_low_link()]++;
+    }
+    
+    partition.offsets.push_back(0);
+    for(int l=0;l<num_vertices;l++)
+    {
+        if(component_index[l] > 0)
+        {
+            partition.offsets.push_back(partition.offsets.back() + component_index[l]);
+            component_index[l] = partition.offsets.size() - 2;
         }
     }
-    return comp_mask;
+    
+    //the vertices are visited in increasing order, so the members of every component are sorted
+    std::vector<int> next(partition.offsets.begin(), partition.offsets.end() - 1);
+    partition.members.resize(num_vertices);
+    for(int i=0;i<num_vertices;i++)
+    {
+        partition.members[next[component_index[vertices[i]->get_low_link()]]++] = i;
+    }
+    return partition;
 }
 
 #endif
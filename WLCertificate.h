@@ -0,0 +1,201 @@
+/************************************************************************************
+ * This file contains the Weisfeiler-Lehman certificate of a graph, the fast path   *
+ * for pairs of isomorphic graphs. Color refinement starts from the degrees and     *
+ * gives every vertex the color of its old color and the sorted colors of its       *
+ * neighbors until the number of colors stops growing. The new colors are the ranks *
+ * of these signatures in sorted order, so they do not depend on the numbering of   *
+ * the vertices and isomorphic graphs end with the same colors.                     *
+ *                                                                                  *
+ * When every vertex ends with its own color (a discrete partition) the colors are  *
+ * a canonical numbering of the graph: two such graphs are isomorphic exactly when  *
+ * the vertices of the same color have the same edges, and the mapping is read     *
+ * from the colors. The certificate keeps a hash of the canonically numbered graph  *
+ * and the mapping is verified before it is used, so a hash collision can not give  *
+ * a wrong result. Graphs whose partition is not discrete are left to isoRank().    *
+ ************************************************************************************/
+
+#ifndef _WLCertificate_h
+#define _WLCertificate_h
+
+#include <vector>
+#include <algorithm>
+#include "ResultsStore.h"
+#include "GreedyAlgorithmsHelper.h"
+#include "Matrices/MPI_Structs.h"
+
+/*
+ * struct used to store the certificate of a graph
+ */
+struct WL_Certificate
+{
+    int size;
+    bool discrete;
+    GraphHash hash;
+    std::vector<int> colors;
+    std::vector<int> vertex_of_color;
+};
+
+/*
+ * struct used to sort the vertices by their signature during a refinement round
+ */
+struct WL_Signature
+{
+    int vertex;
+    int color;
+    std::vector<int> neighbor_colors;
+
+    bool operator<(const WL_Signature& other) const
+    {
+        if (color != other.color)
+        {
+            return color < other.color;
+        }
+        return neighbor_colors < other.neighbor_colors;
+    }
+
+    bool operator==(const WL_Signature& other) const
+    {
+        return color == other.color && neighbor_colors == other.neighbor_colors;
+    }
+};
+
+/*
+ * returns the WL certificate of a graph. Works on any matrix class that has operator()
+ * and getNumberOfRows.
+ * @pram: adjacency matrix of the graph
+ */
+template <typename Matrix>
+WL_Certificate wl_certificate(Matrix& graph){
+    int size=graph.getNumberOfRows();
+    WL_Certificate certificate;
+    certificate.size=size;
+
+    //the self loops are part of the initial color, the other edges of the neighbor lists
+    std::vector<std::vector<int> > neighbors(size);
+    std::vector<WL_Signature> signatures(size);
+    for(int i=0;i<size;i++){
+        for(int j=0;j<size;j++){
+            if(i!=j&&graph(i,j)!=0){
+                neighbors[i].push_back(j);
+            }
+        }
+        signatures[i].vertex=i;
+        signatures[i].color=2*neighbors[i].size()+(graph(i,i)!=0?1:0);
+    }
+
+    //the initial colors are ranked as well, so the colors are always 0..num_colors-1
+    std::vector<int> colors(size);
+    int num_colors=0;
+    std::sort(signatures.begin(),signatures.end());
+    for(int k=0;k<size;k++){
+        if(k>0&&!(signatures[k]==signatures[k-1])){
+            num_colors++;
+        }
+        colors[signatures[k].vertex]=num_colors;
+    }
+    num_colors=size>0?num_colors+1:0;
+
+    //refine until the partition is stable
+    while(num_colors<size){
+        for(int v=0;v<size;v++){
+            WL_Signature& signature=signatures[v];
+            signature.vertex=v;
+            signature.color=colors[v];
+            signature.neighbor_colors.resize(neighbors[v].size());
+            for(int k=0;k<neighbors[v].size();k++){
+                signature.neighbor_colors[k]=colors[neighbors[v][k]];
+            }
+            std::sort(signature.neighbor_colors.begin(),signature.neighbor_colors.end());
+        }
+        std::sort(signatures.begin(),signatures.end());
+
+        int new_num_colors=0;
+        for(int k=0;k<size;k++){
+            if(k>0&&!(signatures[k]==signatures[k-1])){
+                new_num_colors++;
+            }
+            colors[signatures[k].vertex]=new_num_colors;
+        }
+        new_num_colors++;
+        if(new_num_colors==num_colors){
+            break;
+        }
+        num_colors=new_num_colors;
+    }
+
+    certificate.discrete=(num_colors==size);
+    certificate.colors=colors;
+
+    //hash of the sizes of the color classes, and of the edges numbered by color if the partition is discrete
+    GraphHash hash=14695981039346656037ULL;
+    hash=fnv1a_mix(hash,&size,sizeof(int));
+    hash=fnv1a_mix(hash,&num_colors,sizeof(int));
+    std::vector<int> class_sizes(num_colors,0);
+    for(int v=0;v<size;v++){
+        class_sizes[colors[v]]++;
+    }
+    for(int c=0;c<num_colors;c++){
+        hash=fnv1a_mix(hash,&class_sizes[c],sizeof(int));
+    }
+    if(certificate.discrete){
+        certificate.vertex_of_color.resize(size);
+        for(int v=0;v<size;v++){
+            certificate.vertex_of_color[colors[v]]=v;
+        }
+        for(int c=0;c<size;c++){
+            int v=certificate.vertex_of_color[c];
+            std::vector<int> neighbor_colors;
+            for(int k=0;k<neighbors[v].size();k++){
+                neighbor_colors.push_back(colors[neighbors[v][k]]);
+            }
+            std::sort(neighbor_colors.begin(),neighbor_colors.end());
+            for(int k=0;k<neighbor_colors.size();k++){
+                double value=graph(v,certificate.vertex_of_color[neighbor_colors[k]]);
+                hash=fnv1a_mix(hash,&neighbor_colors[k],sizeof(int));
+                hash=fnv1a_mix(hash,&value,sizeof(double));
+            }
+            double self_loop=graph(v,v);
+            hash=fnv1a_mix(hash,&self_loop,sizeof(double));
+        }
+    }
+    certificate.hash=hash;
+    return certificate;
+}
+
+/*
+ * matches two graphs by their certificates. Returns true and sets the result (frobenius norm 0,
+ * score 0 as no scores matrix is computed, no trials) if both partitions are discrete, the
+ * certificates are equal and the mapping of the colors is an isomorphism.
+ * @pram: certificate of graph1
+ * @pram: certificate of graph2
+ * @pram: adjacency matrix of graph1
+ * @pram: adjacency matrix of graph2
+ * @pram: set to the result if the graphs were matched
+ */
+template <template <typename> class Matrix, typename T>
+bool wl_match(const WL_Certificate& certificate_A, const WL_Certificate& certificate_B,
+              Matrix<T>& graph1, Matrix<T>& graph2, IsoRank_Result& result){
+    if(!certificate_A.discrete||!certificate_B.discrete||certificate_A.size!=certificate_B.size
+       ||certificate_A.hash!=certificate_B.hash){
+        return false;
+    }
+
+    int size=certificate_A.size;
+    int* assignment=new int[size];
+    for(int v=0;v<size;v++){
+        assignment[v]=certificate_B.vertex_of_color[certificate_A.colors[v]];
+    }
+    if(frobenius_score(assignment,graph1,graph2)!=0){
+        delete []assignment;
+        return false;
+    }
+
+    result.frob_norm=0;
+    result.score=0;
+    result.assignments=assignment;
+    result.assignment_length=size;
+    result.trials=0;
+    return true;
+}
+
+#endif
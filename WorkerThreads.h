@@ -0,0 +1,232 @@
+/************************************************************************************
+ * This file contains the thread pool used by the hybrid MPI + threads mode of the  *
+ * parallel versions (-threads N). Only the main thread of a rank calls MPI         *
+ * (MPI_THREAD_FUNNELED): it pushes the pairs of graphs it gets to the pool, the    *
+ * compute threads run isoRank() on them and the main thread takes the finished     *
+ * results back in batches to send them to the master. With 0 threads the jobs are  *
+ * run by the main thread itself when it takes the results.                         *
+ ************************************************************************************/
+
+#ifndef _WorkerThreads_h
+#define _WorkerThreads_h
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include "Matrices/MPI_Structs.h"
+
+/*
+ * struct used to store a pair of graphs to compare
+ */
+template <typename Matrix>
+struct Graph_Pair_Job
+{
+    int graph_i;
+    int graph_j;
+    Matrix* graph_A;
+    Matrix* graph_B;
+};
+
+/*
+ * WorkerThreads class: runs a work function on the jobs pushed to it on a pool of threads.
+ */
+template <typename Job>
+class WorkerThreads
+{
+private:
+    std::function<IsoRank_Result(Job&)> _work;
+    std::vector<std::thread> _threads;
+    std::deque<Job> _jobs;
+    std::vector<IsoRank_Result> _results;
+    std::mutex _mutex;
+    std::condition_variable _job_ready;
+    std::condition_variable _result_ready;
+    int _in_flight;
+    bool _closed;
+
+    void _run();
+    bool _runJob(Job& job, IsoRank_Result& result);
+
+public:
+    WorkerThreads(int num_threads, std::function<IsoRank_Result(Job&)> work);
+    virtual ~WorkerThreads();
+
+    void push(const Job& job);
+    int getInFlight();
+    std::vector<IsoRank_Result> takeResults(int timeout_ms);
+    void close();
+};
+
+/*
+ * Constructor: starts the compute threads.
+ * @pram int: number of compute threads, 0 to run the jobs on the thread that takes the results
+ * @pram std::function: work function, returns the result of a job
+ */
+template <typename Job>
+inline WorkerThreads<Job>::WorkerThreads(int num_threads, std::function<IsoRank_Result(Job&)> work)
+{
+    this->_work = work;
+    this->_in_flight = 0;
+    this->_closed = false;
+    for (int t = 0; t < num_threads; t++)
+    {
+        this->_threads.push_back(std::thread(&WorkerThreads<Job>::_run, this));
+    }
+}
+
+/*
+ * Destructor: stops the compute threads once the pushed jobs are done.
+ */
+template <typename Job>
+inline WorkerThreads<Job>::~WorkerThreads()
+{
+    close();
+    for (int t = 0; t < this->_threads.size(); t++)
+    {
+        this->_threads[t].join();
+    }
+}
+
+/*
+ * Adds a job to the queue.
+ * @pram Job
+ */
+template <typename Job>
+inline void WorkerThreads<Job>::push(const Job& job)
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_jobs.push_back(job);
+    this->_in_flight++;
+    this->_job_ready.notify_one();
+}
+
+/*
+ * Returns the number of jobs that were pushed and whose result was not taken yet.
+ */
+template <typename Job>
+inline int WorkerThreads<Job>::getInFlight()
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    return this->_in_flight;
+}
+
+/*
+ * Returns all the results that are finished. Waits until there is at least one
+ * result, for at most timeout_ms milliseconds (forever if it is negative).
+ * Without compute threads one job is run instead.
+ * @pram int: timeout in milliseconds
+ */
+template <typename Job>
+inline std::vector<IsoRank_Result> WorkerThreads<Job>::takeResults(int timeout_ms)
+{
+    std::vector<IsoRank_Result> results;
+    if (this->_threads.empty())
+    {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(this->_mutex);
+            if (this->_jobs.empty())
+            {
+                return results;
+            }
+            job = this->_jobs.front();
+            this->_jobs.pop_front();
+            this->_in_flight--;
+        }
+        IsoRank_Result result;
+        if (_runJob(job, result))
+        {
+            results.push_back(result);
+        }
+        return results;
+    }
+
+    std::unique_lock<std::mutex> lock(this->_mutex);
+    if (timeout_ms < 0)
+    {
+        this->_result_ready.wait(lock, [this]{ return !this->_results.empty() || this->_in_flight == 0; });
+    }
+    else
+    {
+        this->_result_ready.wait_for(lock, std::chrono::milliseconds(timeout_ms),
+                                     [this]{ return !this->_results.empty() || this->_in_flight == 0; });
+    }
+    results.swap(this->_results);
+    this->_in_flight -= results.size();
+    return results;
+}
+
+/*
+ * No more jobs will be pushed: the compute threads stop once the queue is empty.
+ */
+template <typename Job>
+inline void WorkerThreads<Job>::close()
+{
+    std::lock_guard<std::mutex> lock(this->_mutex);
+    this->_closed = true;
+    this->_job_ready.notify_all();
+}
+
+/*
+ * body of the compute threads: runs the queued jobs until the pool is closed
+ */
+template <typename Job>
+inline void WorkerThreads<Job>::_run()
+{
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(this->_mutex);
+            this->_job_ready.wait(lock, [this]{ return !this->_jobs.empty() || this->_closed; });
+            if (this->_jobs.empty())
+            {
+                return;
+            }
+            job = this->_jobs.front();
+            this->_jobs.pop_front();
+        }
+
+        IsoRank_Result result;
+        bool has_result = _runJob(job, result);
+
+        //a job stays in flight until its result is taken
+        std::lock_guard<std::mutex> lock(this->_mutex);
+        if (has_result)
+        {
+            this->_results.push_back(result);
+        }
+        else
+        {
+            this->_in_flight--;
+        }
+        this->_result_ready.notify_one();
+    }
+}
+
+/*
+ * runs the work function on a job. A job that throws has no result, like in the single threaded versions.
+ * @pram Job
+ * @pram IsoRank_Result: set to the result of the job
+ */
+template <typename Job>
+inline bool WorkerThreads<Job>::_runJob(Job& job, IsoRank_Result& result)
+{
+    try
+    {
+        result = this->_work(job);
+        return true;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+        return false;
+    }
+}
+
+#endif
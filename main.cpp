@@ -34,6 +34,16 @@
 #include "Matrices/DenseMatrix1D.h"
 #include "Matrices/MPI_Structs.h"
 #include "IsoRank.h"
+#include "GraphIndex.h"
+#include "ResultsStore.h"
+#include "Checkpoint.h"
+#include "ResultsWriter.h"
+#include "Profiler.h"
+#include "PerfCounters.h"
+#include "SharedGraphs.h"
+#include "WorkerThreads.h"
+#include "GraphCache.h"
+#include "GraphClasses.h"
 
 #ifdef USE_MPI
 #include "mpi.h"
@@ -57,6 +67,83 @@ int G_GRAPH_MATCHING_ALGORITHM = 0;
 bool G_PRINT = false;
 bool G_DEBUG = false;
 
+/*
+ * Query mode: path to the query graph and the number of results.
+ */
+std::string G_QUERY_FILE = "";
+int G_TOP_K = 5;
+
+/*
+ * Persistent results store: path to the store and whether only pairs
+ * that are missing from the store are computed.
+ */
+std::string G_STORE_FILE = "";
+bool G_INCREMENTAL = false;
+
+/*
+ * Checkpoint log: path to the log, whether the pairs in the log are skipped
+ * and the number of seconds between two flushes of the log to disk.
+ */
+std::string G_CHECKPOINT_FILE = "";
+bool G_RESUME = false;
+int G_CHECKPOINT_INTERVAL = 60;
+
+/*
+ * Results output: path to the binary columnar file, path to the text file
+ * and the delimiter of the text file.
+ */
+std::string G_OUTPUT_FILE = "";
+std::string G_TEXT_FILE = "";
+char G_TEXT_DELIMITER = ',';
+
+/*
+ * Path to the JSON file the profile of the run is written to.
+ */
+std::string G_PROFILE_FILE = "";
+
+/*
+ * Broadcast version: whether the ranks of a node share one copy of the graphs.
+ */
+bool G_SHARED_GRAPHS = false;
+
+/*
+ * Parallel versions: number of threads of every processor that run isoRank().
+ */
+int G_NUM_THREADS = 1;
+
+/*
+ * Eigen solver backend of the components (Matrices/EigenSolvers.h), chosen by the
+ * size of every component by default, whether the crossover of the sizes is timed
+ * at startup instead of fixed, and the tolerance of the residual of the mixed
+ * precision Lanczos backend (float entries, double vectors).
+ */
+int G_EIGEN_BACKEND = EIGEN_BACKEND_AUTO;
+bool G_EIGEN_CALIBRATE = false;
+double G_EIGEN_TOLERANCE = 1e-6;
+
+/*
+ * Limits of the restarts of the matching algorithm of every pair.
+ */
+RestartPolicy G_RESTART_POLICY;
+
+/*
+ * Budget of the local search that refines every matching, disabled by default.
+ */
+LocalSearchPolicy G_LOCAL_SEARCH;
+
+/*
+ * Seed of the random streams that break the ties of the matching algorithms, every pair
+ * and trial draws from its own stream so the results do not depend on the scheduling.
+ */
+unsigned long long G_SEED = 0;
+
+/*
+ * Whether the graphs are sorted into isomorphism classes so every pair of classes is computed once,
+ * and whether the classes are joined by their WL certificates or only by identical content.
+ */
+bool G_DEDUP = true;
+bool G_WL_BYPASS = true;
+
 
 /*
  * Preprocessor definitions for the used data type
@@ -75,7 +162,30 @@ typedef float DataType;
  * Function prototypes
  */
 void parseCommandLineArgs(int argc, char * argv[], int ID);
-double timeElapsed(std::clock_t start, std::clock_t end);
+double timeElapsed(WallClock::time_point start, WallClock::time_point end);
+void printTrials(std::vector<IsoRank_Result>& isoRank_results, const std::string& prefix);
+void writeProfile(int ID, int num_procs);
+void calibrateEigenSolvers(int ID);
+#ifdef USE_MPI
+int computeThreads(int thread_support, int ID);
+#endif
+#if SEQ
+void runQuery(std::vector<DenseMatrix1D<DataType>* >& input_graphs, std::vector<int>& graph_files);
+#endif
+template <typename Matrix>
+std::vector<char> openResultsStore(ResultsStore& results_store, std::vector<GraphHash>& graph_hashes, std::vector<Matrix*>& input_graphs,
+                                   std::vector<IsoRank_Result>& isoRank_results);
+GraphHash resultsSettingsHash();
+void closeResultsStore(ResultsStore& results_store, std::vector<GraphHash>& graph_hashes, std::vector<IsoRank_Result>& isoRank_results);
+template <typename Matrix>
+void openCheckpoint(CheckpointLog& checkpoint_log, std::vector<GraphHash>& graph_hashes, std::vector<Matrix*>& input_graphs,
+                    std::vector<char>& pair_done, std::vector<IsoRank_Result>& isoRank_results);
+void openResultsWriter(ResultsWriter& results_writer, std::vector<IsoRank_Result>& isoRank_results);
+template <typename Matrix>
+void planPairs(GraphClasses& graph_classes, std::vector<Matrix*>& input_graphs, std::vector<char>& pair_done,
+               std::vector<IsoRank_Result>& isoRank_results, CheckpointLog& checkpoint_log, ResultsWriter& results_writer);
+void addResult(GraphClasses& graph_classes, const IsoRank_Result& result, std::vector<IsoRank_Result>& isoRank_results,
+               CheckpointLog& checkpoint_log, ResultsWriter& results_writer);
 
 /*****************************************************************************************
 *                                    Sequential method                                   *
@@ -92,14 +202,14 @@ int main(int argc, char * argv[])
     /*
      *Configure the program to use the command line args
      */
-    srand(time(NULL));
     parseCommandLineArgs(argc, argv, 0);
+    calibrateEigenSolvers(0);
     
     /*
      * Timing Variables
      */
-    std::clock_t time_start;
-    std::clock_t time_end;
+    WallClock::time_point time_start;
+    WallClock::time_point time_end;
 	
 	/*
 	 *	Input/Result containers
@@ -107,11 +217,12 @@ int main(int argc, char * argv[])
 	int total_comparisons;
     std::vector<IsoRank_Result> isoRank_results;
     std::vector<DenseMatrix1D<DataType>* >input_graphs;
+    std::vector<int> graph_files;
     
     if(G_PRINT)
         std::cout << "Reading " << G_NUMBER_OF_FILES << " graphs from: " << G_DIR_PATH << std::endl;
     std::ostringstream itos_converter;
-    time_start = std::clock();
+    time_start = WallClock::now();
     /*
      * Reading the graphs and storing them
      */
@@ -121,6 +232,7 @@ int main(int argc, char * argv[])
         {
             itos_converter << G_DIR_PATH << i << G_FILE_EXTENSION;
             input_graphs.push_back(new DenseMatrix1D<DataType>(itos_converter.str()));
+            graph_files.push_back(i);
             itos_converter.str(""); //clearing the stream
             itos_converter.clear();
         }
@@ -132,21 +244,57 @@ int main(int argc, char * argv[])
         }
     }
     total_comparisons = (0.5*(input_graphs.size()-1)*input_graphs.size());
-    time_end = std::clock();
+    time_end = WallClock::now();
     if(G_PRINT)
         std::cout << input_graphs.size() << " of " << G_NUMBER_OF_FILES << " graphs were successfully read in "
         << timeElapsed(time_start, time_end) << "(ms)." << std::endl;
     
-    time_start = std::clock();
+    /*
+     * Query mode: only the k best matches of the query graph are computed
+     */
+    if (!G_QUERY_FILE.empty())
+    {
+        runQuery(input_graphs, graph_files);
+        
+        typename std::vector<DenseMatrix1D<DataType>* >::iterator graph_it;
+        for ( graph_it = input_graphs.begin() ; graph_it < input_graphs.end(); ++graph_it )
+        {
+            delete  *graph_it;
+        }
+        writeProfile(0, 1);
+        return 0;
+    }
+    
+    ResultsStore results_store;
+    std::vector<GraphHash> graph_hashes;
+    std::vector<char> pair_done = openResultsStore(results_store, graph_hashes, input_graphs, isoRank_results);
+    CheckpointLog checkpoint_log;
+    openCheckpoint(checkpoint_log, graph_hashes, input_graphs, pair_done, isoRank_results);
+    ResultsWriter results_writer;
+    openResultsWriter(results_writer, isoRank_results);
+    GraphClasses graph_classes;
+    planPairs(graph_classes, input_graphs, pair_done, isoRank_results, checkpoint_log, results_writer);
+    
+    time_start = WallClock::now();
     for (int i = 0; i < input_graphs.size(); i++)
     {
         for (int j = i +1; j < input_graphs.size(); j++)
         {
+            //skip the pairs that are already in the results store or the checkpoint log
+            if (pair_done[pair_index(i, j, input_graphs.size())])
+            {
+                continue;
+            }
+            
             try
             {
                 if (G_USE_ISORANK)
                 {
-                    isoRank_results.push_back(isoRank(*input_graphs[i], *input_graphs[j], G_GRAPH_MATCHING_ALGORITHM));
+                    IsoRank_Result result = isoRank(*input_graphs[i], *input_graphs[j], G_GRAPH_MATCHING_ALGORITHM, G_EIGEN_BACKEND, G_EIGEN_TOLERANCE, G_RESTART_POLICY, G_LOCAL_SEARCH,
+                                                    pair_stream(G_SEED, i, j));
+                    result.graph_i = i;
+                    result.graph_j = j;
+                    addResult(graph_classes, result, isoRank_results, checkpoint_log, results_writer);
                 }
                 if (G_USE_GPGM)
                 {
@@ -160,7 +308,7 @@ int main(int argc, char * argv[])
             }
         }
     }
-    time_end = std::clock();
+    time_end = WallClock::now();
     
 	
     //printing the results
@@ -175,7 +323,12 @@ int main(int argc, char * argv[])
             std::cout<< isoRank_results[i].frob_norm << ", ";
         }
         std::cout<<std::endl;
+        printTrials(isoRank_results, "");
+        print_perf_counters(std::cout, "");
     }
+    results_writer.close();
+    checkpoint_log.close();
+    closeResultsStore(results_store, graph_hashes, isoRank_results);
     
     typename std::vector<IsoRank_Result>::iterator res_it;
     for ( res_it = isoRank_results.begin() ; res_it < isoRank_results.end(); ++res_it )
@@ -188,9 +341,53 @@ int main(int argc, char * argv[])
     {
         delete  *graph_it;
     }
+    writeProfile(0, 1);
     return 0;
 }
 
+/*
+ * Finds the G_TOP_K graphs of the corpus that best match the graph in G_QUERY_FILE and prints them.
+ * @pram std::vector<DenseMatrix1D<DataType>*> corpus graphs
+ * @pram std::vector<int> file number of each corpus graph
+ */
+void runQuery(std::vector<DenseMatrix1D<DataType>* >& input_graphs, std::vector<int>& graph_files)
+{
+    WallClock::time_point time_start = WallClock::now();
+    std::vector<Query_Result> query_results;
+    int num_evaluated = 0;
+    try
+    {
+        DenseMatrix1D<DataType> query_graph(G_QUERY_FILE);
+        
+        GraphIndex index;
+        for (int i = 0; i < input_graphs.size(); i++)
+        {
+            index.add(i, *input_graphs[i]);
+        }
+        if (G_PRINT)
+            std::cout << "Indexed " << index.size() << " graphs in " << timeElapsed(time_start, WallClock::now()) << "(ms)." << std::endl;
+        
+        query_results = top_k_query(query_graph, input_graphs, index, G_TOP_K, G_GRAPH_MATCHING_ALGORITHM, &num_evaluated,
+                                    G_EIGEN_BACKEND, G_EIGEN_TOLERANCE, G_RESTART_POLICY, G_LOCAL_SEARCH, G_SEED);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << " Exception: " << e.what() << std::endl;
+    }
+    
+    if (G_PRINT)
+        std::cout << "Computed IsoRank for " << num_evaluated << " of " << input_graphs.size() << " graphs in "
+        << timeElapsed(time_start, WallClock::now()) << "(ms)." << std::endl;
+    
+    std::cout << "Top " << query_results.size() << " matches for " << G_QUERY_FILE << ":" << std::endl;
+    for (int i = 0; i < query_results.size(); i++)
+    {
+        std::cout << i + 1 << ": " << G_DIR_PATH << graph_files[query_results[i].graph_id] << G_FILE_EXTENSION
+        << " frob_norm: " << query_results[i].result.frob_norm << " lower bound: " << query_results[i].lower_bound << std::endl;
+        delete [] query_results[i].result.assignments;
+    }
+}
+
 /*****************************************************************************************
 *                                          Node-pair method                              *
 ******************************************************************************************/
@@ -203,7 +400,6 @@ int main(int argc, char * argv[])
  */
 int main(int argc, char * argv[])
 {
-    srand(time(NULL));
 	/*
 	 * MPI Variables
 	 */
@@ -220,9 +416,10 @@ int main(int argc, char * argv[])
     const int TAG_3 = 15;
     
     /*
-     * MPI Initialization calls
+     * MPI Initialization calls, only the main thread calls MPI
      */
-    if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
+    int thread_support = MPI_THREAD_SINGLE;
+    if (MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support) != MPI_SUCCESS)
     {
         std::cout << "Failed To Initialize MPI" << std::endl;
         //MPI_Abort();
@@ -234,12 +431,21 @@ int main(int argc, char * argv[])
      *Configure the program to use the command line args
      */
     parseCommandLineArgs(argc, argv, ID);
+    int num_compute_threads = computeThreads(thread_support, ID);
+    if (!G_QUERY_FILE.empty())
+    {
+        if (ID == MASTER_ID)
+            std::cout << "Query mode is only available in the sequential version (-DSEQ)." << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    calibrateEigenSolvers(ID);
     
     /*
      * Timing Variables
      */
-    std::clock_t time_start;
-    std::clock_t time_end;
+    WallClock::time_point time_start;
+    WallClock::time_point time_end;
 	
 	/*
 	 *	Result variables
@@ -252,7 +458,7 @@ int main(int argc, char * argv[])
     {
     	if(G_PRINT)
     		std::cout << "Reading " << G_NUMBER_OF_FILES << " graphs from: " << G_DIR_PATH << std::endl;
-    	time_start = std::clock();
+    	time_start = WallClock::now();
     	std::ostringstream itos_converter;
     	std::vector<SymMatrix<DataType>* >input_graphs;
         
@@ -276,81 +482,90 @@ int main(int argc, char * argv[])
 			}
 		}
 		total_comparisons = (0.5*(input_graphs.size()-1)*input_graphs.size());
-		time_end = std::clock();
+		time_end = WallClock::now();
 		if(G_PRINT)
 			std::cout << input_graphs.size() << " of " << G_NUMBER_OF_FILES << " graphs were successfully read in "
 			<< timeElapsed(time_start, time_end) << "(ms)." << std::endl;
         
+		ResultsStore results_store;
+		std::vector<GraphHash> graph_hashes;
+		std::vector<char> pair_done = openResultsStore(results_store, graph_hashes, input_graphs, isoRank_results);
+		CheckpointLog checkpoint_log;
+		openCheckpoint(checkpoint_log, graph_hashes, input_graphs, pair_done, isoRank_results);
+		ResultsWriter results_writer;
+		openResultsWriter(results_writer, isoRank_results);
+		GraphClasses graph_classes;
+		planPairs(graph_classes, input_graphs, pair_done, isoRank_results, checkpoint_log, results_writer);
+		int pending_comparisons = total_comparisons - std::count(pair_done.begin(), pair_done.end(), 1);
+        
         /*
-    	 * Sending the graphs to worker nodes.
+    	 * Sending the graphs to worker nodes. Every worker gets one pair per compute thread plus
+    	 * one pair in advance, and one more pair for every result it returns. The sends do not
+    	 * block and only the graphs that the worker does not have yet are sent.
     	 */
-		time_start = std::clock();
-		int dest_ID = 1;
-		int recv_counter = 0;
+		time_start = WallClock::now();
+		std::vector<std::pair<int, int> > pending_pairs;
 		for (int i = 0; i < input_graphs.size(); i++)
 		{
 			for(int j = i + 1; j <  input_graphs.size(); j++)
 			{
-				// Send a pair of graphs to all the worker nodes
-				if (dest_ID < num_procs)
+				//skip the pairs that are already in the results store or the checkpoint log
+				if (!pair_done[pair_index(i, j, input_graphs.size())])
 				{
-					input_graphs[i]->MPI_Send_Matrix(dest_ID, TAG_1 * dest_ID);
-					input_graphs[j]->MPI_Send_Matrix(dest_ID, TAG_1 * dest_ID + TAG_2);
-					
-					if(G_DEBUG)
-						std::cout <<"Master: sending matrix to ID: " << dest_ID << std::endl;
-                    
-					dest_ID++;
-				}
-				// Send additional pairs upon worker node's request
-				else
-				{
-					int dest;
-					//Recv workers ID
-					MPI_Recv(&dest, 1, MPI_INT, MPI_ANY_SOURCE, TAG_1 + TAG_2, MPI_COMM_WORLD,&stat);
-					if(G_DEBUG)
-						std::cout <<"Master: received request for more graphs from: "<< dest<< std::endl;
-                    
-					//Collect the result from worker
-					isoRank_results.push_back(MPI_Recv_IsoRank_Result(dest, TAG_1 * dest + TAG_3, stat));
-					recv_counter++;
-					if(G_DEBUG)
-						std::cout <<"Master: results were received "<< dest<< std::endl;
-                    
-					//Send more graphs to worker node
-					input_graphs[i]->MPI_Send_Matrix(dest, TAG_1 * dest);
-					input_graphs[j]->MPI_Send_Matrix(dest, TAG_1 * dest + TAG_2);
-					if(G_DEBUG)
-						std::cout <<"Master: sending more graphs to: "<< dest<< std::endl;
+					pending_pairs.push_back(std::make_pair(i, j));
 				}
 			}
 		}
-		// Recv the remaining result
-		while (recv_counter < total_comparisons)
+		
+		GraphPairSender<DataType> pair_sender(input_graphs, num_procs);
+		int next_pair = 0;
+		auto sendPair = [&](int dest)
 		{
-			int dest;
-			//Recv workers ID
-			MPI_Recv(&dest, 1, MPI_INT, MPI_ANY_SOURCE, TAG_1 + TAG_2, MPI_COMM_WORLD,&stat);
+			pair_sender.send(pending_pairs[next_pair].first, pending_pairs[next_pair].second, dest, TAG_1 * dest + TAG_3, TAG_1 * dest);
+			next_pair++;
 			if(G_DEBUG)
-				std::cout <<"Master: received request for more graphs from: "<< dest<< std::endl;
-            
-			//Collect the result from worker
-			isoRank_results.push_back(MPI_Recv_IsoRank_Result(dest, TAG_1 * dest + TAG_3, stat));
-			recv_counter++;
+				std::cout <<"Master: sending matrix to ID: " << dest << std::endl;
+		};
+		
+		// Send the first pairs of graphs to all the worker nodes
+		for (int dest = 1; dest < num_procs; dest++)
+		{
+			for (int k = 0; k < std::max(G_NUM_THREADS, 1) + 1 && next_pair < pending_pairs.size(); k++)
+			{
+				sendPair(dest);
+			}
+		}
+		
+		int recv_counter = 0;
+		while (recv_counter < pending_comparisons)
+		{
+			//Collect a batch of results from any worker
+			std::vector<IsoRank_Result> batch = MPI_Recv_IsoRank_Results(MPI_ANY_SOURCE, TAG_1 + TAG_2, stat);
+			int dest = stat.MPI_SOURCE;
 			if(G_DEBUG)
-				std::cout <<"Master: results were received."<< dest<< std::endl;
+				std::cout <<"Master: received "<< batch.size() << " results from: "<< dest<< std::endl;
+			for (int r = 0; r < batch.size(); r++)
+			{
+				addResult(graph_classes, batch[r], isoRank_results, checkpoint_log, results_writer);
+				recv_counter++;
+				
+				// Send additional pairs upon worker node's request
+				if (next_pair < pending_pairs.size())
+				{
+					sendPair(dest);
+				}
+			}
 		}
 		
-		//Terminating the slaves by sending a 0*0 matrix to nodes
+		//Terminating the slaves
  		for(int i=1; i < num_procs; i++)
  		{
- 			SymMatrix<DataType> emptyMat(0);
- 			emptyMat.MPI_Send_Matrix (i, TAG_1*i);
- 			emptyMat.MPI_Send_Matrix (i, TAG_1*i+ TAG_2);
+ 			pair_sender.terminate(i, TAG_1*i + TAG_3);
  			if (G_DEBUG)
  				std::cout <<"Master: sending terminate signal to ID: " << i << std::endl;
  		}
- 		time_end = std::clock();
+ 		pair_sender.waitAll();
+ 		time_end = WallClock::now();
         
 		//printing the results
 		if (G_PRINT)
@@ -358,13 +573,18 @@ int main(int argc, char * argv[])
 			std::cout << "Master: Computed IsoRank successfully for " << G_NUMBER_OF_FILES << " graphs in "
             << timeElapsed(time_start, time_end) << "(ms)." << std::endl;
             
+			std::cout<< "Master: " << pair_sender.getGraphsSent() << " graphs (" << pair_sender.getBytesSent() << " bytes) were sent for " << pair_sender.getPairsSent() << " pairs." << std::endl;
 			std::cout<< "Master: " <<isoRank_results.size() << " results were received.\n frob_norms: ";
 			for (int i=0; i < isoRank_results.size(); i++)
 			{
 				std::cout<< isoRank_results[i].frob_norm << ", ";
 			}
 			std::cout<<std::endl;
+			printTrials(isoRank_results, "Master: ");
 		}
+		results_writer.close();
+		checkpoint_log.close();
+		closeResultsStore(results_store, graph_hashes, isoRank_results);
 		
 		typename std::vector<IsoRank_Result>::iterator res_it;
          for ( res_it = isoRank_results.begin() ; res_it < isoRank_results.end(); ++res_it )
@@ -381,62 +601,90 @@ int main(int argc, char * argv[])
     //======================================================================*WORKER NODES*==============================================================================
     else
     {
-    	while(true)
+    	/*
+    	 * The compute threads run isoRank() on the pairs while this thread receives new pairs
+    	 * from the master and sends the results back in batches. The graphs are kept in the
+    	 * cache, so a graph is only received once.
+    	 */
+    	GraphCache<DataType> graph_cache;
+    	WorkerThreads<Graph_Pair_Job<SymMatrix<DataType> > > workers(num_compute_threads,
+    		[&](Graph_Pair_Job<SymMatrix<DataType> >& job)
+    		{
+    			struct IsoRank_Result result;
+    			if (G_USE_ISORANK)
+    			{
+    				if (G_DEBUG)
+    					std::cout << "Process " << ID << ": isoRank: started." << std::endl;
+    				result = isoRank(*job.graph_A, *job.graph_B, G_GRAPH_MATCHING_ALGORITHM, G_EIGEN_BACKEND, G_EIGEN_TOLERANCE, G_RESTART_POLICY, G_LOCAL_SEARCH,
+    				                 pair_stream(G_SEED, job.graph_i, job.graph_j));
+    				result.graph_i = job.graph_i;
+    				result.graph_j = job.graph_j;
+    				if (G_DEBUG)
+    					std::cout << "Process " << ID << ": isoRank: end." << std::endl;
+    			}
+    			if (G_USE_GPGM)
+    			{
+    				//GPGM(mat1,mat2);
+    			}
+    			return result;
+    		});
+    	IsoRank_Result_Sender result_sender;
+    	bool terminated = false;
+    	
+    	while(!terminated || workers.getInFlight() > 0)
     	{
     		//Recv graphs from the master
-    		DenseMatrix1D<DataType> mat1 (MASTER_ID, TAG_1 * ID ,stat);
-    		DenseMatrix1D<DataType> mat2 (MASTER_ID, TAG_1 * ID + TAG_2 ,stat);
-            
-    		if (G_DEBUG)
-    			std::cout << "Process "<< ID << " : received graphs from master"<< std::endl;
-            
-    		//Terminating the while loop if the matrices are 0*0
-			if (mat1.getNumberOfRows() == 0 && mat2.getNumberOfRows() == 0)
-			{
-				if (G_DEBUG)
-					std::cout << "Process "<< ID << ": received terminate signal from master"<< std::endl;
-				break;
-			}
-
-			struct IsoRank_Result result;
-			try
-			{
-				if (G_USE_ISORANK)
-				{
-					if (G_DEBUG)
-						std::cout << "Process " << ID << ": isoRank: started." << std::endl;
-			  		result = isoRank(mat1, mat2, G_GRAPH_MATCHING_ALGORITHM);
-			  		if (G_DEBUG)
-						std::cout << "Process " << ID << ": isoRank: end." << std::endl;
-				}
-				if (G_USE_GPGM)
-				{
-					//GPGM(mat1,mat2);
-				}
-                
-				if (G_DEBUG)
-					std::cout << "Process "<< ID << " :requesting for more graphs from master" << std::endl;
-				//Sending the ID to master for more graphs
-				MPI_Send(&ID, 1, MPI_INT, MASTER_ID, TAG_1 + TAG_2, MPI_COMM_WORLD);
-                
-				if (G_DEBUG)
-                    std::cout << "Process "<< ID << ": :sending result to master" << std::endl;
-				//Sending results to master
-				MPI_Send_IsoRank_Result(result, MASTER_ID , TAG_1 * ID + TAG_3);
-                delete [] result.assignments;
-				
-			}
-			catch (std::exception& e)
-			{
-				std::cerr << "Process "<< ID << " Exception: " << e.what() << std::endl;
-			}
-		}
-		
+    		int has_pair = 0;
+    		if (!terminated)
+    		{
+    			MPI_Iprobe(MASTER_ID, TAG_1 * ID + TAG_3, MPI_COMM_WORLD, &has_pair, &stat);
+    		}
+    		if (has_pair)
+    		{
+    			Graph_Pair_Job<SymMatrix<DataType> > job;
+    			if (graph_cache.receive(MASTER_ID, TAG_1 * ID + TAG_3, TAG_1 * ID, job, stat))
+    			{
+    				if (G_DEBUG)
+    					std::cout << "Process "<< ID << " : received graphs from master"<< std::endl;
+    				workers.push(job);
+    			}
+    			//Terminating the while loop
+    			else
+    			{
+    				if (G_DEBUG)
+    					std::cout << "Process "<< ID << ": received terminate signal from master, "
+    					<< graph_cache.getNumberOfGraphs() << " graphs for " << graph_cache.getPairsReceived() << " pairs" << std::endl;
+    				terminated = true;
+    			}
+    			continue;
+    		}
+    		
+    		//wait shortly for results so new pairs are still received while the threads compute
+    		std::vector<IsoRank_Result> results = workers.takeResults(terminated ? -1 : 1);
+    		if (!results.empty())
+    		{
+    			if (G_DEBUG)
+    				std::cout << "Process "<< ID << ": sending " << results.size() << " results to master" << std::endl;
+    			//Sending results to master, the master sends one more pair for every result
+    			result_sender.send(results, MASTER_ID, TAG_1 + TAG_2);
+    			for (int r = 0; r < results.size(); r++)
+    			{
+    				delete [] results[r].assignments;
+    			}
+    		}
+    	}
+    	result_sender.waitAll();
 	}
 	
 	if(G_PRINT)
+    {
+        std::ostringstream label;
+        label << "Process " << ID << ": ";
+        print_perf_counters(std::cout, label.str());
     	std::cout << "Process: "<< ID << " terminated." << std::endl;
+    }
     
+    writeProfile(ID, num_procs);
     MPI_Finalize();
     return 0;
 }
@@ -453,7 +701,6 @@ int main(int argc, char * argv[])
  */
 int main(int argc, char * argv[])
 {
-    srand(time(NULL));
 	/*
 	 * MPI Variables
 	 */  
@@ -467,12 +714,12 @@ int main(int argc, char * argv[])
  	const int MASTER_ID = 0;
     const int TAG_1 = 4;
     const int TAG_2 = 10;
-    const int TAG_3 = 15;
 
     /*
-     * MPI Initialization calls 
+     * MPI Initialization calls, only the main thread calls MPI
      */
-    if (MPI_Init(&argc, &argv) != MPI_SUCCESS)
+    int thread_support = MPI_THREAD_SINGLE;
+    if (MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support) != MPI_SUCCESS)
     {
         std::cout << "Failed To Initialize MPI" << std::endl;
         //MPI_Abort();
@@ -484,12 +731,21 @@ int main(int argc, char * argv[])
      *Configure the program to use the command line args
      */
     parseCommandLineArgs(argc, argv, ID);
+    int num_compute_threads = computeThreads(thread_support, ID);
+    if (!G_QUERY_FILE.empty())
+    {
+        if (ID == MASTER_ID)
+            std::cout << "Query mode is only available in the sequential version (-DSEQ)." << std::endl;
+        MPI_Finalize();
+        return 1;
+    }
+    calibrateEigenSolvers(ID);
     
     /*
      * Timing Variables
      */
-    std::clock_t time_start;
-    std::clock_t time_end;
+    WallClock::time_point time_start;
+    WallClock::time_point time_end;
 	
 	/*
 	 *	Result variables
@@ -503,7 +759,7 @@ int main(int argc, char * argv[])
     {
     	if(G_PRINT)
     		std::cout << "Reading " << G_NUMBER_OF_FILES << " graphs from: " << G_DIR_PATH << std::endl;
-    	time_start = std::clock();
+    	time_start = WallClock::now();
     	std::ostringstream itos_converter;
     	std::vector<SymMatrix<DataType>* >input_graphs;
 
@@ -528,7 +784,7 @@ int main(int argc, char * argv[])
 		}
 		number_of_graphs = input_graphs.size();
 		total_comparisons = (0.5*(number_of_graphs-1)*number_of_graphs);
-		time_end = std::clock();
+		time_end = WallClock::now();
 		if(G_PRINT)
 			std::cout << input_graphs.size() << " of " << G_NUMBER_OF_FILES << " graphs were successfully read in "
 			<< timeElapsed(time_start, time_end) << "(ms)." << std::endl;
@@ -536,35 +792,68 @@ int main(int argc, char * argv[])
 		/*
     	 * Sending the graphs to worker nodes.
     	 */
-		time_start = std::clock();
-		MPI_Bcast (&number_of_graphs, 1 , MPI_INT, MASTER_ID, MPI_COMM_WORLD);
-		if(G_DEBUG)
-			std::cout <<"Master: sending "<<number_of_graphs << " graphs to all"<< std::endl;
-		for (int i = 0; i < input_graphs.size(); i++)
+		time_start = WallClock::now();
+		SharedGraphs<DataType>* shared_graphs = NULL;
+		if (G_SHARED_GRAPHS)
+		{
+			if(G_DEBUG)
+				std::cout <<"Master: sending "<<number_of_graphs << " graphs to the node leaders"<< std::endl;
+			shared_graphs = new SharedGraphs<DataType>(MASTER_ID, input_graphs);
+			
+			//the master only keeps the shared copy of its node
+			for (int i = 0; i < input_graphs.size(); i++)
+			{
+				delete input_graphs[i];
+			}
+			input_graphs = shared_graphs->getGraphs();
+		}
+		else
+		{
+			MPI_Bcast (&number_of_graphs, 1 , MPI_INT, MASTER_ID, MPI_COMM_WORLD);
+			if(G_DEBUG)
+				std::cout <<"Master: sending "<<number_of_graphs << " graphs to all"<< std::endl;
+			for (int i = 0; i < input_graphs.size(); i++)
+			{
+				input_graphs[i]->MPI_Bcast_Send_Matrix(MASTER_ID);
+			}
+		}
+		
+		/*
+		 * Sending the pairs that are already in the results store or the checkpoint log to worker nodes.
+		 */
+		ResultsStore results_store;
+		std::vector<GraphHash> graph_hashes;
+		std::vector<char> pair_done = openResultsStore(results_store, graph_hashes, input_graphs, isoRank_results);
+		CheckpointLog checkpoint_log;
+		openCheckpoint(checkpoint_log, graph_hashes, input_graphs, pair_done, isoRank_results);
+		ResultsWriter results_writer;
+		openResultsWriter(results_writer, isoRank_results);
+		GraphClasses graph_classes;
+		planPairs(graph_classes, input_graphs, pair_done, isoRank_results, checkpoint_log, results_writer);
+		int pending_comparisons = total_comparisons - std::count(pair_done.begin(), pair_done.end(), 1);
+		if (total_comparisons > 0)
 		{
-			input_graphs[i]->MPI_Bcast_Send_Matrix(MASTER_ID);
+			MPI_Bcast (&pair_done[0], total_comparisons, MPI_CHAR, MASTER_ID, MPI_COMM_WORLD);
 		}
 		
 		/*
 		 * Collecting the results from the worker nodes.
 		 */
 		int recv_counter = 0;
-		while (recv_counter < total_comparisons)
+		while (recv_counter < pending_comparisons)
 		{
-			int dest;
-			//Recv workers ID
-			MPI_Recv(&dest, 1, MPI_INT, MPI_ANY_SOURCE, TAG_1 + TAG_2, MPI_COMM_WORLD,&stat);
-			if(G_DEBUG)
-				std::cout <<"Master: received signal to receive result from: "<< dest<< std::endl;
-
-			//Collect the result from worker
-			isoRank_results.push_back(MPI_Recv_IsoRank_Result(dest, TAG_1 * dest + TAG_3, stat));
-			recv_counter++;
+			//Collect a batch of results from any worker
+			std::vector<IsoRank_Result> batch = MPI_Recv_IsoRank_Results(MPI_ANY_SOURCE, TAG_1 + TAG_2, stat);
 			if(G_DEBUG)
-				std::cout <<"Master: results were received."<< dest<< std::endl;
+				std::cout <<"Master: received "<< batch.size() << " results from: "<< stat.MPI_SOURCE << std::endl;
+			for (int r = 0; r < batch.size(); r++)
+			{
+				addResult(graph_classes, batch[r], isoRank_results, checkpoint_log, results_writer);
+				recv_counter++;
+			}
 		}
 		
- 		time_end = std::clock();
+ 		time_end = WallClock::now();
 
 		//printing the results 
 		if (G_PRINT)
@@ -578,7 +867,11 @@ int main(int argc, char * argv[])
 				std::cout<< isoRank_results[i].frob_norm << ", ";
 			}
 			std::cout<<std::endl;
+			printTrials(isoRank_results, "Master: ");
 		}
+		results_writer.close();
+		checkpoint_log.close();
+		closeResultsStore(results_store, graph_hashes, isoRank_results);
 		
 		typename std::vector<IsoRank_Result>::iterator res_it;
 		for ( res_it = isoRank_results.begin() ; res_it < isoRank_results.end(); ++res_it )
@@ -586,27 +879,78 @@ int main(int argc, char * argv[])
 			delete [] res_it->assignments;
 		}
 		
-		typename std::vector<SymMatrix<DataType>* >::iterator graph_it;
-		for ( graph_it = input_graphs.begin() ; graph_it < input_graphs.end(); ++graph_it )
+		if (shared_graphs != NULL)
+		{
+			delete shared_graphs;
+		}
+		else
 		{
-			delete  *graph_it;
+			typename std::vector<SymMatrix<DataType>* >::iterator graph_it;
+			for ( graph_it = input_graphs.begin() ; graph_it < input_graphs.end(); ++graph_it )
+			{
+				delete  *graph_it;
+			}
 		}
     }
 //======================================================================*WORKER NODES*==============================================================================
     else
     {
     	
-    	std::vector<DenseMatrix1D<DataType>* > recv_graphs;
+    	std::vector<SymMatrix<DataType>* > recv_graphs;
+    	SharedGraphs<DataType>* shared_graphs = NULL;
     	
-    	MPI_Bcast (&number_of_graphs, 1, MPI_INT, MASTER_ID, MPI_COMM_WORLD);
-    	for (int i = 0; i < number_of_graphs; i++)
+    	if (G_SHARED_GRAPHS)
+    	{
+    		//the graphs are read in place from the window of the node
+    		shared_graphs = new SharedGraphs<DataType>(MASTER_ID, recv_graphs);
+    		recv_graphs = shared_graphs->getGraphs();
+    		number_of_graphs = recv_graphs.size();
+    	}
+    	else
     	{
-    		recv_graphs.push_back(new DenseMatrix1D<DataType>(MASTER_ID, stat));
+    		MPI_Bcast (&number_of_graphs, 1, MPI_INT, MASTER_ID, MPI_COMM_WORLD);
+    		for (int i = 0; i < number_of_graphs; i++)
+    		{
+    			recv_graphs.push_back(new SymMatrix<DataType>(MASTER_ID, stat));
+    		}
     	}
 
 		if (G_DEBUG)
 			std::cout << "Process "<< ID << " : received " << number_of_graphs << " graphs from master"<< std::endl;
+		
+		total_comparisons = (0.5*(number_of_graphs-1)*number_of_graphs);
+		std::vector<char> pair_done(total_comparisons, 0);
+		if (total_comparisons > 0)
+		{
+			MPI_Bcast (&pair_done[0], total_comparisons, MPI_CHAR, MASTER_ID, MPI_COMM_WORLD);
+		}
 	
+        /*
+         * The compute threads run isoRank() on the pairs of this processor while this
+         * thread sends the results back in batches.
+         */
+    	WorkerThreads<Graph_Pair_Job<SymMatrix<DataType> > > workers(num_compute_threads,
+    		[&](Graph_Pair_Job<SymMatrix<DataType> >& job)
+    		{
+    			struct IsoRank_Result result;
+    			if (G_USE_ISORANK)
+    			{
+    				if (G_DEBUG)
+    					std::cout << "Process " << ID << ": isoRank: started."  << job.graph_i << " " << job.graph_j << std::endl;
+    				result = isoRank(*job.graph_A, *job.graph_B, G_GRAPH_MATCHING_ALGORITHM, G_EIGEN_BACKEND, G_EIGEN_TOLERANCE, G_RESTART_POLICY, G_LOCAL_SEARCH,
+    				                 pair_stream(G_SEED, job.graph_i, job.graph_j));
+    				result.graph_i = job.graph_i;
+    				result.graph_j = job.graph_j;
+    				if (G_DEBUG)
+    					std::cout << "Process " << ID << ": isoRank: end." << std::endl;
+    			}
+    			if (G_USE_GPGM)
+    			{
+    				//GPGM(mat1,mat2);
+    			}
+    			return result;
+    		});
+    	
         Offset offset;
         offset.setValues(ID, num_procs, number_of_graphs);
         int A, B;
@@ -632,111 +976,535 @@ int main(int argc, char * argv[])
 
 			for (int j = A; j <= B; j++)
 			{	
-				struct IsoRank_Result result;
-				try
-				{
-					if (G_USE_ISORANK)
-					{	
-						if (G_DEBUG)
-							std::cout << "Process " << ID << ": isoRank: started."  << i << " " << j << std::endl;
-						result = isoRank(*recv_graphs[i], *recv_graphs[j], G_GRAPH_MATCHING_ALGORITHM);
-						if (G_DEBUG)
-							std::cout << "Process " << ID << ": isoRank: end." << std::endl;
-					}
-					if (G_USE_GPGM)
-					{
-						//GPGM(mat1,mat2);
-					}
-						
-					//Sending the ID to master for more graphs
-					MPI_Send(&ID, 1, MPI_INT, MASTER_ID, TAG_1 + TAG_2, MPI_COMM_WORLD);
-
-					if (G_DEBUG)
-					  std::cout << "Process "<< ID << " :sending result to master" << std::endl;
-					  
-					//Sending results to master
-					MPI_Send_IsoRank_Result(result, MASTER_ID , TAG_1 * ID + TAG_3);
-					delete []result.assignments;
-				}
-				catch (std::exception& e)
+				//skip the pairs that are already in the results store or the checkpoint log
+				if (pair_done[pair_index(i, j, number_of_graphs)])
 				{
-					std::cerr << "Process "<< ID << " Exception: " << e.what() << std::endl;
+					continue;
 				}
+				
+				Graph_Pair_Job<SymMatrix<DataType> > job = {i, j, recv_graphs[i], recv_graphs[j]};
+				workers.push(job);
+			}
+		}
+		workers.close();
+		
+		IsoRank_Result_Sender result_sender;
+		while (workers.getInFlight() > 0)
+		{
+			std::vector<IsoRank_Result> results = workers.takeResults(-1);
+			if (results.empty())
+			{
+				continue;
+			}
+			if (G_DEBUG)
+				std::cout << "Process "<< ID << " :sending " << results.size() << " results to master" << std::endl;
+			
+			//Sending results to master
+			result_sender.send(results, MASTER_ID, TAG_1 + TAG_2);
+			for (int r = 0; r < results.size(); r++)
+			{
+				delete [] results[r].assignments;
 			}
 		}
-		typename std::vector<DenseMatrix1D<DataType>* >::iterator graph_it;
-		for ( graph_it = recv_graphs.begin() ; graph_it < recv_graphs.end(); ++graph_it )
+		result_sender.waitAll();
+		
+		if (shared_graphs != NULL)
+		{
+			delete shared_graphs;
+		}
+		else
 		{
-			delete  *graph_it;
+			typename std::vector<SymMatrix<DataType>* >::iterator graph_it;
+			for ( graph_it = recv_graphs.begin() ; graph_it < recv_graphs.end(); ++graph_it )
+			{
+				delete  *graph_it;
+			}
 		}
 	}			
 		
 	
 	if(G_PRINT)
+    {
+        std::ostringstream label;
+        label << "Process " << ID << ": ";
+        print_perf_counters(std::cout, label.str());
     	std::cout << "Process: "<< ID << " terminated." << std::endl; 
+    }
 
+    writeProfile(ID, num_procs);
     MPI_Finalize();
     return 0;
 }
 #endif
 
 /*
- * Calculates the time elapsed
- * @pram std::clock_t  start_time
- * @pram std::clock_t  end_time
+ * Opens the results store in G_STORE_FILE and computes the hash of every graph
+ * when a results store or a checkpoint log is used. A store written with other settings is not used.
+ * Returns a vector with an entry for every pair of graphs (see pair_index) that is 1 if the
+ * pair is already in the store and the incremental mode is on, 0 if the pair has to be computed.
+ * The results of the pairs found in the store are added to the results, like the resumed ones.
+ * @pram ResultsStore results store
+ * @pram std::vector<GraphHash> set to the hashes of the graphs
+ * @pram std::vector<Matrix*> input graphs
+ * @pram std::vector<IsoRank_Result> results, the results found in the store are added to it
+ */
+template <typename Matrix>
+std::vector<char> openResultsStore(ResultsStore& results_store, std::vector<GraphHash>& graph_hashes, std::vector<Matrix*>& input_graphs,
+                                   std::vector<IsoRank_Result>& isoRank_results)
+{
+    int number_of_graphs = input_graphs.size();
+    std::vector<char> pair_done((number_of_graphs*(number_of_graphs-1))/2, 0);
+    if (G_STORE_FILE.empty() && G_CHECKPOINT_FILE.empty())
+    {
+        return pair_done;
+    }
+    
+    for (int i = 0; i < number_of_graphs; i++)
+    {
+        graph_hashes.push_back(graph_hash(*input_graphs[i]));
+    }
+    if (G_STORE_FILE.empty())
+    {
+        return pair_done;
+    }
+    
+    try
+    {
+        results_store.load(G_STORE_FILE, resultsSettingsHash());
+    }
+    catch (StoreMismatchException& e)
+    {
+        std::cerr << "Results store '" << G_STORE_FILE << "' was written with other settings, it is not used." << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Results store '" << G_STORE_FILE << "' could not be read, starting with an empty store." << std::endl;
+    }
+    
+    if (G_INCREMENTAL)
+    {
+        int reused = 0;
+        for (int i = 0; i < number_of_graphs; i++)
+        {
+            for (int j = i + 1; j < number_of_graphs; j++)
+            {
+                if (results_store.contains(graph_hashes[i], graph_hashes[j]))
+                {
+                    pair_done[pair_index(i, j, number_of_graphs)] = 1;
+                    isoRank_results.push_back(results_store.getResult(graph_hashes[i], graph_hashes[j], i, j));
+                    reused++;
+                }
+            }
+        }
+        if (G_PRINT)
+            std::cout << reused << " of " << pair_done.size() << " pairs were found in the results store." << std::endl;
+    }
+    return pair_done;
+}
+
+/*
+ * Returns a hash of the settings that change the result of a pair: the matching algorithm, the restarts,
+ * the local search, the seed, the eigen solver and the isomorphism classes. A results store or a checkpoint
+ * log only serves runs with the same settings.
  */
-double timeElapsed(std::clock_t start, std::clock_t end)
+GraphHash resultsSettingsHash()
 {
-    return (double) (end - start) / CLOCKS_PER_SEC * 1000.0;
+    GraphHash hash = 14695981039346656037ULL;
+    int algorithm = G_USE_ISORANK ? G_GRAPH_MATCHING_ALGORITHM : -1;
+    int classes = (G_DEDUP ? 1 : 0) + (G_WL_BYPASS ? 2 : 0);
+    hash = fnv1a_mix(hash, &algorithm, sizeof(int));
+    hash = fnv1a_mix(hash, &G_RESTART_POLICY.max_trials, sizeof(int));
+    hash = fnv1a_mix(hash, &G_RESTART_POLICY.patience, sizeof(int));
+    hash = fnv1a_mix(hash, &G_RESTART_POLICY.trial_time, sizeof(double));
+    hash = fnv1a_mix(hash, &G_LOCAL_SEARCH.max_evaluations, sizeof(int));
+    hash = fnv1a_mix(hash, &G_LOCAL_SEARCH.threads, sizeof(int));
+    hash = fnv1a_mix(hash, &G_SEED, sizeof(unsigned long long));
+    hash = fnv1a_mix(hash, &G_EIGEN_BACKEND, sizeof(int));
+    hash = fnv1a_mix(hash, &G_EIGEN_CALIBRATE, sizeof(bool));
+    hash = fnv1a_mix(hash, &G_EIGEN_TOLERANCE, sizeof(double));
+    hash = fnv1a_mix(hash, &classes, sizeof(int));
+    return hash;
 }
 
 /*
- * This method Configures the setting of the program according to the command line agrs.
- * @pram int argc
- * @pram char** argv
- * @pram int processor ID: Only ID == 0 will print to the console
+ * Merges the new results into the results store and writes it to G_STORE_FILE.
+ * @pram ResultsStore results store
+ * @pram std::vector<GraphHash> hashes of the graphs
+ * @pram std::vector<IsoRank_Result> new results
  */
-void parseCommandLineArgs(int argc,char* argv[], int ID)
+void closeResultsStore(ResultsStore& results_store, std::vector<GraphHash>& graph_hashes, std::vector<IsoRank_Result>& isoRank_results)
 {
-    if (ID == 0)
+    if (G_STORE_FILE.empty() || !results_store.isWritable())
     {
-        std::cout << "\n\nReading command line arguments..." << std::endl;
-        if ( argc < 2)
-        {
-            std::cout <<"No arguments were passed." << std::endl;
-        }
+        return;
+    }
+    
+    for (int i = 0; i < isoRank_results.size(); i++)
+    {
+        results_store.insert(graph_hashes[isoRank_results[i].graph_i], graph_hashes[isoRank_results[i].graph_j], isoRank_results[i]);
     }
     
     try
     {
-        for (int i = 1; i < argc; i++)
+        results_store.save(G_STORE_FILE);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Results store '" << G_STORE_FILE << "' could not be written." << std::endl;
+    }
+    
+    //printing the similarity matrix of the graphs
+    if (G_PRINT)
+    {
+        int number_of_graphs = graph_hashes.size();
+        std::vector<int> matrix = results_store.similarityMatrix(graph_hashes);
+        std::cout << "Similarity matrix (frob_norms) of " << number_of_graphs << " graphs:" << std::endl;
+        for (int i = 0; i < number_of_graphs; i++)
         {
-            //changing the folder directory
-            if (std::strncmp(argv[i], "-dir",4) == 0)
+            for (int j = 0; j < number_of_graphs; j++)
             {
-                i++;
-                G_DIR_PATH = std::string(argv[i]);
-                if (ID == 0)
-                    std::cout << "Working directory was set to: " << G_DIR_PATH << std::endl;
+                std::cout << matrix[i*number_of_graphs + j] << ' ';
             }
-            //changing the extension of the file
-            else if (std::strncmp(argv[i], "-ext",4) == 0)
+            std::cout << std::endl;
+        }
+    }
+}
+
+/*
+ * Opens the checkpoint log in G_CHECKPOINT_FILE. With -resume the results of the pairs in the log
+ * are added to the results and the pairs are marked as done, so only the remaining pairs are computed.
+ * A log that does not match the input graphs or the settings of the run (see resultsSettingsHash) is
+ * left untouched and no checkpoint is written.
+ * @pram CheckpointLog checkpoint log
+ * @pram std::vector<GraphHash> hashes of the graphs
+ * @pram std::vector<Matrix*> input graphs
+ * @pram std::vector<char> pairs that are done (see pair_index)
+ * @pram std::vector<IsoRank_Result> results, the resumed results are added to it
+ */
+template <typename Matrix>
+void openCheckpoint(CheckpointLog& checkpoint_log, std::vector<GraphHash>& graph_hashes, std::vector<Matrix*>& input_graphs,
+                    std::vector<char>& pair_done, std::vector<IsoRank_Result>& isoRank_results)
+{
+    if (G_CHECKPOINT_FILE.empty())
+    {
+        return;
+    }
+    
+    std::vector<IsoRank_Result> completed;
+    try
+    {
+        if (G_RESUME)
+        {
+            std::vector<int> graph_sizes;
+            for (int i = 0; i < input_graphs.size(); i++)
             {
-                i++;
-                G_FILE_EXTENSION = std::string(argv[i]);
-                if (ID == 0)
-                    std::cout << "File extension was set to: " << G_FILE_EXTENSION << std::endl;
+                graph_sizes.push_back(input_graphs[i]->getNumberOfRows());
             }
-            //changing the number of files to be read
-            else if (std::strncmp(argv[i], "-num_files",10) == 0)
-            {
-                i++;
-                int input_number = atoi(argv[i]);
-                if ( input_number > 0)
-                {
-                    G_NUMBER_OF_FILES = input_number;
-                    if (ID == 0)
-                        std::cout << "Number of files was set to: " << G_NUMBER_OF_FILES << std::endl;
+            completed = checkpoint_log.load(G_CHECKPOINT_FILE, G_GRAPH_MATCHING_ALGORITHM, resultsSettingsHash(), graph_hashes, graph_sizes);
+        }
+        checkpoint_log.open(G_CHECKPOINT_FILE, G_GRAPH_MATCHING_ALGORITHM, resultsSettingsHash(), graph_hashes, completed, G_CHECKPOINT_INTERVAL);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Checkpoint log '" << G_CHECKPOINT_FILE << "': " << e.what() << ", no checkpoint is written." << std::endl;
+    }
+    
+    int resumed = 0;
+    int number_of_graphs = graph_hashes.size();
+    for (int r = 0; r < completed.size(); r++)
+    {
+        char& done = pair_done[pair_index(completed[r].graph_i, completed[r].graph_j, number_of_graphs)];
+        if (done)
+        {
+            delete [] completed[r].assignments;
+            continue;
+        }
+        done = 1;
+        isoRank_results.push_back(completed[r]);
+        resumed++;
+    }
+    if (G_PRINT && G_RESUME)
+        std::cout << resumed << " of " << pair_done.size() << " pairs were resumed from the checkpoint log." << std::endl;
+}
+
+/*
+ * Opens the results files in G_OUTPUT_FILE and G_TEXT_FILE and writes the results
+ * that were resumed from the checkpoint log.
+ * @pram ResultsWriter results writer
+ * @pram std::vector<IsoRank_Result> results that are already known
+ */
+void openResultsWriter(ResultsWriter& results_writer, std::vector<IsoRank_Result>& isoRank_results)
+{
+    try
+    {
+        results_writer.open(G_OUTPUT_FILE, G_TEXT_FILE, G_TEXT_DELIMITER, RESULTS_QUEUE_CAPACITY);
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Results file could not be opened: " << e.what() << std::endl;
+        return;
+    }
+    
+    for (int i = 0; i < isoRank_results.size(); i++)
+    {
+        results_writer.write(isoRank_results[i]);
+    }
+}
+
+/*
+ * Sorts the graphs into isomorphism classes (GraphClasses.h) and chooses the pairs that are computed: one
+ * pair per pair of classes. The pairs of two graphs of the same class are matched by the mappings of the
+ * classes, their results are written like the results of isoRank(). The pairs that are not computed are
+ * marked as done, so they are not sent to the workers.
+ * @pram GraphClasses set to the classes of the graphs
+ * @pram std::vector<Matrix*> the graphs
+ * @pram std::vector<char> the pairs that are done, the pairs that are not computed are added
+ * @pram std::vector<IsoRank_Result> results, the results of the pairs of the same class are added
+ * @pram CheckpointLog checkpoint log
+ * @pram ResultsWriter results writer
+ */
+template <typename Matrix>
+void planPairs(GraphClasses& graph_classes, std::vector<Matrix*>& input_graphs, std::vector<char>& pair_done,
+               std::vector<IsoRank_Result>& isoRank_results, CheckpointLog& checkpoint_log, ResultsWriter& results_writer)
+{
+    if (!G_DEDUP || !G_USE_ISORANK)
+    {
+        return;
+    }
+    
+    WallClock::time_point time_start = WallClock::now();
+    graph_classes.build(input_graphs, G_WL_BYPASS);
+    std::vector<IsoRank_Result> matched = graph_classes.plan(pair_done);
+    for (int r = 0; r < matched.size(); r++)
+    {
+        addResult(graph_classes, matched[r], isoRank_results, checkpoint_log, results_writer);
+    }
+    if (G_PRINT)
+    {
+        std::cout << "Isomorphism classes: " << graph_classes.getNumberOfClasses() << " classes for " << input_graphs.size() << " graphs ("
+        << graph_classes.getNumberOfDiscreteGraphs() << " with a discrete WL partition) in " << timeElapsed(time_start, WallClock::now()) << "(ms)." << std::endl;
+        std::cout << "Isomorphism classes: " << matched.size() << " pairs were matched within a class, "
+        << graph_classes.getNumberOfDerivedPairs() << " pairs are derived from a computed pair." << std::endl;
+    }
+}
+
+/*
+ * Adds the result of a pair to the results, the checkpoint log and the results files, followed by the
+ * results of the pairs derived from it.
+ * @pram GraphClasses classes of the graphs
+ * @pram IsoRank_Result result of the pair
+ * @pram std::vector<IsoRank_Result> results
+ * @pram CheckpointLog checkpoint log
+ * @pram ResultsWriter results writer
+ */
+void addResult(GraphClasses& graph_classes, const IsoRank_Result& result, std::vector<IsoRank_Result>& isoRank_results,
+               CheckpointLog& checkpoint_log, ResultsWriter& results_writer)
+{
+    std::vector<IsoRank_Result> derived = graph_classes.expand(result);
+    derived.insert(derived.begin(), result);
+    for (int r = 0; r < derived.size(); r++)
+    {
+        isoRank_results.push_back(derived[r]);
+        checkpoint_log.append(derived[r]);
+        results_writer.write(derived[r]);
+    }
+}
+
+#ifdef USE_MPI
+/*
+ * Returns the number of compute threads of a processor. If MPI does not allow threads
+ * (MPI_THREAD_FUNNELED) the pairs are computed by the main thread and 0 is returned.
+ * @pram int thread support level returned by MPI_Init_thread
+ * @pram int ID of the processor
+ */
+int computeThreads(int thread_support, int ID)
+{
+    if (thread_support < MPI_THREAD_FUNNELED)
+    {
+        if (ID == 0)
+            std::cout << "MPI does not support threads (MPI_THREAD_FUNNELED), running one thread per processor." << std::endl;
+        return 0;
+    }
+    return G_NUM_THREADS;
+}
+#endif
+
+/*
+ * Chooses the eigen solver backend of every size of component when it was not forced with -eigen_backend.
+ * The fixed crossover of EigenBackends.h is kept unless -eigen_backend calibrate was given, then the master
+ * times the backends and sends its choices to the other processors, so every processor solves a component
+ * of the same size with the same backend. A query is not timed. Has to be called by all ranks.
+ * @pram int ID of the processor
+ */
+void calibrateEigenSolvers(int ID)
+{
+    if (!G_USE_ISORANK || G_EIGEN_BACKEND != EIGEN_BACKEND_AUTO)
+    {
+        return;
+    }
+    
+    EigenSolverSelector& selector = eigen_solver_selector();
+    int backends[NUM_OF_CALIBRATION_SIZES];
+    if (G_EIGEN_CALIBRATE && G_QUERY_FILE.empty())
+    {
+        if (ID == 0)
+        {
+            selector.calibrate<DataType>(G_EIGEN_TOLERANCE);
+            selector.getTable(backends);
+        }
+#ifdef USE_MPI
+        MPI_Bcast(backends, NUM_OF_CALIBRATION_SIZES, MPI_INT, 0, MPI_COMM_WORLD);
+        selector.setTable(backends);
+#endif
+    }
+    selector.getTable(backends);
+    
+    if (ID == 0 && G_PRINT)
+    {
+        std::cout << (selector.isCalibrated() ? "Eigen solver calibration:" : "Eigen solver crossover:") << std::endl;
+        for (int s = 0; s < NUM_OF_CALIBRATION_SIZES; s++)
+        {
+            std::cout << "    " << CALIBRATION_SIZES[s] << " nodes:";
+            for (int b = 0; b < NUM_OF_EIGEN_BACKENDS; b++)
+            {
+                if (selector.getTime(s, b) >= 0)
+                {
+                    std::cout << " " << EIGEN_BACKEND_NAMES[b] << " " << selector.getTime(s, b) << "(ms),";
+                }
+            }
+            std::cout << " using " << EIGEN_BACKEND_NAMES[backends[s]] << "." << std::endl;
+        }
+    }
+}
+
+/*
+ * Calculates the wall clock time elapsed in milliseconds
+ * @pram WallClock::time_point  start_time
+ * @pram WallClock::time_point  end_time
+ */
+double timeElapsed(WallClock::time_point start, WallClock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/*
+ * Prints the number of matching trials the restart controller used, the pairs restored from
+ * a checkpoint or matched or derived by their isomorphism classes ran no trials and are not counted.
+ * @pram std::vector<IsoRank_Result> results of the pairs
+ * @pram std::string printed before the line
+ */
+void printTrials(std::vector<IsoRank_Result>& isoRank_results, const std::string& prefix)
+{
+    long long trials = 0;
+    int pairs = 0;
+    for (int i = 0; i < isoRank_results.size(); i++)
+    {
+        if (isoRank_results[i].trials > 0)
+        {
+            trials += isoRank_results[i].trials;
+            pairs++;
+        }
+    }
+    std::cout << prefix << "Matching trials: " << trials << " for " << pairs << " pairs";
+    if (pairs > 0)
+    {
+        std::cout << " (" << (double)trials / pairs << " per pair)";
+    }
+    std::cout << "." << std::endl;
+}
+
+/*
+ * Gathers the profile of every rank on the master, which writes it to G_PROFILE_FILE.
+ * Has to be called by all ranks.
+ * @pram int ID of the processor
+ * @pram int number of processors
+ */
+void writeProfile(int ID, int num_procs)
+{
+    if (G_PROFILE_FILE.empty())
+    {
+        return;
+    }
+    
+    Profile_Stats local_stats = Profiler::collect();
+    std::vector<Profile_Stats> rank_stats(num_procs);
+#ifdef USE_MPI
+    int flat_size = Profile_Stats::flatSize();
+    std::vector<long long> send_buffer(flat_size);
+    std::vector<long long> recv_buffer(ID == 0 ? num_procs * flat_size : 1);
+    local_stats.flatten(&send_buffer[0]);
+    MPI_Gather(&send_buffer[0], flat_size, MPI_LONG_LONG, &recv_buffer[0], flat_size, MPI_LONG_LONG, 0, MPI_COMM_WORLD);
+    if (ID != 0)
+    {
+        return;
+    }
+    for (int r = 0; r < num_procs; r++)
+    {
+        rank_stats[r].unflatten(&recv_buffer[r * flat_size]);
+    }
+#else
+    rank_stats[0] = local_stats;
+#endif
+    
+    try
+    {
+        write_profile_file(G_PROFILE_FILE, rank_stats);
+        if (G_PRINT)
+            std::cout << "Profile was written to: " << G_PROFILE_FILE << std::endl;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Profile '" << G_PROFILE_FILE << "' could not be written." << std::endl;
+    }
+}
+
+/*
+ * This method Configures the setting of the program according to the command line agrs.
+ * @pram int argc
+ * @pram char** argv
+ * @pram int processor ID: Only ID == 0 will print to the console
+ */
+void parseCommandLineArgs(int argc,char* argv[], int ID)
+{
+    if (ID == 0)
+    {
+        std::cout << "\n\nReading command line arguments..." << std::endl;
+        if ( argc < 2)
+        {
+            std::cout <<"No arguments were passed." << std::endl;
+        }
+    }
+    
+    try
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            //changing the folder directory
+            if (std::strncmp(argv[i], "-dir",4) == 0)
+            {
+                i++;
+                G_DIR_PATH = std::string(argv[i]);
+                if (ID == 0)
+                    std::cout << "Working directory was set to: " << G_DIR_PATH << std::endl;
+            }
+            //changing the extension of the file
+            else if (std::strncmp(argv[i], "-ext",4) == 0)
+            {
+                i++;
+                G_FILE_EXTENSION = std::string(argv[i]);
+                if (ID == 0)
+                    std::cout << "File extension was set to: " << G_FILE_EXTENSION << std::endl;
+            }
+            //changing the number of files to be read
+            else if (std::strncmp(argv[i], "-num_files",10) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if ( input_number > 0)
+                {
+                    G_NUMBER_OF_FILES = input_number;
+                    if (ID == 0)
+                        std::cout << "Number of files was set to: " << G_NUMBER_OF_FILES << std::endl;
                 }
                 // the input is not a number or it's an invalid number
                 else
@@ -817,6 +1585,323 @@ void parseCommandLineArgs(int argc,char* argv[], int ID)
                         std::cout << "Algorithm '" << argv [i] <<  "' is not a valid algorithm." << std::endl;
                 }
             }
+            //query graph for the top-k search
+            else if (std::strncmp(argv[i], "-query", 6) == 0)
+            {
+                i++;
+                G_QUERY_FILE = std::string(argv[i]);
+                if (ID == 0)
+                    std::cout << "Query graph was set to: " << G_QUERY_FILE << std::endl;
+            }
+            //changing the number of results of the top-k search
+            else if (std::strncmp(argv[i], "-topk", 5) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if ( input_number > 0)
+                {
+                    G_TOP_K = input_number;
+                    if (ID == 0)
+                        std::cout << "Number of query results was set to: " << G_TOP_K << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the results store
+            else if (std::strncmp(argv[i], "-store", 6) == 0)
+            {
+                i++;
+                G_STORE_FILE = std::string(argv[i]);
+                if (ID == 0)
+                    std::cout << "Results store was set to: " << G_STORE_FILE << std::endl;
+            }
+            //changing the binary results file
+            else if (std::strncmp(argv[i], "-out", 4) == 0)
+            {
+                i++;
+                G_OUTPUT_FILE = std::string(argv[i]);
+                if (ID == 0)
+                    std::cout << "Results file was set to: " << G_OUTPUT_FILE << std::endl;
+            }
+            //changing the CSV results file
+            else if (std::strncmp(argv[i], "-csv", 4) == 0)
+            {
+                i++;
+                G_TEXT_FILE = std::string(argv[i]);
+                G_TEXT_DELIMITER = ',';
+                if (ID == 0)
+                    std::cout << "CSV results file was set to: " << G_TEXT_FILE << std::endl;
+            }
+            //changing the TSV results file
+            else if (std::strncmp(argv[i], "-tsv", 4) == 0)
+            {
+                i++;
+                G_TEXT_FILE = std::string(argv[i]);
+                G_TEXT_DELIMITER = '\t';
+                if (ID == 0)
+                    std::cout << "TSV results file was set to: " << G_TEXT_FILE << std::endl;
+            }
+            //changing the profile file
+            else if (std::strncmp(argv[i], "-profile", 8) == 0)
+            {
+                i++;
+                G_PROFILE_FILE = std::string(argv[i]);
+                Profiler::setEnabled(true);
+                if (ID == 0)
+                    std::cout << "Profile file was set to: " << G_PROFILE_FILE << std::endl;
+            }
+            //changing the number of seconds between two flushes of the checkpoint log
+            else if (std::strncmp(argv[i], "-checkpoint_interval", 20) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if (input_number > 0)
+                {
+                    G_CHECKPOINT_INTERVAL = input_number;
+                    if (ID == 0)
+                        std::cout << "Checkpoint interval was set to: " << G_CHECKPOINT_INTERVAL << "(s)" << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the checkpoint log
+            else if (std::strncmp(argv[i], "-checkpoint", 11) == 0)
+            {
+                i++;
+                G_CHECKPOINT_FILE = std::string(argv[i]);
+                if (ID == 0)
+                    std::cout << "Checkpoint log was set to: " << G_CHECKPOINT_FILE << std::endl;
+            }
+            //skip the pairs that are in the checkpoint log
+            else if (std::strncmp(argv[i], "-resume", 7) == 0)
+            {
+                G_RESUME = true;
+                if (ID == 0)
+                    std::cout << "Resume from checkpoint: enabled." << std::endl;
+            }
+            //only compute the pairs that are missing from the results store
+            else if (std::strncmp(argv[i], "-incremental", 12) == 0)
+            {
+                G_INCREMENTAL = true;
+                if (ID == 0)
+                    std::cout << "Incremental mode: enabled." << std::endl;
+            }
+            //changing the number of compute threads of every processor
+            else if (std::strncmp(argv[i], "-threads", 8) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if (input_number > 0)
+                {
+                    G_NUM_THREADS = input_number;
+                    if (ID == 0)
+                        std::cout << "Number of threads was set to: " << G_NUM_THREADS << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //compute the eigenvectors with the mixed precision solver, same as -eigen_backend lanczos
+            else if (std::strncmp(argv[i], "-mixed_precision", 16) == 0)
+            {
+                G_EIGEN_BACKEND = EIGEN_BACKEND_LANCZOS;
+                if (ID == 0)
+                    std::cout << "Mixed precision eigen solver: enabled." << std::endl;
+            }
+            //choosing the eigen solver backend of every component
+            else if (std::strncmp(argv[i], "-eigen_backend", 14) == 0)
+            {
+                i++;
+                int backend = -2;
+                bool calibrate = false;
+                if (std::strncmp(argv[i], "auto", 4) == 0)
+                {
+                    backend = EIGEN_BACKEND_AUTO;
+                }
+                else if (std::strncmp(argv[i], "calibrate", 9) == 0)
+                {
+                    backend = EIGEN_BACKEND_AUTO;
+                    calibrate = true;
+                }
+                for (int b = 0; b < NUM_OF_EIGEN_BACKENDS; b++)
+                {
+                    if (std::strcmp(argv[i], EIGEN_BACKEND_NAMES[b]) == 0)
+                    {
+                        backend = b;
+                    }
+                }
+                if (backend == EIGEN_BACKEND_AUTO || eigen_backend_available(backend))
+                {
+                    G_EIGEN_BACKEND = backend;
+                    G_EIGEN_CALIBRATE = calibrate;
+                    if (ID == 0)
+                        std::cout << "Eigen solver backend was set to " << argv[i] << "." << std::endl;
+                }
+                // invalid pram or a backend that was not compiled in
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "Eigen solver backend '" << argv[i] << "' is not available." << std::endl;
+                }
+            }
+            //only graphs with the same content are in the same isomorphism class
+            else if (std::strncmp(argv[i], "-no_wl", 6) == 0)
+            {
+                G_WL_BYPASS = false;
+                if (ID == 0)
+                    std::cout << "WL certificates: disabled." << std::endl;
+            }
+            //computing every pair with isoRank()
+            else if (std::strncmp(argv[i], "-no_dedup", 9) == 0)
+            {
+                G_DEDUP = false;
+                if (ID == 0)
+                    std::cout << "Isomorphism classes: disabled." << std::endl;
+            }
+            //changing the maximum number of matching trials of a pair
+            else if (std::strncmp(argv[i], "-max_trials", 11) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if (input_number > 0)
+                {
+                    G_RESTART_POLICY.max_trials = input_number;
+                    if (ID == 0)
+                        std::cout << "Maximum number of matching trials was set to: " << G_RESTART_POLICY.max_trials << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the number of trials without improvement after which the restarts stop
+            else if (std::strncmp(argv[i], "-patience", 9) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if (input_number > 0 || std::strcmp(argv[i], "0") == 0)
+                {
+                    G_RESTART_POLICY.patience = input_number;
+                    if (ID == 0)
+                        std::cout << "Patience of the restarts was set to: " << G_RESTART_POLICY.patience << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the time budget of the matching trials of a pair
+            else if (std::strncmp(argv[i], "-trial_time", 11) == 0)
+            {
+                i++;
+                double input_number = atof(argv[i]);
+                if (input_number > 0 || std::strcmp(argv[i], "0") == 0)
+                {
+                    G_RESTART_POLICY.trial_time = input_number;
+                    if (ID == 0)
+                        std::cout << "Time budget of the matching trials was set to: " << G_RESTART_POLICY.trial_time << "(ms)" << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the seed of the random streams of the matching algorithms
+            else if (std::strncmp(argv[i], "-seed", 5) == 0)
+            {
+                i++;
+                unsigned long long input_number = strtoull(argv[i], NULL, 10);
+                if (input_number > 0 || std::strcmp(argv[i], "0") == 0)
+                {
+                    G_SEED = input_number;
+                    if (ID == 0)
+                        std::cout << "Seed of the random streams was set to: " << G_SEED << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the number of threads of the local search
+            else if (std::strncmp(argv[i], "-local_search_threads", 21) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if (input_number > 0)
+                {
+                    G_LOCAL_SEARCH.threads = input_number;
+                    if (ID == 0)
+                        std::cout << "Number of threads of the local search was set to: " << G_LOCAL_SEARCH.threads << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the budget of the local search of every matching trial
+            else if (std::strncmp(argv[i], "-local_search", 13) == 0)
+            {
+                i++;
+                int input_number = atoi(argv[i]);
+                if (input_number > 0 || std::strcmp(argv[i], "0") == 0)
+                {
+                    G_LOCAL_SEARCH.max_evaluations = input_number;
+                    if (ID == 0)
+                        std::cout << "Evaluations of the local search were set to: " << G_LOCAL_SEARCH.max_evaluations << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //changing the tolerance of the mixed precision solver
+            else if (std::strncmp(argv[i], "-eigen_tolerance", 16) == 0)
+            {
+                i++;
+                double input_number = atof(argv[i]);
+                if (input_number > 0)
+                {
+                    G_EIGEN_TOLERANCE = input_number;
+                    if (ID == 0)
+                        std::cout << "Eigen solver tolerance was set to: " << G_EIGEN_TOLERANCE << std::endl;
+                }
+                // the input is not a number or it's an invalid number
+                else
+                {
+                    if (ID == 0)
+                        std::cout << "'" << argv[i] << "' is not a valid number." << std::endl;
+                }
+            }
+            //share one copy of the graphs between the ranks of a node
+            else if (std::strncmp(argv[i], "-shared_graphs", 14) == 0)
+            {
+                G_SHARED_GRAPHS = true;
+                if (ID == 0)
+                    std::cout << "Shared graphs: enabled." << std::endl;
+            }
             //Print to console
             else if (std::strncmp(argv[i], "-print", 6) == 0)
             {
@@ -844,9 +1929,88 @@ void parseCommandLineArgs(int argc,char* argv[], int ID)
             std::cout << "Working directory: '" << G_DIR_PATH << "'" << std::endl;
             std::cout << "File Extension: '" << G_FILE_EXTENSION << "'" << std::endl;
             std::cout << "Number of graphs to read: " << G_NUMBER_OF_FILES << std::endl;
+            if (!G_QUERY_FILE.empty())
+            {
+                std::cout << "Query graph: '" << G_QUERY_FILE << "', top " << G_TOP_K << " matches." << std::endl;
+            }
+            if (!G_STORE_FILE.empty())
+            {
+                std::cout << "Results store: '" << G_STORE_FILE << "'" << (G_INCREMENTAL ? ", incremental." : ".") << std::endl;
+            }
+            else if (G_INCREMENTAL)
+            {
+                std::cout << "Incremental mode needs a results store (-store), all pairs will be computed." << std::endl;
+            }
+            if (!G_CHECKPOINT_FILE.empty())
+            {
+                std::cout << "Checkpoint log: '" << G_CHECKPOINT_FILE << "', flushed every " << G_CHECKPOINT_INTERVAL << "(s)"
+                << (G_RESUME ? ", resuming." : ".") << std::endl;
+            }
+            else if (G_RESUME)
+            {
+                std::cout << "Resume needs a checkpoint log (-checkpoint), all pairs will be computed." << std::endl;
+            }
+            if (!G_OUTPUT_FILE.empty())
+            {
+                std::cout << "Results file: '" << G_OUTPUT_FILE << "'" << std::endl;
+            }
+            if (!G_PROFILE_FILE.empty())
+            {
+                std::cout << "Profile file: '" << G_PROFILE_FILE << "'" << std::endl;
+            }
+            if (!G_TEXT_FILE.empty())
+            {
+                std::cout << (G_TEXT_DELIMITER == ',' ? "CSV" : "TSV") << " results file: '" << G_TEXT_FILE << "'" << std::endl;
+            }
+#if SEQ
+            if (G_NUM_THREADS > 1)
+            {
+                std::cout << "Threads are only available in the parallel versions, running one thread." << std::endl;
+            }
+#else
+            std::cout << "Compute threads per processor: " << G_NUM_THREADS << std::endl;
+#endif
+            if (G_SHARED_GRAPHS)
+            {
+#if SEQ || NODE_PAIR
+                std::cout << "Shared graphs are only available in the broadcast version, every process keeps its own graphs." << std::endl;
+#else
+                std::cout << "Graphs: one shared copy per node." << std::endl;
+#endif
+            }
             if (G_USE_ISORANK)
             {
                 std::cout << "Graph matching algorithm: IsoRank." << std::endl;
+                if (G_EIGEN_BACKEND == EIGEN_BACKEND_AUTO)
+                {
+                    std::cout << "Eigen solver: backend chosen by the size of every component, "
+                    << (G_EIGEN_CALIBRATE && G_QUERY_FILE.empty() ? "crossover timed at startup." : "fixed crossover.") << std::endl;
+                }
+                else if (G_EIGEN_BACKEND == EIGEN_BACKEND_LANCZOS)
+                {
+                    std::cout << "Eigen solver: mixed precision Lanczos, tolerance " << G_EIGEN_TOLERANCE << "." << std::endl;
+                }
+                else
+                {
+                    std::cout << "Eigen solver: " << EIGEN_BACKEND_NAMES[G_EIGEN_BACKEND] << "." << std::endl;
+                }
+                if (G_DEDUP)
+                {
+                    std::cout << "Pairs are computed once per pair of isomorphism classes, classes are joined by "
+                    << (G_WL_BYPASS ? "WL certificates." : "identical content.") << std::endl;
+                }
+                std::cout << "Restarts: at most " << G_RESTART_POLICY.max_trials << " trials";
+                if (G_RESTART_POLICY.patience > 0)
+                    std::cout << ", stop after " << G_RESTART_POLICY.patience << " trials without improvement";
+                if (G_RESTART_POLICY.trial_time > 0)
+                    std::cout << ", " << G_RESTART_POLICY.trial_time << "(ms) per pair";
+                std::cout << "." << std::endl;
+                std::cout << "Ties are broken with the random streams of seed " << G_SEED << "." << std::endl;
+                if (G_LOCAL_SEARCH.max_evaluations > 0)
+                {
+                    std::cout << "Local search: " << G_LOCAL_SEARCH.max_evaluations << " evaluations per trial, "
+                    << G_LOCAL_SEARCH.threads << " thread(s)." << std::endl;
+                }
                 std::string assignment_app;
                 switch (G_GRAPH_MATCHING_ALGORITHM)
                 {